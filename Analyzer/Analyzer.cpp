@@ -0,0 +1,369 @@
+/**
+ * @file Analyzer.cpp
+ *
+ * A standalone tool that searches every position of an EPD or FEN file and writes the results as
+ * JSON Lines or CSV, for scoring large sets of positions without driving the engine command by
+ * command. The file is memory mapped and read a line at a time, and every result is written as
+ * soon as it is its turn, so the memory used doesn't grow with the file.
+ *
+ * Short searches scale better over positions than over the threads of one search, so a pool of
+ * workers, each with an Engine of its own, searches positions side by side. The results are
+ * written in the order of the file unless the order is "done", then as the searches end. The
+ * shard argument splits the file between processes, each taking every n-th position.
+ *
+ * Usage: Analyzer <epd file> [depth N] [nodes N] [movetime N] [workers N] [threads N] [hash MB]
+ *                 [evalfile path] [format jsonl|csv] [output path] [order file|done] [shard K/N]
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoardEvaluation.h"
+#include "Engine.h"
+#include "MappedFile.h"
+#include "MoveGeneration.h"
+
+// Progress is reported after every this many positions.
+constexpr std::uint64_t PROGRESS_INTERVAL = 1000;
+
+// In file order, the workers take at most this many positions per worker past the oldest result
+// not yet written, so one slow search can't make the results waiting behind it pile up.
+constexpr std::uint64_t RESULTS_AHEAD = 64;
+
+/**
+ * @struct Position
+ * A position read from a line of the file.
+ */
+struct Position {
+    std::uint64_t line = 0;  ///< The line of the file, counted from 1.
+    std::string fen;         ///< The position fields of the line, as written there.
+    std::string id;          ///< The EPD id operation, empty when the line has none.
+};
+
+/**
+ * Split a line into its whitespace separated tokens.
+ */
+static std::vector<std::string> tokenize(const std::string& line) {
+    std::vector<std::string> tokens;
+    std::size_t start = line.find_first_not_of(" \t\r");
+    while (start != std::string::npos) {
+        const std::size_t end = std::min(line.find_first_of(" \t\r", start), line.size());
+        tokens.push_back(line.substr(start, end - start));
+        start = line.find_first_not_of(" \t\r", end);
+    }
+    return tokens;
+}
+
+static bool isNumber(const std::string& token) {
+    return !token.empty() && std::all_of(token.begin(), token.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+/**
+ * Check if a token is a castling rights or en passant field, such as "KQkq", "e3" or "-".
+ */
+static bool isStateField(const std::string& token) {
+    if (token == "-") return true;
+    if (token.size() == 2 && token[0] >= 'a' && token[0] <= 'h' && (token[1] == '3' || token[1] == '6')) return true;
+    return token.size() <= 4 && token.find_first_not_of("KQkq") == std::string::npos;
+}
+
+/**
+ * Read the position of a line. An EPD line has four position fields followed by operations, a
+ * FEN line six fields. The castling, en passant and move counter fields are kept in the output
+ * but the engine only reads the placement and the side to move.
+ *
+ * @param text The line.
+ * @param position Set to the position.
+ * @return False for a blank line, a comment or a line without a piece placement.
+ */
+static bool parsePosition(const std::string& text, Position& position) {
+    const std::vector<std::string> tokens = tokenize(text);
+    if (tokens.empty() || tokens[0][0] == '#' || tokens[0].find('/') == std::string::npos) return false;
+
+    std::size_t fields = 1;
+    if (fields < tokens.size() && (tokens[fields] == "w" || tokens[fields] == "b")) fields++;
+    for (int field = 0; field < 2 && fields < tokens.size() && isStateField(tokens[fields]); field++) fields++;
+    for (int field = 0; field < 2 && fields < tokens.size() && isNumber(tokens[fields]); field++) fields++;
+
+    position.fen = tokens[0];
+    for (std::size_t i = 1; i < fields; i++) position.fen += " " + tokens[i];
+
+    // the id operation of an EPD line, id "name";
+    position.id.clear();
+    const std::size_t id = text.find("id \"");
+    if (id != std::string::npos) {
+        const std::size_t end = text.find('"', id + 4);
+        if (end != std::string::npos) position.id = text.substr(id + 4, end - id - 4);
+    }
+
+    return true;
+}
+
+/**
+ * Escape a string for a JSON string value.
+ */
+static std::string jsonString(const std::string& text) {
+    std::string escaped = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) escaped += c;
+    }
+    return escaped + "\"";
+}
+
+/**
+ * Quote a string for a CSV field when it holds a separator or a quote.
+ */
+static std::string csvField(const std::string& text) {
+    if (text.find_first_of(",\"") == std::string::npos) return text;
+
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/**
+ * Write the result of a position as a line of the output.
+ */
+static void writeResult(std::ostream& out, bool csv, const Position& position, const std::string& bestMove, const SearchResult& result) {
+    if (csv) {
+        out << position.line << ',' << csvField(position.id) << ',' << csvField(position.fen) << ',' << bestMove << ','
+            << result.score << ',' << result.mateIn << ',' << result.depth << ',' << result.stats.nodes << ',' << result.time << '\n';
+        return;
+    }
+
+    out << "{\"line\":" << position.line << ",\"id\":" << jsonString(position.id) << ",\"fen\":" << jsonString(position.fen)
+        << ",\"bestmove\":\"" << bestMove << "\",\"score\":" << result.score << ",\"mate\":" << result.mateIn
+        << ",\"depth\":" << result.depth << ",\"nodes\":" << result.stats.nodes << ",\"time\":" << result.time << "}\n";
+}
+
+/**
+ * @struct Analysis
+ * The run shared by the workers: where they are in the file and the results waiting for their
+ * turn. Everything is guarded by the mutex.
+ */
+struct Analysis {
+    const char* next = nullptr;     ///< The start of the first line no worker has read yet.
+    const char* end = nullptr;      ///< The end of the file.
+    std::uint64_t lineNumber = 0;   ///< The lines read so far.
+    std::uint64_t positionIndex = 0; ///< The positions read so far, over every shard.
+    std::uint64_t shard = 0;
+    std::uint64_t shardCount = 1;
+
+    SearchLimits limits;
+    bool csv = false;
+    bool inFileOrder = true;
+    std::uint64_t maxAhead = RESULTS_AHEAD;
+    std::ostream* out = nullptr;
+
+    std::uint64_t taken = 0;        ///< The positions handed to the workers, numbered from 0.
+    std::uint64_t written = 0;      ///< In file order, the number of the next result to write.
+    std::map<std::uint64_t, std::string> waiting; ///< In file order, the results ahead of their turn.
+    std::uint64_t analysed = 0;
+    std::uint64_t invalid = 0;
+    std::chrono::steady_clock::time_point start;
+
+    std::mutex mutex;
+    std::condition_variable space;  ///< Signalled when a result is written in file order.
+};
+
+/**
+ * Read the lines of the file up to the next position of the shard.
+ *
+ * @param analysis The run, its mutex held.
+ * @param position Set to the position.
+ * @return False at the end of the file.
+ */
+static bool readPosition(Analysis& analysis, Position& position) {
+    while (analysis.next < analysis.end) {
+        const char* lineEnd = std::find(analysis.next, analysis.end, '\n');
+        const std::string line(analysis.next, lineEnd);
+        analysis.next = lineEnd + 1;
+
+        analysis.lineNumber++;
+        if (!parsePosition(line, position)) continue;
+        position.line = analysis.lineNumber;
+        if (analysis.positionIndex++ % analysis.shardCount == analysis.shard) return true;
+    }
+    return false;
+}
+
+/**
+ * Write the result of a position when it is its turn, and those waiting behind it.
+ *
+ * @param analysis The run, its mutex held.
+ * @param number The number of the position.
+ * @param text The lines of the result, empty for an invalid position.
+ */
+static void writeInTurn(Analysis& analysis, std::uint64_t number, std::string text) {
+    if (!analysis.inFileOrder) {
+        *analysis.out << text;
+        analysis.out->flush();
+        return;
+    }
+
+    analysis.waiting.emplace(number, std::move(text));
+    while (!analysis.waiting.empty() && analysis.waiting.begin()->first == analysis.written) {
+        *analysis.out << analysis.waiting.begin()->second;
+        analysis.waiting.erase(analysis.waiting.begin());
+        analysis.written++;
+    }
+    analysis.out->flush();
+    analysis.space.notify_all();
+}
+
+/**
+ * A worker, searches the positions it takes from the file with its own engine until the file
+ * ends.
+ *
+ * @param analysis The run.
+ */
+static void analyse(Analysis& analysis) {
+    Engine engine;
+    Position position;
+
+    for (;;) {
+        std::uint64_t number;
+        {
+            std::unique_lock<std::mutex> lock(analysis.mutex);
+            analysis.space.wait(lock, [&analysis] { return !analysis.inFileOrder || analysis.taken - analysis.written < analysis.maxAhead; });
+            if (!readPosition(analysis, position)) return;
+            number = analysis.taken++;
+        }
+
+        const std::vector<std::string> tokens = tokenize(position.fen);
+        const std::string fen = tokens.size() > 1 ? tokens[0] + " " + tokens[1] : tokens[0];
+        std::ostringstream text;
+
+        if (engine.setPosition(fen, std::vector<std::string>()) != Engine::PositionStatus::OK) {
+            std::lock_guard<std::mutex> lock(analysis.mutex);
+            std::cerr << "invalid position on line " << position.line << std::endl;
+            analysis.invalid++;
+            writeInTurn(analysis, number, std::string());
+            continue;
+        }
+
+        // every position is a game of its own, the move ordering of the last one means nothing here
+        engine.newGame();
+
+        const ChessBoard board = engine.getBoard();
+        if (MoveGeneration::generateColorsLegalMoves(&board, board.currPlayer).empty()) {
+            writeResult(text, analysis.csv, position, "0000", SearchResult());
+        }
+        else {
+            const SearchResult result = engine.search(analysis.limits);
+            writeResult(text, analysis.csv, position, Engine::moveToString(result.bestMove), result);
+        }
+
+        std::lock_guard<std::mutex> lock(analysis.mutex);
+        writeInTurn(analysis, number, text.str());
+
+        if (++analysis.analysed % PROGRESS_INTERVAL == 0) {
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - analysis.start).count();
+            std::cerr << "analysed " << analysis.analysed << " positions, " << static_cast<std::uint64_t>(analysis.analysed / std::max(seconds, 0.001)) << " per second" << std::endl;
+        }
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: Analyzer <epd file> [depth N] [nodes N] [movetime N] [workers N] [threads N] [hash MB] [evalfile path] [format jsonl|csv] [output path] [order file|done] [shard K/N]" << std::endl;
+        return 1;
+    }
+
+    Analysis analysis;
+    int threads = 1;
+    int workers = 0;
+    int hash = 64;
+    std::string outputPath;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const std::string name = argv[i];
+        const std::string value = argv[i + 1];
+
+        if (name == "depth") analysis.limits.depth = std::max(1, std::atoi(value.c_str()));
+        else if (name == "nodes") analysis.limits.nodes = std::strtoull(value.c_str(), nullptr, 10);
+        else if (name == "movetime") analysis.limits.moveTime = std::max(1, std::atoi(value.c_str()));
+        else if (name == "workers") workers = std::max(1, std::atoi(value.c_str()));
+        else if (name == "threads") threads = std::max(1, std::atoi(value.c_str()));
+        else if (name == "hash") hash = std::max(1, std::atoi(value.c_str()));
+        else if (name == "format") analysis.csv = value == "csv";
+        else if (name == "output") outputPath = value;
+        else if (name == "order") analysis.inFileOrder = value != "done";
+        else if (name == "evalfile") {
+            if (!Nnue::load(value)) std::cerr << "could not load network " << value << ", evaluating by material" << std::endl;
+        }
+        else if (name == "shard") {
+            const std::size_t slash = value.find('/');
+            analysis.shardCount = slash == std::string::npos ? 0 : std::strtoull(value.c_str() + slash + 1, nullptr, 10);
+            analysis.shard = std::strtoull(value.c_str(), nullptr, 10);
+            if (analysis.shardCount == 0 || analysis.shard < 1 || analysis.shard > analysis.shardCount) {
+                std::cerr << "shard must be K/N with 1 <= K <= N" << std::endl;
+                return 1;
+            }
+            analysis.shard--;
+        }
+        else {
+            std::cerr << "unknown argument " << name << std::endl;
+            return 1;
+        }
+    }
+    if (analysis.limits.depth == 0 && analysis.limits.nodes == 0 && analysis.limits.moveTime == 0) analysis.limits.depth = 10;
+
+    // by default the cores are shared out between the workers, each searching with the threads given
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (workers == 0) workers = std::max(1, cores / threads);
+
+    MappedFile file;
+    if (!file.open(argv[1])) {
+        std::cerr << "could not read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::ofstream outputFile;
+    if (!outputPath.empty()) {
+        outputFile.open(outputPath, std::ios::trunc);
+        if (!outputFile) {
+            std::cerr << "could not write " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    analysis.out = outputPath.empty() ? &std::cout : &outputFile;
+    if (analysis.csv) *analysis.out << "line,id,fen,bestmove,score,mate,depth,nodes,time\n";
+
+    // the workers' engines share the table, as the threads of a search do
+    BoardEvaluation::setThreadCount(threads);
+    BoardEvaluation::transpositionTable.resize(static_cast<std::size_t>(hash), workers * threads);
+
+    analysis.next = reinterpret_cast<const char*>(file.data());
+    analysis.end = analysis.next + file.size();
+    analysis.maxAhead = RESULTS_AHEAD * static_cast<std::uint64_t>(workers);
+    analysis.start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> pool;
+    for (int worker = 0; worker < workers; worker++) pool.emplace_back(analyse, std::ref(analysis));
+    for (std::thread& worker : pool) worker.join();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - analysis.start).count();
+    std::cerr << "analysed " << analysis.analysed << " positions in " << seconds << " seconds";
+    if (analysis.invalid > 0) std::cerr << ", " << analysis.invalid << " invalid";
+    std::cerr << std::endl;
+    return 0;
+}
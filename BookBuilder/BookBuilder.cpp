@@ -0,0 +1,427 @@
+/**
+ * @file BookBuilder.cpp
+ *
+ * A standalone tool turning PGN game collections into an opening book for the engine. The PGN
+ * file is memory mapped and split into chunks of whole games that the threads parse side by
+ * side, every thread counting the results of each book move in its own hash maps. The maps are
+ * sharded by position key, so the shards are merged in parallel as well and come out already
+ * in key order for the sorted book file.
+ *
+ * Usage: BookBuilder <pgn file> <book file> [max plies] [min games] [threads]
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MoveGeneration.h"
+#include "OpeningBook.h"
+
+using PieceType = ChessBoard::PieceType;
+
+// The shards of the hash maps, picked by the top bits of the position key.
+constexpr int SHARD_BITS = 6;
+constexpr int SHARD_COUNT = 1 << SHARD_BITS;
+
+// The chunks the PGN file is split into for every thread, more than one so the threads finish together.
+constexpr int CHUNKS_PER_THREAD = 16;
+
+/**
+ * @struct BookMove
+ * A move played from a position, the key the results are counted under.
+ */
+struct BookMove {
+    std::uint64_t position;
+    std::uint16_t move;
+
+    bool operator==(const BookMove& other) const { return position == other.position && move == other.move; }
+};
+
+struct BookMoveHash {
+    std::size_t operator()(const BookMove& bookMove) const {
+        return static_cast<std::size_t>(bookMove.position ^ (bookMove.move * 0x9e3779b97f4a7c15));
+    }
+};
+
+/**
+ * @struct MoveResults
+ * The results of the games a move was played in, from the side playing it.
+ */
+struct MoveResults {
+    std::uint32_t wins = 0;
+    std::uint32_t draws = 0;
+    std::uint32_t losses = 0;
+};
+
+using Shard = std::unordered_map<BookMove, MoveResults, BookMoveHash>;
+
+/**
+ * @struct ParseStats
+ * The games a thread has read.
+ */
+struct ParseStats {
+    std::uint64_t games = 0;    ///< Games found.
+    std::uint64_t used = 0;     ///< Games whose moves went into the book.
+    std::uint64_t moves = 0;    ///< Moves counted.
+};
+
+
+/**
+ * Set up the starting position, the pieces placed through setPiece so the board's bitboards
+ * are complete for the move generator and the book keys.
+ */
+static void setStartPosition(ChessBoard& board) {
+    const PieceType backRank[8] = { PieceType::WHITE_ROOK, PieceType::WHITE_KNIGHT, PieceType::WHITE_BISHOP, PieceType::WHITE_KING,
+        PieceType::WHITE_QUEEN, PieceType::WHITE_BISHOP, PieceType::WHITE_KNIGHT, PieceType::WHITE_ROOK };
+
+    board.clearBoard();
+    board.currPlayer = true;
+
+    // files are counted from h, so the king is on index 3
+    for (int file = 0; file < 8; file++) {
+        const PieceType black = static_cast<PieceType>(static_cast<int>(backRank[file]) + 6);
+        board.setPiece(backRank[file], 0, file);
+        board.setPiece(PieceType::WHITE_PAWN, 1, file);
+        board.setPiece(PieceType::BLACK_PAWN, 6, file);
+        board.setPiece(black, 7, file);
+    }
+}
+
+
+/**
+ * Find the legal move a SAN token describes, such as "e4", "Nbd7", "exd5" or "R1e2+". Castling,
+ * promotions and en passant aren't played by the engine, a game stops being read at them.
+ *
+ * @param board The position the move is played in.
+ * @param whiteToMove The side playing the move.
+ * @param san The move in standard algebraic notation.
+ * @param move Set to the move found.
+ * @return True if exactly one legal move matches.
+ */
+static bool parseSan(const ChessBoard& board, bool whiteToMove, std::string san, ChessMove& move) {
+    while (!san.empty() && std::strchr("+#!?", san.back()) != nullptr) san.pop_back();
+    if (san.size() < 2 || san[0] == 'O' || san[0] == '0' || san.find('=') != std::string::npos) return false;
+
+    // the piece letter, KQRBN or none for a pawn, in the engine's piece order
+    const char* pieceLetters = "PRNBQK";
+    int kind = 0;
+    std::size_t begin = 0;
+    if (std::isupper(static_cast<unsigned char>(san[0]))) {
+        const char* letter = std::strchr(pieceLetters, san[0]);
+        if (letter == nullptr) return false;
+        kind = static_cast<int>(letter - pieceLetters);
+        begin = 1;
+    }
+
+    const std::size_t end = san.size() - 2;
+    const char toFile = san[end];
+    const char toRank = san[end + 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') return false;
+    const int to = (toRank - '1') * 8 + (7 - (toFile - 'a'));
+
+    // what is left between the piece and the square narrows down the piece that moves
+    char fromFile = 0;
+    char fromRank = 0;
+    for (std::size_t i = begin; i < end; i++) {
+        if (san[i] >= 'a' && san[i] <= 'h') fromFile = san[i];
+        else if (san[i] >= '1' && san[i] <= '8') fromRank = san[i];
+        else if (san[i] != 'x') return false;
+    }
+
+    const PieceType piece = static_cast<PieceType>(kind + (whiteToMove ? 0 : 6));
+    const std::uint64_t pieces = board.getPieceBitboard(piece);
+    int matches = 0;
+
+    for (const ChessMove& candidate : MoveGeneration::generateColorsLegalMoves(&board, whiteToMove)) {
+        if (candidate.toSquare != to || ((pieces >> candidate.fromSquare) & 1) == 0) continue;
+        if (fromFile != 0 && 7 - candidate.fromSquare % 8 != fromFile - 'a') continue;
+        if (fromRank != 0 && candidate.fromSquare / 8 != fromRank - '1') continue;
+
+        move = candidate;
+        matches++;
+    }
+
+    return matches == 1;
+}
+
+
+/**
+ * Read the value of a PGN tag line, for example "1-0" from [Result "1-0"].
+ */
+static std::string tagValue(const char* line, const char* lineEnd) {
+    const char* open = std::find(line, lineEnd, '"');
+    if (open == lineEnd) return "";
+    const char* close = std::find(open + 1, lineEnd, '"');
+    return std::string(open + 1, close);
+}
+
+
+/**
+ * Count the moves of one game. Only games with a result that start from the normal starting
+ * position are used, and a game is read until maxPlies or the first move the engine can't play.
+ *
+ * @param game The first character of the game.
+ * @param gameEnd One past the last character of the game.
+ * @param maxPlies The most plies of a game to count.
+ * @param shards The hash maps the moves are counted in.
+ * @param stats The counters of the thread.
+ */
+static void readGame(const char* game, const char* gameEnd, int maxPlies, std::vector<Shard>& shards, ParseStats& stats) {
+    std::string result;
+    bool hasSetUp = false;
+    const char* text = game;
+
+    // the tag section, a line per tag
+    while (text < gameEnd) {
+        while (text < gameEnd && std::isspace(static_cast<unsigned char>(*text))) text++;
+        if (text == gameEnd || *text != '[') break;
+
+        const char* lineEnd = std::find(text, gameEnd, '\n');
+        const std::string tag(text, std::min(lineEnd, text + 8));
+        if (tag.compare(0, 8, "[Result ") == 0) result = tagValue(text, lineEnd);
+        if (tag.compare(0, 5, "[FEN ") == 0) hasSetUp = true;
+        text = lineEnd;
+    }
+
+    stats.games++;
+
+    // results are counted from the side playing the move, 0 for a white win, 1 for a draw, 2 for a black win
+    int outcome;
+    if (result == "1-0") outcome = 0;
+    else if (result == "1/2-1/2") outcome = 1;
+    else if (result == "0-1") outcome = 2;
+    else return;
+    if (hasSetUp) return;
+
+    ChessBoard board;
+    setStartPosition(board);
+    bool whiteToMove = true;
+    int ply = 0;
+
+    while (text < gameEnd && ply < maxPlies) {
+        const char c = *text;
+
+        // comments, variations and annotation glyphs don't change the game
+        if (std::isspace(static_cast<unsigned char>(c))) { text++; continue; }
+        if (c == '{') { text = std::find(text, gameEnd, '}'); continue; }
+        if (c == ';') { text = std::find(text, gameEnd, '\n'); continue; }
+        if (c == '}' || c == ')') { text++; continue; }
+        if (c == '(') {
+            int nesting = 0;
+            for (; text < gameEnd; text++) {
+                if (*text == '(') nesting++;
+                if (*text == ')' && --nesting == 0) break;
+            }
+            continue;
+        }
+
+        const char* tokenEnd = text;
+        while (tokenEnd < gameEnd && !std::isspace(static_cast<unsigned char>(*tokenEnd)) && std::strchr("{}();", *tokenEnd) == nullptr) tokenEnd++;
+        std::string token(text, tokenEnd);
+        text = tokenEnd;
+
+        if (token[0] == '$') continue;
+        if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") break;
+
+        // move numbers, "12." or "12...", may be written against the move
+        const std::size_t moveStart = token.find_first_not_of("0123456789.");
+        if (moveStart == std::string::npos) continue;
+        token.erase(0, moveStart);
+
+        ChessMove move;
+        if (!parseSan(board, whiteToMove, token, move)) break;
+
+        const BookMove bookMove = { OpeningBook::positionKey(&board, whiteToMove), OpeningBook::encodeMove(move) };
+        MoveResults& results = shards[bookMove.position >> (64 - SHARD_BITS)][bookMove];
+        const int moverOutcome = whiteToMove ? outcome : 2 - outcome;
+        if (moverOutcome == 0) results.wins++;
+        else if (moverOutcome == 1) results.draws++;
+        else results.losses++;
+
+        board.makeMove(move.fromSquare, move.toSquare);
+        whiteToMove = !whiteToMove;
+        ply++;
+        stats.moves++;
+    }
+
+    stats.used++;
+}
+
+
+/**
+ * Find where the next game starts, the first "[Event " at the start of a line at or after a point
+ * past the start of the file.
+ */
+static const char* nextGame(const char* text, const char* fileEnd) {
+    static const char tag[] = "[Event ";
+    for (; text < fileEnd; text++) {
+        text = std::find(text, fileEnd, '[');
+        if (text == fileEnd) break;
+
+        if (text[-1] == '\n' && static_cast<std::size_t>(fileEnd - text) >= sizeof(tag) - 1 && std::memcmp(text, tag, sizeof(tag) - 1) == 0) return text;
+    }
+    return fileEnd;
+}
+
+
+/**
+ * Turn the counted moves of one shard into book entries, sorted by key and best move first. A
+ * move is weighted by its score from the side playing it, two points a win and one a draw, and
+ * the weights of a position are scaled down together when they would overflow.
+ *
+ * @param shards The shard of every thread to merge.
+ * @param minGames The fewest games a move must have been played in.
+ * @return The entries of the shard.
+ */
+static std::vector<OpeningBook::Entry> mergeShard(const std::vector<const Shard*>& shards, std::uint32_t minGames) {
+    Shard merged;
+    for (const Shard* shard : shards) {
+        for (const auto& counted : *shard) {
+            MoveResults& results = merged[counted.first];
+            results.wins += counted.second.wins;
+            results.draws += counted.second.draws;
+            results.losses += counted.second.losses;
+        }
+    }
+
+    std::vector<std::pair<OpeningBook::Entry, std::uint64_t>> scored;
+    for (const auto& counted : merged) {
+        const MoveResults& results = counted.second;
+        const std::uint32_t games = results.wins + results.draws + results.losses;
+        const std::uint64_t score = 2 * static_cast<std::uint64_t>(results.wins) + results.draws;
+        if (games < minGames || score == 0) continue;
+
+        OpeningBook::Entry entry;
+        entry.key = counted.first.position;
+        entry.move = OpeningBook::decodeMove(counted.first.move);
+        entry.learn = games;
+        scored.push_back(std::make_pair(entry, score));
+    }
+
+    std::sort(scored.begin(), scored.end(), [](const std::pair<OpeningBook::Entry, std::uint64_t>& a, const std::pair<OpeningBook::Entry, std::uint64_t>& b) {
+        if (a.first.key != b.first.key) return a.first.key < b.first.key;
+        if (a.second != b.second) return a.second > b.second;
+        return OpeningBook::encodeMove(a.first.move) < OpeningBook::encodeMove(b.first.move);
+    });
+
+    std::vector<OpeningBook::Entry> entries;
+    for (std::size_t first = 0; first < scored.size();) {
+        // the best move comes first, the weights of its position are scaled to it
+        const std::uint64_t best = scored[first].second;
+        std::size_t i = first;
+        for (; i < scored.size() && scored[i].first.key == scored[first].first.key; i++) {
+            OpeningBook::Entry entry = scored[i].first;
+            entry.weight = static_cast<std::uint16_t>(best <= 0xFFFF ? scored[i].second : std::max<std::uint64_t>(1, scored[i].second * 0xFFFF / best));
+            entries.push_back(entry);
+        }
+        first = i;
+    }
+
+    return entries;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "usage: BookBuilder <pgn file> <book file> [max plies] [min games] [threads]" << std::endl;
+        return 1;
+    }
+
+    const int maxPlies = argc > 3 ? std::max(1, std::atoi(argv[3])) : 30;
+    const std::uint32_t minGames = argc > 4 ? static_cast<std::uint32_t>(std::max(1, std::atoi(argv[4]))) : 1;
+    const int threads = argc > 5 ? std::max(1, std::atoi(argv[5])) : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    MappedFile pgn;
+    if (!pgn.open(argv[1])) {
+        std::cout << "could not read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const char* fileStart = reinterpret_cast<const char*>(pgn.data());
+    const char* fileEnd = fileStart + pgn.size();
+
+    // chunk boundaries moved forward to the next game, so every game is read by exactly one thread
+    const int chunkCount = threads * CHUNKS_PER_THREAD;
+    std::vector<const char*> boundaries;
+    for (int chunk = 0; chunk < chunkCount; chunk++) boundaries.push_back(chunk == 0 ? fileStart : nextGame(fileStart + 1 + (pgn.size() - 1) * chunk / chunkCount, fileEnd));
+    boundaries.push_back(fileEnd);
+
+    std::vector<std::vector<Shard>> threadShards(threads, std::vector<Shard>(SHARD_COUNT));
+    std::vector<ParseStats> threadStats(threads);
+    std::atomic<int> nextChunk(0);
+    std::vector<std::thread> pool;
+
+    for (int thread = 0; thread < threads; thread++) {
+        pool.emplace_back([&, thread]() {
+            for (int chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+                for (const char* game = boundaries[chunk]; game < boundaries[chunk + 1];) {
+                    const char* gameEnd = nextGame(game + 1, boundaries[chunk + 1]);
+                    readGame(game, gameEnd, maxPlies, threadShards[thread], threadStats[thread]);
+                    game = gameEnd;
+                }
+            }
+        });
+    }
+    for (std::thread& worker : pool) worker.join();
+    pool.clear();
+
+    // each shard holds a range of keys, merging them in order gives the sorted book
+    std::vector<std::vector<OpeningBook::Entry>> shardEntries(SHARD_COUNT);
+    std::atomic<int> nextShard(0);
+    for (int thread = 0; thread < threads; thread++) {
+        pool.emplace_back([&]() {
+            for (int shard = nextShard++; shard < SHARD_COUNT; shard = nextShard++) {
+                std::vector<const Shard*> shards;
+                for (const std::vector<Shard>& ownShards : threadShards) shards.push_back(&ownShards[shard]);
+                shardEntries[shard] = mergeShard(shards, minGames);
+            }
+        });
+    }
+    for (std::thread& worker : pool) worker.join();
+
+    std::ofstream book(argv[2], std::ios::binary | std::ios::trunc);
+    std::uint64_t entryCount = 0;
+    std::uint64_t positionCount = 0;
+    for (const std::vector<OpeningBook::Entry>& entries : shardEntries) {
+        std::vector<std::uint8_t> bytes(entries.size() * OpeningBook::entrySize);
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            OpeningBook::writeEntry(entries[i], bytes.data() + i * OpeningBook::entrySize);
+            if (i == 0 || entries[i].key != entries[i - 1].key) positionCount++;
+        }
+        book.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        entryCount += entries.size();
+    }
+
+    if (!book) {
+        std::cout << "could not write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    ParseStats total;
+    for (const ParseStats& stats : threadStats) {
+        total.games += stats.games;
+        total.used += stats.used;
+        total.moves += stats.moves;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "games " << total.games << ", used " << total.used << ", moves " << total.moves << std::endl;
+    std::cout << "book " << positionCount << " positions, " << entryCount << " entries" << std::endl;
+    std::cout << seconds << " s, " << static_cast<std::uint64_t>(total.games * 60 / std::max(seconds, 0.001)) << " games/min on " << threads << " threads" << std::endl;
+
+    return 0;
+}
@@ -12,7 +12,15 @@
 
 #include "BoardEvaluation.h"
 #include "MoveGeneration.h"
+#include "ChessData.h"
 #include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <mutex>
 
 constexpr int PAWN_VALUE = 100;
 constexpr int ROOK_VALUE = 500;
@@ -20,6 +28,150 @@ constexpr int KNIGHT_VALUE = 300;
 constexpr int BISHOP_VALUE = 300;
 constexpr int QUEEN_VALUE = 800;
 
+// Piece values indexed by ChessBoard::PieceType (white then black), used for move ordering.
+constexpr int PIECE_VALUES[12] = {
+	PAWN_VALUE, ROOK_VALUE, KNIGHT_VALUE, BISHOP_VALUE, QUEEN_VALUE, 0,
+	PAWN_VALUE, ROOK_VALUE, KNIGHT_VALUE, BISHOP_VALUE, QUEEN_VALUE, 0
+};
+
+// Terms that combine the cached pawn structure with the pieces, in centipawns.
+constexpr int SHIELD_NEAR_BONUS = 10;
+constexpr int SHIELD_FAR_BONUS = 5;
+constexpr int FREE_PASSED_PAWN_BONUS = 20;
+constexpr int KNIGHT_OUTPOST_BONUS = 20;
+
+// Mobility, per square a piece attacks that holds no own piece and no enemy pawn guards, and the
+// weight of each square of the enemy king zone a piece attacks. Both indexed by piece type, white.
+constexpr int MOBILITY_WEIGHT[6] = { 0, 2, 4, 4, 1, 0 };
+constexpr int KING_ATTACK_WEIGHT[6] = { 0, 3, 2, 2, 5, 0 };
+constexpr int KING_ATTACK_MAX_PENALTY = 400;
+
+// The king is worth more than everything else together in an exchange, it can only take last.
+constexpr int SEE_KING_VALUE = 20000;
+
+// The pieces of each color from least to most valuable, the order pieces recapture in.
+constexpr ChessBoard::PieceType EXCHANGE_ORDER[2][6] = {
+	{ ChessBoard::PieceType::BLACK_PAWN, ChessBoard::PieceType::BLACK_KNIGHT, ChessBoard::PieceType::BLACK_BISHOP,
+	  ChessBoard::PieceType::BLACK_ROOK, ChessBoard::PieceType::BLACK_QUEEN, ChessBoard::PieceType::BLACK_KING },
+	{ ChessBoard::PieceType::WHITE_PAWN, ChessBoard::PieceType::WHITE_KNIGHT, ChessBoard::PieceType::WHITE_BISHOP,
+	  ChessBoard::PieceType::WHITE_ROOK, ChessBoard::PieceType::WHITE_QUEEN, ChessBoard::PieceType::WHITE_KING }
+};
+
+// Selective search tuning, margins are in centipawns.
+constexpr int NULL_MOVE_MIN_DEPTH = 3;
+constexpr int NULL_MOVE_VERIFY_DEPTH = 8;
+constexpr int LMR_MIN_DEPTH = 3;
+constexpr int LMR_MIN_MOVES = 3;
+constexpr int FUTILITY_MAX_DEPTH = 3;
+constexpr int FUTILITY_MARGIN[FUTILITY_MAX_DEPTH + 1] = { 0, 200, 350, 500 };
+constexpr int RAZOR_MAX_DEPTH = 2;
+constexpr int RAZOR_MARGIN[RAZOR_MAX_DEPTH + 1] = { 0, 300, 550 };
+constexpr int LMP_MAX_DEPTH = 3;
+
+// Move ordering, the hash move first, then winning and even captures, killers, quiet moves by
+// history and last the captures that lose material.
+constexpr int HASH_MOVE_SCORE = 4000000;
+constexpr int CAPTURE_SCORE = 3000000;
+constexpr int KILLER_SCORE = 2000000;
+constexpr int HISTORY_MAX = 1000000;
+constexpr int LOSING_CAPTURE_SCORE = -1000000;
+
+// Helper threads skip iterations so they spread over different depths, indexed by (thread - 1) % 20.
+constexpr int SKIP_SIZE[20] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+constexpr int SKIP_PHASE[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+// Nodes between two checks of the stop flag, this bounds how long a stop takes to be seen.
+constexpr std::uint64_t STOP_CHECK_INTERVAL = 256;
+
+SearchOptions BoardEvaluation::options;
+TranspositionTable BoardEvaluation::transpositionTable;
+int BoardEvaluation::threadCount = 1;
+int BoardEvaluation::multiPv = 1;
+int BoardEvaluation::probeDepth = 1;
+
+
+/**
+ * Get the time on a monotonic clock.
+ *
+ * @return The time in milliseconds.
+ */
+static std::int64_t currentTimeMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * Sum the nodes visited by all threads of a search so far.
+ *
+ * @param state The search.
+ * @return The number of nodes.
+ */
+static std::uint64_t totalNodes(const SearchState& state) {
+	std::uint64_t nodes = 0;
+	for (const std::unique_ptr<SearchContext>& context : state.contexts) nodes += context->nodes.load(std::memory_order_relaxed);
+	return nodes;
+}
+
+
+/**
+ * Check if the limits of the running search are reached. While pondering or in an infinite
+ * search they never are, the search goes on until it is stopped.
+ *
+ * @param context The search state of the main thread.
+ * @return True if the search should end.
+ */
+static bool searchLimitReached(const SearchContext& context) {
+	const SearchState& state = *context.search;
+	const SearchLimits& limits = state.limits;
+
+	if (state.ponder.load(std::memory_order_relaxed) || limits.infinite) return false;
+	if (limits.depth > 0 && context.completedDepth >= limits.depth) return true;
+	if (limits.moveTime > 0 && currentTimeMs() - state.startTime.load(std::memory_order_relaxed) >= limits.moveTime) return true;
+	if (limits.nodes > 0 && totalNodes(state) >= limits.nodes) return true;
+	if (limits.mate > 0 && context.bestMateIn > 0 && context.bestMateIn <= limits.mate) return true;
+	return false;
+}
+
+/**
+ * Add the counters of another thread to these.
+ *
+ * @param other The counters to add.
+ * @return These counters.
+ */
+SearchStats& SearchStats::operator+=(const SearchStats& other) {
+	nodes += other.nodes;
+	qNodes += other.qNodes;
+	selDepth = std::max(selDepth, other.selDepth);
+	tableProbes += other.tableProbes;
+	tableHits += other.tableHits;
+	betaCutoffs += other.betaCutoffs;
+	firstMoveCutoffs += other.firstMoveCutoffs;
+	nullMoveTries += other.nullMoveTries;
+	nullMoveCutoffs += other.nullMoveCutoffs;
+	lmrSearches += other.lmrSearches;
+	lmrResearches += other.lmrResearches;
+	pawnProbes += other.pawnProbes;
+	pawnHits += other.pawnHits;
+	evalProbes += other.evalProbes;
+	evalHits += other.evalHits;
+	tablebaseHits += other.tablebaseHits;
+	return *this;
+}
+
+
+/**
+ * Sum the tablebase hits of all threads of a search so far.
+ *
+ * @param state The search.
+ * @return The number of hits.
+ */
+static std::uint64_t totalTablebaseHits(const SearchState& state) {
+	std::uint64_t hits = 0;
+	for (const std::unique_ptr<SearchContext>& context : state.contexts) hits += context->tablebaseHits.load(std::memory_order_relaxed);
+	return hits;
+}
+
+
 /**
  * Calculate the Hamming distance (number of set bits) in a 64-bit integer.
  *
@@ -39,33 +191,478 @@ std::uint8_t hammingDistance(std::uint64_t n) {
 
 
 /**
- * Evaluate the chessboard position for a given player. Currently this evaluation
- * function simpily applies a piece value summation. This will be improved in the
- * future when I have more time.
- * 
+ * Build the late move reduction table, the reduction grows with the log of both the remaining
+ * depth and how late the move comes in the ordering.
+ *
+ * @return The table of reductions indexed by [depth][moveNumber].
+ */
+static std::vector<std::vector<std::uint8_t>> buildReductionTable() {
+	std::vector<std::vector<std::uint8_t>> table(64, std::vector<std::uint8_t>(64, 0));
+
+	for (int depth = 1; depth < 64; depth++) {
+		for (int moveNumber = 1; moveNumber < 64; moveNumber++) {
+			table[depth][moveNumber] = static_cast<std::uint8_t>(0.75 + std::log(depth) * std::log(moveNumber) / 2.25);
+		}
+	}
+
+	return table;
+}
+
+static const std::vector<std::vector<std::uint8_t>> reductionTable = buildReductionTable();
+
+
+/**
+ * Sum the material of a player's pieces, the king is not counted.
+ *
  * @param board A pointer to the ChessBoard object representing the current board state.
  * @param color A boolean indicating the player's color (true for white, false for black).
- * @return The evaluation score for the player's position on the board.
+ * @return The material total of the player in centipawns.
  */
-std::int32_t eval(const ChessBoard* board, bool color) {
+static std::int32_t materialCount(const ChessBoard* board, bool color) {
 	const std::uint64_t pawns = color ? board->whitePawns : board->blackPawns;
 	const std::uint64_t rooks = color ? board->whiteRooks : board->blackRooks;
 	const std::uint64_t knights = color ? board->whiteKnights : board->blackKnights;
 	const std::uint64_t bishops = color ? board->whiteBishops : board->blackBishops;
 	const std::uint64_t queens = color ? board->whiteQueens : board->blackQueens;
 
-	const std::uint8_t numPawns = hammingDistance(pawns);
-	const std::uint8_t numRook = hammingDistance(rooks);
-	const std::uint8_t numKinghts = hammingDistance(knights);
-	const std::uint8_t numBishops = hammingDistance(bishops);
-	const std::uint8_t numQueens = hammingDistance(queens);
+	return hammingDistance(pawns) * PAWN_VALUE + hammingDistance(rooks) * ROOK_VALUE + hammingDistance(knights) * KNIGHT_VALUE
+		+ hammingDistance(bishops) * BISHOP_VALUE + hammingDistance(queens) * QUEEN_VALUE;
+}
+
+
+/**
+ * Check whether a player has any piece other than pawns and the king. Null moves are unsafe
+ * without one, as pawn endings are full of zugzwang.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param color A boolean indicating the player's color (true for white, false for black).
+ * @return True if the player has a knight, bishop, rook or queen.
+ */
+static bool hasNonPawnMaterial(const ChessBoard* board, bool color) {
+	if (color) return (board->whiteRooks | board->whiteKnights | board->whiteBishops | board->whiteQueens) != 0;
+	return (board->blackRooks | board->blackKnights | board->blackBishops | board->blackQueens) != 0;
+}
+
+
+/**
+ * A legal move with its move ordering score.
+ */
+struct ScoredMove {
+	ChessMove move;
+	int score;
+	bool isCapture;
+};
+
+
+/**
+ * Score a capture most valuable victim / least valuable attacker.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param move The move to score.
+ * @return The MVV-LVA score, or -1 if the move is not a capture.
+ */
+static int captureScore(const ChessBoard* board, const ChessMove& move) {
+	const ChessBoard::PieceType victim = board->getPieceTypeAtSquare(move.toSquare / 8, move.toSquare % 8);
+	if (victim == ChessBoard::PieceType::EMPTY) return -1;
+
+	const ChessBoard::PieceType attacker = board->getPieceTypeAtSquare(move.fromSquare / 8, move.fromSquare % 8);
+	return 10 * PIECE_VALUES[static_cast<int>(victim)] - PIECE_VALUES[static_cast<int>(attacker)] + QUEEN_VALUE;
+}
+
+
+/**
+ * Get the value of a piece in an exchange.
+ *
+ * @param piece The piece type, not EMPTY.
+ * @return The value in centipawns.
+ */
+static int exchangeValue(ChessBoard::PieceType piece) {
+	if (piece == ChessBoard::PieceType::WHITE_KING || piece == ChessBoard::PieceType::BLACK_KING) return SEE_KING_VALUE;
+	return PIECE_VALUES[static_cast<int>(piece)];
+}
+
+
+/**
+ * Check whether a capture can lose material, which is only possible when the capturing piece
+ * is worth more than its victim. Cheaper than calling staticExchange on every capture.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param move The capture.
+ * @return True if the capture loses material.
+ */
+static bool isLosingCapture(const ChessBoard* board, const ChessMove& move) {
+	const ChessBoard::PieceType victim = board->getPieceTypeAtSquare(move.toSquare / 8, move.toSquare % 8);
+	const ChessBoard::PieceType attacker = board->getPieceTypeAtSquare(move.fromSquare / 8, move.fromSquare % 8);
+
+	if (exchangeValue(attacker) <= PIECE_VALUES[static_cast<int>(victim)]) return false;
+	return BoardEvaluation::staticExchange(board, move) < 0;
+}
+
+
+/**
+ * Order moves so the most promising are searched first, which is what makes reducing and
+ * pruning the late moves safe. The hash move goes first, then captures that don't lose material,
+ * the killer moves of this ply, the remaining quiet moves by their history score and last the
+ * captures that static exchange evaluation says lose material.
+ *
+ * @param context The search state of the thread running the search.
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param moves The legal moves to order.
+ * @param hashMove The best move stored in the transposition table, if any.
+ * @param ply The distance from the root of the search.
+ * @param currPlayer A boolean indicating the current player's color (true for white, false for black).
+ * @return The moves with their scores, best first.
+ */
+static std::vector<ScoredMove> orderMoves(const SearchContext& context, const ChessBoard* board, const std::vector<ChessMove>& moves,
+	const ChessMove& hashMove, int ply, bool currPlayer) {
+
+	std::vector<ScoredMove> scored;
+	scored.reserve(moves.size());
+
+	for (const ChessMove& move : moves) {
+		const int capture = captureScore(board, move);
+		int score;
+
+		if (move == hashMove) score = HASH_MOVE_SCORE;
+		else if (capture >= 0) score = (isLosingCapture(board, move) ? LOSING_CAPTURE_SCORE : CAPTURE_SCORE) + capture;
+		else if (move == context.killers[ply][0]) score = KILLER_SCORE + 1;
+		else if (move == context.killers[ply][1]) score = KILLER_SCORE;
+		else score = context.history[currPlayer][move.fromSquare][move.toSquare];
+
+		scored.push_back({ move, score, capture >= 0 });
+	}
+
+	std::stable_sort(scored.begin(), scored.end(), [](const ScoredMove& a, const ScoredMove& b) {
+		return a.score > b.score;
+	});
+
+	return scored;
+}
+
+
+/**
+ * Remember a quiet move that caused a beta cut-off, as a killer for its ply and in the history table.
+ *
+ * @param context The search state of the thread running the search.
+ * @param move The quiet move that caused the cut-off.
+ * @param depth The depth of the node, deeper cut-offs weigh more.
+ * @param ply The distance from the root of the search.
+ * @param currPlayer A boolean indicating the current player's color (true for white, false for black).
+ */
+static void updateQuietStats(SearchContext& context, const ChessMove& move, int depth, int ply, bool currPlayer) {
+	if (!(context.killers[ply][0] == move)) {
+		context.killers[ply][1] = context.killers[ply][0];
+		context.killers[ply][0] = move;
+	}
+
+	int& history = context.history[currPlayer][move.fromSquare][move.toSquare];
+	history = std::min(history + depth * depth, HISTORY_MAX);
+}
+
+
+/**
+ * Check if the search has to end, the shared stop flag and the limits are only read every few
+ * nodes. A thread always finishes its first iteration so there is a move to play.
+ *
+ * @param context The search state of the thread running the search.
+ * @return True once the thread has been told to stop.
+ */
+static bool shouldStop(SearchContext& context) {
+	// only this thread writes its node count, a plain store keeps the increment cheap
+	const std::uint64_t nodes = context.nodes.load(std::memory_order_relaxed) + 1;
+	context.nodes.store(nodes, std::memory_order_relaxed);
+
+	if (nodes % STOP_CHECK_INTERVAL == 0 && context.completedDepth > 0) {
+		if ((context.stop != nullptr && context.stop->load(std::memory_order_relaxed))
+			|| (context.isMainThread && searchLimitReached(context))) {
+			context.aborted = true;
+		}
+	}
+	return context.aborted;
+}
+
 
+/**
+ * Check if the position at a ply repeats an earlier one with the same side to move, in the
+ * current line or in the game before the root. Only every other ply can match, and a null
+ * move ends the scan as positions across it were never really played.
+ *
+ * @param context The search state of the thread running the search.
+ * @param ply The distance of the position from the root, its key is in pathKeys[ply].
+ * @return True if the position is a repetition.
+ */
+static bool isRepetition(const SearchContext& context, int ply) {
+	const std::uint64_t key = context.pathKeys[ply];
+
+	for (int i = ply - 2; i >= 0; i -= 2) {
+		if (context.nullMoves[i] || context.nullMoves[i + 1]) return false;
+		if (context.pathKeys[i] == key) return true;
+	}
+
+	// the last game key is one ply before the root, take the ones an even distance away
+	const std::vector<std::uint64_t>& gameKeys = context.gameKeys;
+	for (std::ptrdiff_t i = static_cast<std::ptrdiff_t>(gameKeys.size()) - (ply % 2 == 0 ? 2 : 1); i >= 0; i -= 2) {
+		if (gameKeys[i] == key) return true;
+	}
+
+	return false;
+}
+
+
+/**
+ * Convert a score to how it is stored in the transposition table, mate scores are made relative
+ * to the node instead of the root so they stay correct wherever the position is reached.
+ */
+static int scoreToTable(int score, int ply, int mateBound) {
+	if (score >= mateBound) return score + ply;
+	if (score <= -mateBound) return score - ply;
+	return score;
+}
+
+
+/**
+ * Convert a score stored in the transposition table back to a score relative to the root.
+ */
+static int scoreFromTable(int score, int ply, int mateBound) {
+	if (score >= mateBound) return score - ply;
+	if (score <= -mateBound) return score + ply;
+	return score;
+}
+
+
+/**
+ * Evaluate the chessboard position for a given player. Currently this evaluation
+ * function simpily applies a piece value summation. This will be improved in the
+ * future when I have more time.
+ * 
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param color A boolean indicating the player's color (true for white, false for black).
+ * @return The evaluation score for the player's position on the board.
+ */
+std::int32_t eval(const ChessBoard* board, bool color) {
 	// Check for a stalemate or checkmate
 	if (MoveGeneration::generateColorsLegalMoves(board, color).size() == 0) return std::numeric_limits<int32_t>::min();
 	if (MoveGeneration::generateColorsLegalMoves(board, !color).size() == 0) return std::numeric_limits<int32_t>::max();
 
 	// Calculate and return the position evaluation score based on piece values.
-	return numPawns * PAWN_VALUE + numRook * ROOK_VALUE + numKinghts * KNIGHT_VALUE + numBishops * BISHOP_VALUE + numQueens * QUEEN_VALUE;
+	return materialCount(board, color);
+}
+
+
+/**
+ * Evaluate the terms built on the pawn structure: the cached pawn terms, the pawn shield in
+ * front of a king still on its first two ranks, passed pawns with nothing in their way, and
+ * knights in the enemy half on squares no enemy pawn can ever attack.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param pawns The evaluated pawn structure of the board.
+ * @return The score from white's point of view.
+ */
+static int pawnStructureEval(const ChessBoard* board, const PawnEntry& pawns) {
+	using namespace data::masks;
+
+	int score = pawns.score;
+	const std::uint64_t occupied = board->getAllPieces();
+
+	for (int color = 0; color < 2; color++) {
+		const bool isWhite = color == 1;
+		const std::uint64_t ownPawns = isWhite ? board->whitePawns : board->blackPawns;
+		const std::uint64_t king = isWhite ? board->whiteKing : board->blackKing;
+		const std::uint64_t knights = isWhite ? board->whiteKnights : board->blackKnights;
+		int colorScore = 0;
+
+		for (int square = 0; square < 64; square++) {
+			const std::uint64_t bit = (std::uint64_t)1 << square;
+			const int rank = square / 8;
+			const int relativeRank = isWhite ? rank : 7 - rank;
+
+			if ((king & bit) != 0 && relativeRank <= 1) {
+				const std::uint64_t files = fileMask[square % 8] | adjacentFileMask[square % 8];
+				colorScore += SHIELD_NEAR_BONUS * hammingDistance(ownPawns & files & rankMask[isWhite ? rank + 1 : rank - 1]);
+				colorScore += SHIELD_FAR_BONUS * hammingDistance(ownPawns & files & rankMask[isWhite ? rank + 2 : rank - 2]);
+			}
+
+			if ((pawns.passedPawns[color] & bit) != 0 && (pawnMasks.forwardFile[color][square] & occupied) == 0) {
+				colorScore += FREE_PASSED_PAWN_BONUS;
+			}
+
+			if ((knights & bit) != 0 && relativeRank >= 4 && (pawns.attackSpans[!color] & bit) == 0) {
+				colorScore += KNIGHT_OUTPOST_BONUS;
+			}
+		}
+
+		score += isWhite ? colorScore : -colorScore;
+	}
+
+	return score;
+}
+
+
+/**
+ * Evaluate mobility and king safety from the attacks of the position. A king is in danger once two
+ * or more enemy pieces bear on its zone, and the danger grows with the square of the attack weight,
+ * so a lone attacker costs nothing while a queen and a rook together cost a lot.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param attacks The attacks of the board.
+ * @return The score from white's point of view.
+ */
+static int pieceActivityEval(const ChessBoard* board, const AttackInfo& attacks) {
+	int score = 0;
+
+	for (int color = 0; color < 2; color++) {
+		const bool isWhite = color == 1;
+		const int firstType = isWhite ? 0 : 6;
+		const std::uint64_t ownPieces = isWhite ? board->getAllWhitePieces() : board->getAllBlackPieces();
+		const std::uint64_t enemyPawnAttacks = attacks.byPieceType[isWhite ? 6 : 0];
+		const std::uint64_t enemyKingZone = attacks.kingZone[1 - color];
+		int colorScore = 0;
+		int attackWeight = 0;
+		int attackerCount = 0;
+
+		// rooks, knights, bishops and queens
+		for (int type = 1; type <= 4; type++) {
+			std::uint64_t pieces = board->getPieceBitboard(static_cast<ChessBoard::PieceType>(firstType + type));
+
+			while (pieces != 0) {
+				const int square = data::bits::lowestSquare(pieces);
+				pieces &= pieces - 1;
+
+				const std::uint64_t pieceAttacks = attacks.attacksFrom[square];
+				colorScore += MOBILITY_WEIGHT[type] * hammingDistance(pieceAttacks & ~ownPieces & ~enemyPawnAttacks);
+
+				const std::uint64_t zoneAttacks = pieceAttacks & enemyKingZone;
+				if (zoneAttacks != 0) {
+					attackerCount++;
+					attackWeight += KING_ATTACK_WEIGHT[type] * hammingDistance(zoneAttacks);
+				}
+			}
+		}
+
+		// squares by the enemy king attacked twice and defended at most once weigh extra
+		attackWeight += 2 * hammingDistance(enemyKingZone & attacks.doubleAttacks[color] & ~attacks.doubleAttacks[1 - color]);
+
+		if (attackerCount >= 2) colorScore += std::min(attackWeight * attackWeight / 2, KING_ATTACK_MAX_PENALTY);
+
+		score += isWhite ? colorScore : -colorScore;
+	}
+
+	return score;
+}
+
+
+/**
+ * Static evaluation of the position from the point of view of the given player, material, pawn
+ * structure, mobility and king safety. Unlike eval this does no mate detection, the search finds
+ * mates from the legal move count itself.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param currPlayer A boolean indicating the player's color (true for white, false for black).
+ * @return The evaluation score, positive when currPlayer is ahead.
+ */
+int BoardEvaluation::staticEval(const ChessBoard* board, bool currPlayer)
+{
+	const int positional = pawnStructureEval(board, PawnTable::evaluate(board)) + pieceActivityEval(board, MoveGeneration::getAttackInfo(board));
+	return materialCount(board, currPlayer) - materialCount(board, !currPlayer) + (currPlayer ? positional : -positional);
+}
+
+
+/**
+ * Evaluate a position reached by the search, with the network when one is loaded and by
+ * material, pawn structure, mobility and king safety otherwise. Results are cached in the
+ * thread's evaluation cache.
+ *
+ * @param context The search state of the thread running the search.
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param ply The distance from the root of the search, selects the accumulator.
+ * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+ * @param attacks The attacks of the board, computed once for the node.
+ * @return The evaluation score, positive when currPlayer is ahead.
+ */
+int BoardEvaluation::evaluate(SearchContext& context, const ChessBoard* board, int ply, bool currPlayer, const AttackInfo& attacks)
+{
+	const std::uint64_t key = board->getPositionKey(currPlayer);
+	int score;
+
+	context.stats.evalProbes++;
+	if (context.evalCache.probe(key, score)) {
+		context.stats.evalHits++;
+		return score;
+	}
+
+	if (Nnue::isLoaded()) {
+		score = Nnue::evaluate(context.accumulators[ply], currPlayer);
+	}
+	else {
+		bool hit;
+		const PawnEntry& pawnEntry = context.pawnTable.probe(board, hit);
+		context.stats.pawnProbes++;
+		if (hit) context.stats.pawnHits++;
+
+		const int positional = pawnStructureEval(board, pawnEntry) + pieceActivityEval(board, attacks);
+		score = materialCount(board, currPlayer) - materialCount(board, !currPlayer) + (currPlayer ? positional : -positional);
+	}
+
+	context.evalCache.store(key, score);
+	return score;
+}
+
+
+/**
+ * Static exchange evaluation, the material balance of the capture sequence on the target square
+ * of a move when both sides keep recapturing with their least valuable piece and may stop whenever
+ * going on would lose material. Each piece that captures is taken off the occupied bitboard, so the
+ * attackers query picks up the sliders that were behind it.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param move The move to evaluate, usually a capture.
+ * @return The material won by the mover in centipawns, negative if the move loses material.
+ */
+int BoardEvaluation::staticExchange(const ChessBoard* board, const ChessMove& move)
+{
+	const std::uint8_t target = move.toSquare;
+	const ChessBoard::PieceType victim = board->getPieceTypeAtSquare(target / 8, target % 8);
+	ChessBoard::PieceType attacker = board->getPieceTypeAtSquare(move.fromSquare / 8, move.fromSquare % 8);
+
+	// gain[d] is what the side making the d-th capture wins if the sequence stops after it
+	int gain[32];
+	int d = 0;
+	gain[0] = victim == ChessBoard::PieceType::EMPTY ? 0 : PIECE_VALUES[static_cast<int>(victim)];
+
+	std::uint64_t occupied = board->getAllPieces();
+	std::uint64_t fromBitboard = (std::uint64_t)1 << move.fromSquare;
+	std::uint64_t attackers = MoveGeneration::getAttackersTo(board, target, occupied);
+	bool side = static_cast<int>(attacker) < static_cast<int>(ChessBoard::PieceType::BLACK_PAWN);
+
+	while (true) {
+		d++;
+		gain[d] = exchangeValue(attacker) - gain[d - 1];
+
+		// neither side can gain from going on
+		if (std::max(-gain[d - 1], gain[d]) < 0 || d == 31) break;
+
+		occupied ^= fromBitboard;
+		attackers = MoveGeneration::getAttackersTo(board, target, occupied);
+
+		// the other side recaptures with its least valuable attacker
+		side = !side;
+		fromBitboard = 0;
+		for (ChessBoard::PieceType piece : EXCHANGE_ORDER[side]) {
+			const std::uint64_t pieces = attackers & board->getPieceBitboard(piece);
+			if (pieces != 0) {
+				fromBitboard = pieces & (~pieces + 1);
+				attacker = piece;
+				break;
+			}
+		}
+
+		if (fromBitboard == 0) break;
+	}
+
+	// walk back through the sequence, each side only takes when it pays off
+	while (--d > 0) gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+
+	return gain[0];
 }
 
 
@@ -91,60 +688,666 @@ std::int32_t BoardEvaluation::getEvaluation(const ChessBoard* board)
  */
 ChessMove BoardEvaluation::getBestNextMove(const ChessBoard* board, std::uint8_t depth, bool isWhite)
 {
-	constexpr int alpha = std::numeric_limits<int>::min();
-	constexpr int beta = std::numeric_limits<int>::max();
+	SearchState state;
+	state.table = &transpositionTable;
 
-	std::pair<int, ChessMove> bestMove = negaMax(board, depth, alpha, beta, isWhite);
-	return bestMove.second;
+	SearchLimits limits;
+	limits.depth = depth;
+	return search(state, board, limits, isWhite);
 }
 
 
 /**
- * NegaMax algorithm implementation for finding the best move and its score.
+ * Search for the best next move until the limits are reached or the search is stopped. This is
+ * a Lazy SMP search, every thread runs its own iterative deepening on its own copy of the board
+ * and they only cooperate through the shared transposition table. When the main thread ends the
+ * helpers are stopped and the threads vote on the move, weighted by score and depth.
  *
+ * @param state The search state to search with, only one search may use it at a time.
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param limits When the search has to end.
+ * @param isWhite A boolean indicating the player's color (true for white, false for black).
+ * @param gameKeys The position keys of the game before this position, oldest first, back to
+ *                 the last capture or pawn move. A position repeating one of them is a draw.
+ * @return The best next move for the player.
+ */
+ChessMove BoardEvaluation::search(SearchState& state, const ChessBoard* board, const SearchLimits& limits, bool isWhite, const std::vector<std::uint64_t>& gameKeys)
+{
+	state.limits = limits;
+	state.stop = false;
+	state.ponder = limits.ponder;
+	state.startTime = currentTimeMs();
+	state.beginTime = state.startTime;
+
+	prepareContexts(state);
+	std::vector<std::unique_ptr<SearchContext>>& contexts = state.contexts;
+
+	for (std::unique_ptr<SearchContext>& context : contexts) {
+		context->search = &state;
+		context->table = state.table;
+		context->stop = &state.stop;
+		context->isMainThread = context == contexts[0];
+		context->aborted = false;
+		context->nodes = 0;
+		context->tablebaseHits = 0;
+		context->stats = SearchStats();
+		context->completedDepth = 0;
+		context->bestScore = 0;
+		context->bestMateIn = 0;
+		context->bestMove = ChessMove();
+		context->gameKeys = gameKeys;
+
+		// the evaluation may have changed since the last search, a new network or new options
+		context->evalCache.clear();
+
+		// keep the history as a hint for the new search, but let it adapt quickly
+		for (int color = 0; color < 2; color++)
+			for (int from = 0; from < 64; from++)
+				for (int to = 0; to < 64; to++) context->history[color][from][to] /= 2;
+
+		for (int ply = 0; ply < SearchContext::maxPly; ply++) context->killers[ply][0] = context->killers[ply][1] = ChessMove();
+	}
+
+	state.table->newSearch();
+
+	std::vector<std::thread> helpers;
+	for (std::size_t i = 1; i < contexts.size(); i++) {
+		helpers.emplace_back(iterativeDeepening, std::ref(*contexts[i]), *board, SearchContext::maxPly - 1, isWhite, static_cast<int>(i));
+	}
+
+	iterativeDeepening(*contexts[0], *board, SearchContext::maxPly - 1, isWhite, 0);
+
+	// An infinite or ponder search never returns a move on its own, only once it is stopped.
+	while (!state.stop && (state.ponder || limits.infinite)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	state.stop = true;
+	for (std::thread& helper : helpers) helper.join();
+
+	SearchStats stats;
+	for (const std::unique_ptr<SearchContext>& context : contexts) {
+		context->stats.nodes = context->nodes;
+		context->stats.tablebaseHits = context->tablebaseHits;
+		stats += context->stats;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(state.lastStatsMutex);
+		state.lastStats = stats;
+	}
+
+	// Vote on the best move, every thread votes for its move with its score and depth.
+	const SearchContext* bestThread = contexts[0].get();
+	int minScore = bestThread->bestScore;
+	for (const std::unique_ptr<SearchContext>& context : contexts) {
+		if (context->completedDepth > 0) minScore = std::min(minScore, context->bestScore);
+	}
+
+	std::vector<std::int64_t> votes(contexts.size(), 0);
+	for (std::size_t i = 0; i < contexts.size(); i++) {
+		if (contexts[i]->completedDepth == 0) continue;
+
+		const std::int64_t vote = static_cast<std::int64_t>(contexts[i]->bestScore - minScore + 14) * contexts[i]->completedDepth;
+		for (std::size_t j = 0; j < contexts.size(); j++) {
+			if (contexts[j]->bestMove == contexts[i]->bestMove) votes[j] += vote;
+		}
+	}
+
+	std::int64_t bestVotes = votes[0];
+	for (std::size_t i = 1; i < contexts.size(); i++) {
+		const SearchContext* context = contexts[i].get();
+		if (context->completedDepth == 0) continue;
+
+		// a proven mate beats any vote
+		const bool fasterMate = context->bestScore >= BoardEvaluation::mateBound && context->bestScore > bestThread->bestScore;
+		if (fasterMate || (bestThread->bestScore < BoardEvaluation::mateBound && votes[i] > bestVotes)) {
+			bestThread = context;
+			bestVotes = votes[i];
+		}
+	}
+
+	return bestThread->bestMove;
+}
+
+
+/**
+ * Set the number of threads every search runs with, from its next search on.
+ *
+ * @param count The number of threads, the main thread included.
+ */
+void BoardEvaluation::setThreadCount(int count)
+{
+	threadCount = std::max(1, count);
+}
+
+
+/**
+ * Give a search state a context for each of the threadCount threads, the contexts of the
+ * threads that remain are kept.
+ *
+ * @param state The search state.
+ */
+void BoardEvaluation::prepareContexts(SearchState& state)
+{
+	while (static_cast<int>(state.contexts.size()) < threadCount) state.contexts.emplace_back(new SearchContext());
+	if (static_cast<int>(state.contexts.size()) > threadCount) state.contexts.resize(threadCount);
+}
+
+
+/**
+ * Forget the move ordering a search state learned in earlier games, for a new game. Clearing the
+ * killers and history is cheap, and so is aging the transposition table instead of zeroing all of it.
+ *
+ * @param state The search state.
+ */
+void BoardEvaluation::newGame(SearchState& state)
+{
+	for (std::unique_ptr<SearchContext>& context : state.contexts) {
+		for (int color = 0; color < 2; color++)
+			for (int from = 0; from < 64; from++)
+				for (int to = 0; to < 64; to++) context->history[color][from][to] = 0;
+
+		for (int ply = 0; ply < SearchContext::maxPly; ply++) context->killers[ply][0] = context->killers[ply][1] = ChessMove();
+	}
+
+	state.table->newSearch();
+}
+
+
+/**
+ * Tell the running search of a state to end as soon as possible, it still returns its best move.
+ * Safe to call from any thread.
+ *
+ * @param state The search state.
+ */
+void BoardEvaluation::stop(SearchState& state)
+{
+	state.stop = true;
+}
+
+
+/**
+ * The opponent played the move we were pondering on, the running ponder search of a state
+ * becomes a normal search and its limits start to count from now. Safe to call from any thread.
+ *
+ * @param state The search state.
+ */
+void BoardEvaluation::ponderHit(SearchState& state)
+{
+	state.startTime = currentTimeMs();
+	state.ponder = false;
+}
+
+
+/**
+ * Get the counters of the last completed search of a state, summed over all its threads.
+ * Safe to call from any thread, also while a search is running.
+ *
+ * @param state The search state.
+ * @return The counters of the last search.
+ */
+SearchStats BoardEvaluation::getLastStats(const SearchState& state)
+{
+	std::lock_guard<std::mutex> lock(state.lastStatsMutex);
+	return state.lastStats;
+}
+
+
+/**
+ * Find the root moves the tablebases rule out, every move that doesn't reach the best result the
+ * position has: a slower mate when winning, a loss when a draw is there, a quicker mate when losing.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+ * @return The moves to leave out, empty unless every move leads into a mapped table.
+ */
+static std::vector<ChessMove> tablebaseRootExclusions(const ChessBoard* board, bool currPlayer) {
+	std::vector<ChessMove> excluded;
+	if (Tablebase::largestTable() == 0) return excluded;
+
+	const std::vector<ChessMove> moves = MoveGeneration::generateColorsLegalMoves(board, currPlayer);
+	if (moves.empty()) return excluded;
+	std::vector<int> scores;
+
+	for (const ChessMove& move : moves) {
+		ChessBoard newBoard = *board;
+		newBoard.makeMove(move.fromSquare, move.toSquare);
+
+		int wdl;
+		int plies;
+		if (!Tablebase::probe(&newBoard, !currPlayer, wdl, plies)) return excluded;
+
+		// the result is the opponent's, a mate for it is a loss for the mover and quicker is worse
+		if (wdl == 0) scores.push_back(0);
+		else scores.push_back(wdl < 0 ? 1000 - plies : plies - 1000);
+	}
+
+	const int best = *std::max_element(scores.begin(), scores.end());
+	for (std::size_t i = 0; i < moves.size(); i++) {
+		if (scores[i] < best) excluded.push_back(moves[i]);
+	}
+
+	return excluded;
+}
+
+
+/**
+ * Find the root moves left out of the whole search: the moves missing from the go command's
+ * searchmoves and the moves the tablebases rule out. Neither may leave the search without a
+ * move, searchmoves is ignored if none of its moves is legal and the tablebase exclusions are
+ * dropped if they would rule out every move searchmoves allows.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+ * @param searchMoves The root moves the search is limited to, empty for every move.
+ * @return The moves to leave out.
+ */
+static std::vector<ChessMove> rootExclusions(const ChessBoard* board, bool currPlayer, const std::vector<ChessMove>& searchMoves) {
+	const std::vector<ChessMove> moves = MoveGeneration::generateColorsLegalMoves(board, currPlayer);
+	auto isListed = [](const std::vector<ChessMove>& list, const ChessMove& move) {
+		return std::find(list.begin(), list.end(), move) != list.end();
+	};
+
+	std::vector<ChessMove> excluded;
+	if (!searchMoves.empty()) {
+		for (const ChessMove& move : moves) {
+			if (!isListed(searchMoves, move)) excluded.push_back(move);
+		}
+		if (excluded.size() == moves.size()) excluded.clear();
+	}
+
+	const std::size_t restricted = excluded.size();
+	for (const ChessMove& move : tablebaseRootExclusions(board, currPlayer)) {
+		if (!isListed(excluded, move)) excluded.push_back(move);
+	}
+	if (excluded.size() == moves.size()) excluded.resize(restricted);
+
+	return excluded;
+}
+
+
+/**
+ * Iterative deepening loop run by each search thread. The main thread (index 0) searches
+ * every depth until the search limits are reached, helper threads skip depths depending on
+ * their index so the threads spread over different depths, and keep going until they are stopped.
+ *
+ * In MultiPV mode the main thread searches the root once per line at every depth, each time
+ * leaving out the root moves of the lines it already found. The later lines reuse the
+ * transposition table and move ordering of the first, so they cost far less than a full search.
+ *
+ * When every root move leads into the tablebases, the moves that don't keep the best result are
+ * left out from the start, so the search only chooses between the quickest mates or the draws.
+ * Root moves missing from the limits' searchMoves are left out the same way.
+ *
+ * @param context The search state of the thread.
+ * @param board The thread's own copy of the board.
+ * @param depth The deepest iteration to search.
+ * @param isWhite A boolean indicating the player's color (true for white, false for black).
+ * @param threadIndex The index of the thread, 0 for the main thread.
+ */
+void BoardEvaluation::iterativeDeepening(SearchContext& context, ChessBoard board, int depth, bool isWhite, int threadIndex)
+{
+	constexpr int alpha = -BoardEvaluation::bestScore - 1;
+	constexpr int beta = BoardEvaluation::bestScore + 1;
+
+	const SearchState& state = *context.search;
+	const std::vector<ChessMove> excludedMoves = rootExclusions(&board, isWhite, state.limits.searchMoves);
+
+	// there can't be more lines than legal moves, and every line needs at least one
+	const int rootMoves = static_cast<int>(MoveGeneration::generateColorsLegalMoves(&board, isWhite).size() - excludedMoves.size());
+	const int lineCount = context.isMainThread ? std::max(1, std::min(multiPv, rootMoves)) : 1;
+
+	// the root accumulator is built once, every other ply updates it move by move
+	if (Nnue::isLoaded()) Nnue::refresh(context.accumulators[0], &board);
+
+	for (int currDepth = 1; currDepth <= depth; currDepth++) {
+		if (threadIndex > 0) {
+			const int skip = (threadIndex - 1) % 20;
+			if (((currDepth + SKIP_PHASE[skip]) / SKIP_SIZE[skip]) % 2 != 0) continue;
+		}
+
+		std::vector<SearchInfo> lines;
+		context.excludedRootMoves = excludedMoves;
+
+		for (int line = 0; line < lineCount; line++) {
+			const std::pair<int, ChessMove> result = negaMax(context, &board, currDepth, 0, alpha, beta, isWhite);
+			if (context.aborted) break;
+
+			SearchInfo info;
+			info.depth = currDepth;
+			info.score = result.first;
+			if (result.first >= BoardEvaluation::mateBound) info.mateIn = (BoardEvaluation::bestScore - result.first + 1) / 2;
+			if (result.first <= -BoardEvaluation::mateBound) info.mateIn = -(BoardEvaluation::bestScore + result.first) / 2;
+			info.pv.assign(context.pv[0], context.pv[0] + context.pvLength[0]);
+			if (info.pv.empty()) info.pv.push_back(result.second);
+
+			lines.push_back(info);
+			context.excludedRootMoves.push_back(result.second);
+		}
+
+		context.excludedRootMoves.clear();
+		if (context.aborted) break;
+
+		// a later line can come out ahead of an earlier one, report them best first
+		std::stable_sort(lines.begin(), lines.end(), [](const SearchInfo& a, const SearchInfo& b) {
+			return a.score > b.score;
+		});
+		for (std::size_t i = 0; i < lines.size(); i++) lines[i].multiPv = static_cast<int>(i) + 1;
+
+		context.completedDepth = currDepth;
+		context.bestScore = lines[0].score;
+		context.bestMateIn = lines[0].mateIn;
+		context.bestMove = lines[0].pv[0];
+
+		if (context.isMainThread && state.infoHandler) {
+			const std::int64_t time = currentTimeMs() - state.beginTime;
+			const std::uint64_t nodes = totalNodes(state);
+			const int hashFull = context.table->hashFull();
+			const std::uint64_t tablebaseHits = totalTablebaseHits(state);
+
+			for (SearchInfo& info : lines) {
+				info.selDepth = context.stats.selDepth;
+				info.nodes = nodes;
+				info.time = time;
+				info.nps = nodes * 1000 / static_cast<std::uint64_t>(std::max<std::int64_t>(time, 1));
+				info.hashFull = hashFull;
+				info.tbHits = tablebaseHits;
+				state.infoHandler(info);
+			}
+		}
+
+		if (context.isMainThread && searchLimitReached(context)) break;
+	}
+}
+
+
+/**
+ * NegaMax algorithm implementation for finding the best move and its score. This is a principal
+ * variation search, every move after the first is tried with a null window and only re-searched
+ * when it beats alpha. On top of that sit the selective features switched by BoardEvaluation::options.
+ *
+ * @param context The search state of the thread running the search.
  * @param board A pointer to the ChessBoard object representing the current board state.
  * @param depth The search depth for the move evaluation.
+ * @param ply The distance from the root of the search.
  * @param alpha The alpha value for alpha-beta pruning.
  * @param beta The beta value for alpha-beta pruning.
  * @param currPlayer A boolean indicating the current player's color (true for white, false for black).
+ * @param allowNullMove False directly after a null move, so two are never made in a row.
  * @return A pair containing the best move's score and the best move itself.
  */
-std::pair<int, ChessMove> BoardEvaluation::negaMax(const ChessBoard* board, int depth, int alpha, int beta, bool currPlayer) {
-	if (depth == 0) {
-		return std::pair<int, ChessMove>(eval(board, currPlayer), ChessMove(0, 0));
+std::pair<int, ChessMove> BoardEvaluation::negaMax(SearchContext& context, const ChessBoard* board, int depth, int ply, int alpha, int beta, bool currPlayer, bool allowNullMove) {
+	context.pvLength[ply] = 0;
+	context.stats.selDepth = std::max(context.stats.selDepth, ply);
+
+	if (depth <= 0) {
+		return std::pair<int, ChessMove>(quiescence(context, board, ply, alpha, beta, currPlayer), ChessMove());
+	}
+
+	if (shouldStop(context)) return std::pair<int, ChessMove>(0, ChessMove());
+	if (ply >= SearchContext::maxPly - 1) {
+		return std::pair<int, ChessMove>(evaluate(context, board, ply, currPlayer, MoveGeneration::getAttackInfo(board)), ChessMove());
+	}
+
+	const bool isPvNode = beta - alpha > 1;
+	const int originalAlpha = alpha;
+
+	// A repeated position is a draw, the side that repeats it could keep doing so.
+	const std::uint64_t key = board->getPositionKey(currPlayer);
+	context.pathKeys[ply] = key;
+	context.nullMoves[ply] = false;
+	if (ply > 0 && isRepetition(context, ply)) return std::pair<int, ChessMove>(0, ChessMove());
+
+	// A deep enough result from the transposition table ends the node before any move generation.
+	TranspositionTable::Entry entry;
+	const bool tableHit = context.table->probe(key, entry);
+	context.stats.tableProbes++;
+	if (tableHit) context.stats.tableHits++;
+
+	if (tableHit && ply > 0 && !isPvNode && entry.depth >= depth) {
+		const int score = scoreFromTable(entry.score, ply, BoardEvaluation::mateBound);
+
+		if (entry.bound == TranspositionTable::Bound::EXACT
+			|| (entry.bound == TranspositionTable::Bound::LOWER && score >= beta)
+			|| (entry.bound == TranspositionTable::Bound::UPPER && score <= alpha)) {
+			return std::pair<int, ChessMove>(score, entry.move);
+		}
+	}
+
+	// Inside the tablebases the exact result is one lookup away, it replaces the whole subtree.
+	int wdl;
+	int plies;
+	if (ply > 0 && depth >= probeDepth && Tablebase::largestTable() > 0 && Tablebase::probe(board, currPlayer, wdl, plies)) {
+		context.tablebaseHits.store(context.tablebaseHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		int score = 0;
+		if (wdl > 0) score = BoardEvaluation::bestScore - ply - plies;
+		if (wdl < 0) score = -BoardEvaluation::bestScore + ply + plies;
+
+		context.table->store(key, ChessMove(), depth, TranspositionTable::Bound::EXACT, scoreToTable(score, ply, BoardEvaluation::mateBound));
+		return std::pair<int, ChessMove>(score, ChessMove());
+	}
+
+	// The attacks are computed once and shared by move generation, check detection and evaluation.
+	const AttackInfo attacks = MoveGeneration::getAttackInfo(board);
+	std::vector<ChessMove> moves = MoveGeneration::generateColorsLegalMoves(board, currPlayer, attacks);
+	const bool inCheck = attacks.inCheck[currPlayer ? 1 : 0];
+
+	// No legal moves is either checkmate or stalemate, prefer the quickest mate.
+	if (moves.empty()) {
+		return std::pair<int, ChessMove>(inCheck ? -BoardEvaluation::bestScore + ply : 0, ChessMove());
+	}
+
+	// In MultiPV mode the root leaves out the moves of the lines already found.
+	const bool isExcludingRoot = ply == 0 && !context.excludedRootMoves.empty();
+	if (isExcludingRoot) {
+		moves.erase(std::remove_if(moves.begin(), moves.end(), [&context](const ChessMove& move) {
+			return std::find(context.excludedRootMoves.begin(), context.excludedRootMoves.end(), move) != context.excludedRootMoves.end();
+		}), moves.end());
+
+		if (moves.empty()) return std::pair<int, ChessMove>(-BoardEvaluation::bestScore - 1, ChessMove());
 	}
 
-	if (isCheckMate(board, currPlayer)) {
-		return std::pair<int, ChessMove>(BoardEvaluation::bestScore, ChessMove(0, 0));
+	if (options.checkExtensions && inCheck) depth++;
+
+	const int evaluation = inCheck ? -BoardEvaluation::bestScore : evaluate(context, board, ply, currPlayer, attacks);
+
+	if (!isPvNode && !inCheck && ply > 0) {
+
+		// Razoring, when even a generous margin can't lift the eval to alpha only captures can save us.
+		if (options.razoring && depth <= RAZOR_MAX_DEPTH && evaluation + RAZOR_MARGIN[depth] <= alpha) {
+			const int score = quiescence(context, board, ply, alpha, alpha + 1, currPlayer);
+			if (score <= alpha) return std::pair<int, ChessMove>(score, ChessMove());
+		}
+
+		// Null move pruning, if passing the turn still holds beta a real move will too.
+		if (options.nullMovePruning && allowNullMove && depth >= NULL_MOVE_MIN_DEPTH && evaluation >= beta
+			&& hasNonPawnMaterial(board, currPlayer)) {
+
+			const int reduction = 2 + depth / 4;
+			ChessBoard nullBoard = *board;
+			nullBoard.makeNullMove();
+			if (Nnue::isLoaded()) context.accumulators[ply + 1] = context.accumulators[ply];
+
+			context.stats.nullMoveTries++;
+			context.nullMoves[ply] = true;
+			int score = -negaMax(context, &nullBoard, depth - 1 - reduction, ply + 1, -beta, -beta + 1, !currPlayer, false).first;
+			context.nullMoves[ply] = false;
+			if (context.aborted) return std::pair<int, ChessMove>(0, ChessMove());
+
+			if (score >= beta) {
+				// Never return an unproven mate from a null move search.
+				if (score >= BoardEvaluation::mateBound) score = beta;
+
+				// Deep cut-offs are verified with a reduced search without null moves to catch zugzwang.
+				if (depth < NULL_MOVE_VERIFY_DEPTH) {
+					context.stats.nullMoveCutoffs++;
+					return std::pair<int, ChessMove>(score, ChessMove());
+				}
+
+				const int verified = negaMax(context, board, depth - 1 - reduction, ply, beta - 1, beta, currPlayer, false).first;
+				if (verified >= beta) {
+					context.stats.nullMoveCutoffs++;
+					return std::pair<int, ChessMove>(score, ChessMove());
+				}
+			}
+		}
 	}
 
-	ChessMove bestMove(0, 0);
+	const std::vector<ScoredMove> orderedMoves = orderMoves(context, board, moves, tableHit ? entry.move : ChessMove(), ply, currPlayer);
+
+	ChessMove bestMove = orderedMoves[0].move;
 	int bestScore = -BoardEvaluation::bestScore - 1;
+	int movesSearched = 0;
+
+	for (const ScoredMove& scoredMove : orderedMoves) {
+		const ChessMove& move = scoredMove.move;
+		const bool isQuiet = !scoredMove.isCapture;
 
-	for (ChessMove move : MoveGeneration::generateColorsLegalMoves(board, currPlayer)) {
 		ChessBoard newBoard = *board;
 		newBoard.makeMove(move.fromSquare, move.toSquare);
-		std::pair<int, ChessMove> results = negaMax(&newBoard, depth - 1, -beta, -alpha, !currPlayer);
 
-		results.first = -results.first;
+		// Moves that give check are never pruned or reduced, only test for it when it matters.
+		const bool mayPrune = ply > 0 && !inCheck && isQuiet && bestScore > -BoardEvaluation::mateBound;
+		const bool mayReduce = options.lateMoveReductions && depth >= LMR_MIN_DEPTH && movesSearched >= LMR_MIN_MOVES && !inCheck && isQuiet;
+		const bool givesCheck = (mayPrune || mayReduce) && MoveGeneration::isCheck(&newBoard, !currPlayer);
+
+		if (mayPrune && !givesCheck) {
+			// Late move pruning, near the horizon the late quiet moves are almost never best.
+			if (options.lateMovePruning && depth <= LMP_MAX_DEPTH && movesSearched >= 3 + depth * depth) continue;
+
+			// Futility pruning, a quiet move can't win back the gap between the eval and alpha.
+			if (options.futilityPruning && depth <= FUTILITY_MAX_DEPTH && evaluation + FUTILITY_MARGIN[depth] <= alpha) continue;
+		}
+
+		if (Nnue::isLoaded()) Nnue::update(context.accumulators[ply], context.accumulators[ply + 1], board, &newBoard, move);
+
+		int score;
+		if (movesSearched == 0) {
+			score = -negaMax(context, &newBoard, depth - 1, ply + 1, -beta, -alpha, !currPlayer).first;
+		}
+		else {
+			int reduction = 0;
+			if (mayReduce && !givesCheck) {
+				reduction = reductionTable[std::min(depth, 63)][std::min(movesSearched, 63)];
+				if (isPvNode) reduction--;
+				reduction = std::max(0, std::min(reduction, depth - 2));
+			}
+
+			if (reduction > 0) context.stats.lmrSearches++;
+			score = -negaMax(context, &newBoard, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, !currPlayer).first;
+
+			// A reduced move that beats alpha gets its full depth back.
+			if (score > alpha && reduction > 0) {
+				context.stats.lmrResearches++;
+				score = -negaMax(context, &newBoard, depth - 1, ply + 1, -alpha - 1, -alpha, !currPlayer).first;
+			}
+
+			// Inside the window the null window result is only a bound, search it properly.
+			if (score > alpha && score < beta) {
+				score = -negaMax(context, &newBoard, depth - 1, ply + 1, -beta, -alpha, !currPlayer).first;
+			}
+		}
 
-		if (results.first > bestScore) {
-			bestScore = results.first;
+		if (context.aborted) return std::pair<int, ChessMove>(0, ChessMove());
+
+		movesSearched++;
+
+		if (score > bestScore) {
+			bestScore = score;
 			bestMove = move;
+
+			// a new best move inside the window extends the principal variation of the child
+			if (score > alpha && isPvNode) {
+				context.pv[ply][0] = move;
+				std::copy(context.pv[ply + 1], context.pv[ply + 1] + context.pvLength[ply + 1], context.pv[ply] + 1);
+				context.pvLength[ply] = context.pvLength[ply + 1] + 1;
+			}
 		}
 
 		alpha = std::max(alpha, bestScore);
 
 		if (alpha >= beta) {
+			context.stats.betaCutoffs++;
+			if (movesSearched == 1) context.stats.firstMoveCutoffs++;
+			if (isQuiet) updateQuietStats(context, move, depth, ply, currPlayer);
+
 			// Prune remaining branches
 			break;
 		}
 	}
 
+	// Every move was pruned, the node fails low at alpha.
+	if (movesSearched == 0) return std::pair<int, ChessMove>(alpha, bestMove);
+
+	TranspositionTable::Bound bound = TranspositionTable::Bound::EXACT;
+	if (bestScore >= beta) bound = TranspositionTable::Bound::LOWER;
+	else if (bestScore <= originalAlpha) bound = TranspositionTable::Bound::UPPER;
+
+	// a fail low doesn't tell us which move is best, and a root missing some of its moves has no true score
+	const ChessMove storedMove = bound == TranspositionTable::Bound::UPPER ? ChessMove() : bestMove;
+	if (!isExcludingRoot) context.table->store(key, storedMove, depth, bound, scoreToTable(bestScore, ply, BoardEvaluation::mateBound));
+
 	return std::pair<int, ChessMove>(bestScore, bestMove);
 }
 
 
+/**
+ * Quiescence search, only captures are searched so the position is quiet before it is evaluated.
+ * The side to move may always stand pat on the static evaluation instead of capturing.
+ *
+ * @param context The search state of the thread running the search.
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param ply The distance from the root of the search.
+ * @param alpha The alpha value for alpha-beta pruning.
+ * @param beta The beta value for alpha-beta pruning.
+ * @param currPlayer A boolean indicating the current player's color (true for white, false for black).
+ * @return The score of the position from the current player's point of view.
+ */
+int BoardEvaluation::quiescence(SearchContext& context, const ChessBoard* board, int ply, int alpha, int beta, bool currPlayer)
+{
+	if (shouldStop(context)) return 0;
+	context.stats.qNodes++;
+	context.stats.selDepth = std::max(context.stats.selDepth, ply);
+
+	const AttackInfo attacks = MoveGeneration::getAttackInfo(board);
+	const int standPat = evaluate(context, board, ply, currPlayer, attacks);
+	if (standPat >= beta || ply >= SearchContext::maxPly - 1) return standPat;
+
+	alpha = std::max(alpha, standPat);
+
+	// captures that lose material are pruned, they can't raise a stand pat score
+	std::vector<std::pair<int, ChessMove>> captures;
+	for (const ChessMove& move : MoveGeneration::generateColorsLegalMoves(board, currPlayer, attacks)) {
+		const int score = captureScore(board, move);
+		if (score >= 0 && !isLosingCapture(board, move)) captures.emplace_back(score, move);
+	}
+
+	std::stable_sort(captures.begin(), captures.end(), [](const std::pair<int, ChessMove>& a, const std::pair<int, ChessMove>& b) {
+		return a.first > b.first;
+	});
+
+	int bestScore = standPat;
+
+	for (const std::pair<int, ChessMove>& capture : captures) {
+		ChessBoard newBoard = *board;
+		newBoard.makeMove(capture.second.fromSquare, capture.second.toSquare);
+		if (Nnue::isLoaded()) Nnue::update(context.accumulators[ply], context.accumulators[ply + 1], board, &newBoard, capture.second);
+
+		const int score = -quiescence(context, &newBoard, ply + 1, -beta, -alpha, !currPlayer);
+		if (context.aborted) return 0;
+
+		bestScore = std::max(bestScore, score);
+		alpha = std::max(alpha, score);
+
+		if (alpha >= beta) break;
+	}
+
+	return bestScore;
+}
+
+
 /**
  * Check if the current player is in checkmate.
  *
@@ -11,7 +11,166 @@
  */
 
 #pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "EvalCache.h"
 #include "MoveGeneration.h"
+#include "Nnue.h"
+#include "PawnTable.h"
+#include "Tablebase.h"
+#include "TranspositionTable.h"
+
+/**
+ * @struct SearchOptions
+ *
+ * Switches for the selective search features. Every feature can be turned off on its
+ * own so its effect on strength and depth can be A/B tested against the full search.
+ */
+struct SearchOptions
+{
+    bool nullMovePruning = true;    ///< Skip a turn and cut if the opponent still can't reach beta.
+    bool lateMoveReductions = true; ///< Search late quiet moves at a reduced depth first.
+    bool futilityPruning = true;    ///< Skip quiet moves near the horizon that can't raise alpha.
+    bool razoring = true;           ///< Drop hopeless frontier nodes straight into quiescence.
+    bool lateMovePruning = true;    ///< Stop trying quiet moves near the horizon after the first few.
+    bool checkExtensions = true;    ///< Search one ply deeper when the side to move is in check.
+};
+
+/**
+ * @struct SearchLimits
+ *
+ * When a search has to end. A search with no depth, time, node or mate limit runs until it is stopped.
+ */
+struct SearchLimits
+{
+    int depth = 0;                      ///< The deepest iteration to search, 0 for no limit.
+    int moveTime = 0;                   ///< Milliseconds to search for, 0 for no limit.
+    std::uint64_t nodes = 0;            ///< Nodes to search, summed over all threads, 0 for no limit.
+    int mate = 0;                       ///< End once a mate in at most this many moves is found, 0 for no limit.
+    std::vector<ChessMove> searchMoves; ///< Only search these root moves, empty to search every move.
+    bool infinite = false;              ///< Keep searching until stopped, even once a limit is reached.
+    bool ponder = false;                ///< Search on the opponent's time, the limits only apply after ponderhit.
+};
+
+/**
+ * @struct SearchInfo
+ *
+ * One line of search output, reported after every completed iteration. In MultiPV mode an
+ * iteration reports one line per principal variation, best first.
+ */
+struct SearchInfo
+{
+    int depth = 0;              ///< The depth of the iteration.
+    int multiPv = 1;            ///< The rank of this line, 1 for the best line.
+    int score = 0;              ///< The score of the line in centipawns, from the side to move's point of view.
+    int mateIn = 0;             ///< Moves until mate, negative when being mated, 0 if no mate was found.
+    int selDepth = 0;           ///< The deepest ply the main thread reached, quiescence included.
+    std::uint64_t nodes = 0;    ///< Nodes visited by all threads so far.
+    std::uint64_t nps = 0;      ///< Nodes per second.
+    std::int64_t time = 0;      ///< Milliseconds since the search started.
+    int hashFull = 0;           ///< How full the transposition table is, in permille.
+    std::uint64_t tbHits = 0;   ///< Positions all threads found in the tablebases so far.
+    std::vector<ChessMove> pv;  ///< The principal variation, starting with the root move.
+};
+
+/**
+ * @struct SearchStats
+ *
+ * Counters kept by every search thread. They are plain increments on the thread's own context,
+ * cheap enough to always stay on, and are summed over the threads when the search ends.
+ */
+struct SearchStats
+{
+    std::uint64_t nodes = 0;            ///< Nodes visited, quiescence nodes included.
+    std::uint64_t qNodes = 0;           ///< Nodes visited by the quiescence search.
+    int selDepth = 0;                   ///< The deepest ply reached.
+    std::uint64_t tableProbes = 0;      ///< Transposition table lookups.
+    std::uint64_t tableHits = 0;        ///< Lookups that found the position.
+    std::uint64_t betaCutoffs = 0;      ///< Nodes that failed high on one of their moves.
+    std::uint64_t firstMoveCutoffs = 0; ///< Fail highs on the first move searched, a measure of move ordering.
+    std::uint64_t nullMoveTries = 0;    ///< Null move searches.
+    std::uint64_t nullMoveCutoffs = 0;  ///< Null move searches that cut the node.
+    std::uint64_t lmrSearches = 0;      ///< Moves searched at a reduced depth.
+    std::uint64_t lmrResearches = 0;    ///< Reduced moves that beat alpha and were searched again at full depth.
+    std::uint64_t pawnProbes = 0;       ///< Pawn hash table lookups.
+    std::uint64_t pawnHits = 0;         ///< Lookups that found the pawn structure.
+    std::uint64_t evalProbes = 0;       ///< Evaluation cache lookups.
+    std::uint64_t evalHits = 0;         ///< Lookups that found the position's evaluation.
+    std::uint64_t tablebaseHits = 0;    ///< Nodes whose result was found in the tablebases.
+
+    SearchStats& operator+=(const SearchStats& other);
+};
+
+struct SearchState;
+
+/**
+ * @struct SearchContext
+ *
+ * The state owned by a single search thread, its move ordering tables, its view of the stop
+ * flag and the result of the deepest iteration it completed. Each thread searches its own copy
+ * of the board with its own context, the only thing the threads share is the transposition table.
+ */
+struct SearchContext
+{
+    static const int maxPly = 128;
+
+    const SearchState* search = nullptr;     ///< The search this thread belongs to, its limits and the other threads.
+    TranspositionTable* table = nullptr;     ///< The transposition table of that search.
+    const std::atomic<bool>* stop = nullptr; ///< Raised when the search has to end.
+    bool isMainThread = false;               ///< The main thread also watches the search limits.
+    bool aborted = false;                    ///< Set once the stop flag was seen, the current iteration is thrown away.
+    std::atomic<std::uint64_t> nodes{ 0 };   ///< Nodes visited by this thread, only written by it but read by the main thread for info output.
+    std::atomic<std::uint64_t> tablebaseHits{ 0 }; ///< Tablebase hits of this thread, shared the same way as the nodes.
+    SearchStats stats;                       ///< The remaining counters of this thread in the current search.
+
+    ChessMove killers[maxPly][2];            ///< The last two quiet moves that caused a cut-off at each ply.
+    int history[2][64][64] = {};             ///< How often a quiet move caused a cut-off, by colour, from and to square.
+
+    ChessMove pv[maxPly][maxPly];            ///< Triangular table of principal variations, row ply holds the line from that ply on.
+    int pvLength[maxPly] = {};               ///< The length of each row of the principal variation table.
+    std::vector<ChessMove> excludedRootMoves; ///< Root moves left out of the search, the lines already found in MultiPV mode.
+
+    std::vector<std::uint64_t> gameKeys;     ///< The keys of the game's positions before the root, back to the last capture or pawn move.
+    std::uint64_t pathKeys[maxPly] = {};     ///< The key of the position at each ply of the current line.
+    bool nullMoves[maxPly] = {};             ///< True where the current line passed the turn with a null move.
+
+    PawnTable pawnTable;                     ///< This thread's cache of pawn structure evaluations.
+    EvalCache evalCache;                     ///< This thread's cache of static evaluations, cleared every search.
+    Nnue::Accumulator accumulators[maxPly];  ///< The network accumulator of the position at each ply, only kept up to date while a network is loaded.
+
+    int completedDepth = 0;                  ///< The deepest iteration this thread completed.
+    int bestScore = 0;                       ///< The score of the best move of that iteration.
+    int bestMateIn = 0;                      ///< Moves to the mate that iteration found, 0 if none.
+    ChessMove bestMove;                      ///< The best move of that iteration.
+};
+
+/**
+ * @struct SearchState
+ *
+ * Everything one search owns: the contexts of its threads, the transposition table they share,
+ * its stop token and its limits. Each Engine has its own, so the searches of different engines
+ * run side by side and stopping one leaves the others running. The contexts are kept between
+ * searches so the history tables carry over.
+ */
+struct SearchState
+{
+    std::vector<std::unique_ptr<SearchContext>> contexts; ///< The state of each search thread, the main thread first.
+    TranspositionTable* table = nullptr;      ///< The table the threads share, set by the owner before the first search.
+
+    std::atomic<bool> stop{ false };          ///< Raised when the search has to end.
+    std::atomic<bool> ponder{ false };        ///< True while pondering, the limits only count after ponderhit.
+    std::atomic<std::int64_t> startTime{ 0 }; ///< When the limits started to count, moved by ponderhit.
+    std::int64_t beginTime = 0;               ///< When the search started, unlike startTime not moved by ponderhit.
+    SearchLimits limits;                      ///< The limits of the running search.
+
+    std::function<void(const SearchInfo&)> infoHandler; ///< Called by the main thread with each line of a completed iteration, may be empty.
+
+    SearchStats lastStats;                    ///< The counters of the last completed search.
+    mutable std::mutex lastStatsMutex;        ///< Guards lastStats, which is read while a search runs.
+};
 
  /**
   * @class BoardEvaluation
@@ -40,17 +199,108 @@ public:
      */
     static ChessMove getBestNextMove(const ChessBoard* board, std::uint8_t depth, bool isWhite);
 
+    /**
+     * Search for the best next move until the limits are reached or the search is stopped.
+     * Blocks the calling thread, stop and ponderHit may be called from any other thread.
+     *
+     * @param state The search state to search with, only one search may use it at a time.
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param limits When the search has to end.
+     * @param isWhite A boolean indicating the player's color (true for white, false for black).
+     * @param gameKeys The position keys of the game before this position, oldest first, back to
+     *                 the last capture or pawn move. A position repeating one of them is a draw.
+     * @return The best next move for the player.
+     */
+    static ChessMove search(SearchState& state, const ChessBoard* board, const SearchLimits& limits, bool isWhite, const std::vector<std::uint64_t>& gameKeys = std::vector<std::uint64_t>());
+
+    /**
+     * Set the number of threads every search runs with, from its next search on.
+     *
+     * @param count The number of threads, the main thread included.
+     */
+    static void setThreadCount(int count);
+
+    /**
+     * Forget the move ordering a search state learned in earlier games, for a new game. Its
+     * transposition table is kept, its entries are still true, but they are aged so the new
+     * game's results replace them first. Must not be called during a search with the state.
+     *
+     * @param state The search state.
+     */
+    static void newGame(SearchState& state);
+
+    /**
+     * Tell the running search of a state to end as soon as possible, it still returns its best
+     * move. Safe to call from any thread.
+     *
+     * @param state The search state.
+     */
+    static void stop(SearchState& state);
+
+    /**
+     * The opponent played the move we were pondering on, the running ponder search of a state
+     * becomes a normal search and its limits start to count from now. Safe to call from any thread.
+     *
+     * @param state The search state.
+     */
+    static void ponderHit(SearchState& state);
+
+    /**
+     * Get the counters of the last completed search of a state, summed over all its threads.
+     * Safe to call from any thread, also while a search is running.
+     *
+     * @param state The search state.
+     * @return The counters of the last search.
+     */
+    static SearchStats getLastStats(const SearchState& state);
+
     /**
      * NegaMax algorithm implementation for finding the best move and its score.
      *
+     * @param context The search state of the thread running the search.
      * @param board A pointer to the ChessBoard object representing the current board state.
      * @param depth The search depth for the move evaluation.
+     * @param ply The distance from the root of the search.
      * @param alpha The alpha value for alpha-beta pruning.
      * @param beta The beta value for alpha-beta pruning.
      * @param currPlayer A boolean indicating the current player's color (true for white, false for black).
+     * @param allowNullMove False directly after a null move, so two are never made in a row.
      * @return A pair containing the best move's score and the best move itself.
      */
-    static std::pair<int, ChessMove> negaMax(const ChessBoard* board, int depth, int alpha, int beta, bool currPlayer);
+    static std::pair<int, ChessMove> negaMax(SearchContext& context, const ChessBoard* board, int depth, int ply, int alpha, int beta, bool currPlayer, bool allowNullMove = true);
+
+    /**
+     * Quiescence search, only captures are searched so the position is quiet before it is evaluated.
+     *
+     * @param context The search state of the thread running the search.
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param ply The distance from the root of the search.
+     * @param alpha The alpha value for alpha-beta pruning.
+     * @param beta The beta value for alpha-beta pruning.
+     * @param currPlayer A boolean indicating the current player's color (true for white, false for black).
+     * @return The score of the position from the current player's point of view.
+     */
+    static int quiescence(SearchContext& context, const ChessBoard* board, int ply, int alpha, int beta, bool currPlayer);
+
+    /**
+     * Static evaluation of the position from the point of view of the given player.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param currPlayer A boolean indicating the player's color (true for white, false for black).
+     * @return The evaluation score, positive when currPlayer is ahead.
+     */
+    static int staticEval(const ChessBoard* board, bool currPlayer);
+
+    /**
+     * Static exchange evaluation, the material balance of the capture sequence on the target
+     * square of a move when both sides keep recapturing with their least valuable piece and may
+     * stop whenever going on would lose material.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param move The move to evaluate, usually a capture.
+     * @return The material won by the mover in centipawns, negative if the move loses material.
+     */
+    static int staticExchange(const ChessBoard* board, const ChessMove& move);
 
     /**
      * Check if the current player is in checkmate.
@@ -61,7 +311,72 @@ public:
      */
     static bool isCheckMate(const ChessBoard* board, bool forWhite);
 
+    /**
+     * The selective search features in use, changed through the engine's toggle command.
+     */
+    static SearchOptions options;
+
+    /**
+     * The transposition table of the process, searches use it unless their engine was given
+     * a table of its own.
+     */
+    static TranspositionTable transpositionTable;
+
+    /**
+     * The number of threads each search runs with, changed through the Threads option.
+     */
+    static int threadCount;
+
+    /**
+     * The number of best lines the main thread searches and reports, changed through the MultiPV option.
+     */
+    static int multiPv;
+
+    /**
+     * The least remaining depth at which the search probes the tablebases, changed through the
+     * ProbeDepth option. Higher values save probes when the files are slow to read.
+     */
+    static int probeDepth;
+
 private:
+    /**
+     * Give a search state a context for each of the threadCount threads, the contexts of the
+     * threads that remain are kept.
+     *
+     * @param state The search state.
+     */
+    static void prepareContexts(SearchState& state);
+
+    /**
+     * Iterative deepening loop run by each search thread. The main thread (index 0) searches
+     * every depth up to the target, helper threads skip depths depending on their index so the
+     * threads spread over different depths, and keep going until they are stopped.
+     *
+     * @param context The search state of the thread.
+     * @param board The thread's own copy of the board.
+     * @param depth The deepest iteration to search.
+     * @param isWhite A boolean indicating the player's color (true for white, false for black).
+     * @param threadIndex The index of the thread, 0 for the main thread.
+     */
+    static void iterativeDeepening(SearchContext& context, ChessBoard board, int depth, bool isWhite, int threadIndex);
+
+    /**
+     * Evaluate a position reached by the search, with the network when one is loaded and by
+     * material, pawn structure, mobility and king safety otherwise. Results are cached in the
+     * thread's evaluation cache.
+     *
+     * @param context The search state of the thread running the search.
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param ply The distance from the root of the search, selects the accumulator.
+     * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+     * @param attacks The attacks of the board, computed once for the node.
+     * @return The evaluation score, positive when currPlayer is ahead.
+     */
+    static int evaluate(SearchContext& context, const ChessBoard* board, int ply, bool currPlayer, const AttackInfo& attacks);
+
     // Constant representing the best possible score
     static const int bestScore = 1000000;
+
+    // Any score beyond this bound is a forced mate
+    static const int mateBound = bestScore - 1000;
 };
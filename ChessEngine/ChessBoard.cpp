@@ -8,6 +8,7 @@
  */
 
 #include "ChessBoard.h"
+#include "ChessData.h"
 
  /**
   * Get the combined bitboard of all white pieces.
@@ -49,6 +50,52 @@ uint64_t ChessBoard::getAllPieces() const
     return getAllBlackPieces() | getAllWhitePieces();
 }
 
+/**
+ * Get the hash key of the position, the piece placement combined with the side to move.
+ *
+ * @param whiteToMove True if white is to move in the position.
+ * @return The Zobrist key identifying the position.
+ */
+std::uint64_t ChessBoard::getPositionKey(bool whiteToMove) const
+{
+    return whiteToMove ? hash : hash ^ data::zobrist::keys.blackToMove;
+}
+
+/**
+ * Get the bitboard holding the positions of a type of piece.
+ *
+ * @param piece The type of chess piece, must not be EMPTY.
+ * @return A reference to the bitboard of that piece type.
+ */
+std::uint64_t& ChessBoard::getPieceBitboard(PieceType piece)
+{
+    switch (piece) {
+    case PieceType::WHITE_PAWN: return whitePawns;
+    case PieceType::WHITE_ROOK: return whiteRooks;
+    case PieceType::WHITE_KNIGHT: return whiteKnights;
+    case PieceType::WHITE_BISHOP: return whiteBishops;
+    case PieceType::WHITE_QUEEN: return whiteQueens;
+    case PieceType::WHITE_KING: return whiteKing;
+    case PieceType::BLACK_PAWN: return blackPawns;
+    case PieceType::BLACK_ROOK: return blackRooks;
+    case PieceType::BLACK_KNIGHT: return blackKnights;
+    case PieceType::BLACK_BISHOP: return blackBishops;
+    case PieceType::BLACK_QUEEN: return blackQueens;
+    default: return blackKing;
+    }
+}
+
+/**
+ * Get the bitboard holding the positions of a type of piece.
+ *
+ * @param piece The type of chess piece, must not be EMPTY.
+ * @return A reference to the bitboard of that piece type.
+ */
+const std::uint64_t& ChessBoard::getPieceBitboard(PieceType piece) const
+{
+    return const_cast<ChessBoard*>(this)->getPieceBitboard(piece);
+}
+
 /**
  * Create a deep copy of the current chessboard.
  *
@@ -75,6 +122,8 @@ ChessBoard* ChessBoard::copy() const
     copyBoard->blackKing = blackKing;
 
     copyBoard->currPlayer = currPlayer;
+    copyBoard->hash = hash;
+    copyBoard->pawnHash = pawnHash;
 
     return copyBoard;
 }
@@ -95,6 +144,16 @@ bool movePiece(std::uint8_t from, std::uint8_t to, std::uint64_t& bitboard) {
     return true;
 }
 
+/**
+ * Check if a piece is a pawn of either color.
+ *
+ * @param piece The piece type.
+ * @return True for WHITE_PAWN and BLACK_PAWN.
+ */
+static bool isPawn(ChessBoard::PieceType piece) {
+    return piece == ChessBoard::PieceType::WHITE_PAWN || piece == ChessBoard::PieceType::BLACK_PAWN;
+}
+
 /**
  * Clear the chessboard, setting all positions to EMPTY.
  */
@@ -112,6 +171,8 @@ void ChessBoard::clearBoard()
     blackBishops = 0;
     blackQueens = 0;
     blackKing = 0;
+    hash = 0;
+    pawnHash = 0;
 }
 
 /**
@@ -124,32 +185,30 @@ void ChessBoard::makeMove(std::uint8_t from, std::uint8_t to)
 {
     currPlayer = !currPlayer;
 
-    whitePawns = whitePawns & ~((std::uint64_t)1 << to);
-    whiteRooks = whiteRooks & ~((std::uint64_t)1 << to);
-    whiteKnights = whiteKnights & ~((std::uint64_t)1 << to);
-    whiteBishops = whiteBishops & ~((std::uint64_t)1 << to);
-    whiteQueens = whiteQueens & ~((std::uint64_t)1 << to);
-
-    blackPawns = blackPawns & ~((std::uint64_t)1 << to);
-    blackRooks = blackRooks & ~((std::uint64_t)1 << to);
-    blackKnights = blackKnights & ~((std::uint64_t)1 << to);
-    blackBishops = blackBishops & ~((std::uint64_t)1 << to);
-    blackQueens = blackQueens & ~((std::uint64_t)1 << to);
-
-    if (movePiece(from, to, whitePawns)) return;
-    if (movePiece(from, to, whiteRooks)) return;
-    if (movePiece(from, to, whiteKnights)) return;
-    if (movePiece(from, to, whiteBishops)) return;
-    if (movePiece(from, to, whiteQueens)) return;
-    if (movePiece(from, to, whiteKing)) return;
-
-    if (movePiece(from, to, blackPawns)) return;
-    if (movePiece(from, to, blackRooks)) return;
-    if (movePiece(from, to, blackKnights)) return;
-    if (movePiece(from, to, blackBishops)) return;
-    if (movePiece(from, to, blackQueens)) return;
-    if (movePiece(from, to, blackKing)) return;
+    // Remove any captured piece, kings are never captured.
+    const PieceType captured = getPieceTypeAtSquare(to / 8, to % 8);
+    if (captured != PieceType::EMPTY && captured != PieceType::WHITE_KING && captured != PieceType::BLACK_KING) {
+        getPieceBitboard(captured) &= ~((std::uint64_t)1 << to);
+        hash ^= data::zobrist::keys.piece[static_cast<int>(captured)][to];
+        if (isPawn(captured)) pawnHash ^= data::zobrist::keys.piece[static_cast<int>(captured)][to];
+    }
 
+    const PieceType moved = getPieceTypeAtSquare(from / 8, from % 8);
+    if (moved == PieceType::EMPTY) return;
+
+    movePiece(from, to, getPieceBitboard(moved));
+    const std::uint64_t moveKey = data::zobrist::keys.piece[static_cast<int>(moved)][from] ^ data::zobrist::keys.piece[static_cast<int>(moved)][to];
+    hash ^= moveKey;
+    if (isPawn(moved)) pawnHash ^= moveKey;
+}
+
+/**
+ * Make a null move, passing the turn to the opponent without moving a piece.
+ * Used by the search for null-move pruning, never played in a real game.
+ */
+void ChessBoard::makeNullMove()
+{
+    currPlayer = !currPlayer;
 }
 
 /**
@@ -160,23 +219,17 @@ void ChessBoard::makeMove(std::uint8_t from, std::uint8_t to)
  * @param file The file (column) where the piece should be placed.
  */
 void ChessBoard::setPiece(ChessBoard::PieceType piece, int rank, int file) {
+    // Invalid piece type or empty square
+    if (piece == PieceType::EMPTY) return;
+
     std::uint64_t bit = static_cast<std::uint64_t>(1) << (rank * 8 + file);
+    std::uint64_t& bitboard = getPieceBitboard(piece);
 
-    if (piece == PieceType::WHITE_PAWN) whitePawns |= bit;
-    else if (piece == PieceType::WHITE_ROOK) whiteRooks |= bit;
-    else if (piece == PieceType::WHITE_KNIGHT) whiteKnights |= bit;
-    else if (piece == PieceType::WHITE_BISHOP) whiteBishops |= bit;
-    else if (piece == PieceType::WHITE_QUEEN) whiteQueens |= bit;
-    else if (piece == PieceType::WHITE_KING) whiteKing |= bit;
-    else if (piece == PieceType::BLACK_PAWN) blackPawns |= bit;
-    else if (piece == PieceType::BLACK_ROOK) blackRooks |= bit;
-    else if (piece == PieceType::BLACK_KNIGHT) blackKnights |= bit;
-    else if (piece == PieceType::BLACK_BISHOP) blackBishops |= bit;
-    else if (piece == PieceType::BLACK_QUEEN) blackQueens |= bit;
-    else if (piece == PieceType::BLACK_KING) blackKing |= bit;
-    else {
-        // Invalid piece type or empty square
+    if ((bitboard & bit) == 0) {
+        hash ^= data::zobrist::keys.piece[static_cast<int>(piece)][rank * 8 + file];
+        if (isPawn(piece)) pawnHash ^= data::zobrist::keys.piece[static_cast<int>(piece)][rank * 8 + file];
     }
+    bitboard |= bit;
 }
 
 /**
@@ -55,6 +55,18 @@ struct ChessBoard
     std::uint64_t blackQueens = 0;
     std::uint64_t blackKing = 0;
 
+    /**
+     * Zobrist hash of the piece placement, kept up to date by setPiece and makeMove.
+     * The side to move is not part of it, use getPositionKey for a full position key.
+     */
+    std::uint64_t hash = 0;
+
+    /**
+     * Zobrist hash of the pawns alone, kept up to date alongside hash. Positions with the same
+     * pawn structure share it, which is what the pawn hash table is keyed by.
+     */
+    std::uint64_t pawnHash = 0;
+
     /**
      * Get the combined bitboard of all white pieces.
      *
@@ -76,6 +88,23 @@ struct ChessBoard
      */
     std::uint64_t getAllPieces() const;
 
+    /**
+     * Get the hash key of the position, the piece placement combined with the side to move.
+     *
+     * @param whiteToMove True if white is to move in the position.
+     * @return The Zobrist key identifying the position.
+     */
+    std::uint64_t getPositionKey(bool whiteToMove) const;
+
+    /**
+     * Get the bitboard holding the positions of a type of piece.
+     *
+     * @param piece The type of chess piece, must not be EMPTY.
+     * @return A reference to the bitboard of that piece type.
+     */
+    std::uint64_t& getPieceBitboard(PieceType piece);
+    const std::uint64_t& getPieceBitboard(PieceType piece) const;
+
     /**
      * Create a deep copy of the current chessboard.
      *
@@ -101,6 +130,12 @@ struct ChessBoard
      */
     void makeMove(std::uint8_t from, std::uint8_t to);
 
+    /**
+     * Make a null move, passing the turn to the opponent without moving a piece.
+     * Used by the search for null-move pruning, never played in a real game.
+     */
+    void makeNullMove();
+
     /**
      * Set a specific piece on the chessboard at the given rank and file.
      *
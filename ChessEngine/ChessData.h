@@ -193,6 +193,46 @@ a8 (square 56) -> b8 (square 57) -> c8 (square 58) -> ... -> h8 (square 63)
 			0b0000000000100000000100000000100000000100000000100000000000000000,
 			0b0000000001000000001000000001000000001000000001000000001000000000
 		};
+
+		// the files either side of a file, indexed like fileMask
+		constexpr std::uint64_t adjacentFileMask[8] = {
+			fileMask[1],
+			fileMask[0] | fileMask[2],
+			fileMask[1] | fileMask[3],
+			fileMask[2] | fileMask[4],
+			fileMask[3] | fileMask[5],
+			fileMask[4] | fileMask[6],
+			fileMask[5] | fileMask[7],
+			fileMask[6]
+		};
+
+		/*
+		* Pawn structure masks, indexed by [color][square] with color 1 for white and 0 for black.
+		* "Ahead" is towards the side's promotion rank. A pawn is passed when no enemy pawn stands
+		* on its passed pawn mask, and its attack span is every square it could ever attack.
+		*/
+		struct PawnMasks {
+			std::uint64_t forwardFile[2][64]; ///< The squares ahead on the same file.
+			std::uint64_t attackSpan[2][64];  ///< The squares ahead on the adjacent files.
+			std::uint64_t passedPawn[2][64];  ///< The squares ahead on the same and adjacent files.
+
+			constexpr PawnMasks() : forwardFile{}, attackSpan{}, passedPawn{} {
+				for (int square = 0; square < 64; square++) {
+					const int rank = square / 8;
+					const std::uint64_t whiteAhead = rank == 7 ? 0 : ~std::uint64_t(0) << (8 * (rank + 1));
+					const std::uint64_t blackAhead = (std::uint64_t(1) << (8 * rank)) - 1;
+
+					forwardFile[1][square] = whiteAhead & fileMask[square % 8];
+					forwardFile[0][square] = blackAhead & fileMask[square % 8];
+					attackSpan[1][square] = whiteAhead & adjacentFileMask[square % 8];
+					attackSpan[0][square] = blackAhead & adjacentFileMask[square % 8];
+					passedPawn[1][square] = forwardFile[1][square] | attackSpan[1][square];
+					passedPawn[0][square] = forwardFile[0][square] | attackSpan[0][square];
+				}
+			}
+		};
+
+		constexpr PawnMasks pawnMasks;
 	};
 
 	namespace magicbitboards {
@@ -461,7 +501,7 @@ a8 (square 56) -> b8 (square 57) -> c8 (square 58) -> ... -> h8 (square 63)
 			0x313e5c84a890ac07,
 			0xf9f2637fcef4d621,
 			0x4660ff907444cec4,
-			0x280105701df138b4
+			0x8210101000608020
 		};
 		
 		constexpr std::uint64_t bishopMagicKeyShift[64] = {
@@ -599,4 +639,53 @@ a8 (square 56) -> b8 (square 57) -> c8 (square 58) -> ... -> h8 (square 63)
 		};
 	}
 
+	/*
+	* Zobrist keys for hashing a position, one random key per piece type per square plus one
+	* for the side to move. A position's hash is the XOR of the keys of everything on the board,
+	* so a move updates it with a couple of XORs. The keys are generated at compile time with
+	* splitmix64 so they are identical on every build.
+	*/
+	namespace zobrist {
+
+		constexpr std::uint64_t splitMix64(std::uint64_t x) {
+			x += 0x9e3779b97f4a7c15;
+			x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+			x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+			return x ^ (x >> 31);
+		}
+
+		struct Keys {
+			std::uint64_t piece[12][64];
+			std::uint64_t blackToMove;
+
+			constexpr Keys() : piece{}, blackToMove(splitMix64(12 * 64)) {
+				for (int type = 0; type < 12; type++) {
+					for (int square = 0; square < 64; square++) {
+						piece[type][square] = splitMix64(type * 64 + square);
+					}
+				}
+			}
+		};
+
+		constexpr Keys keys;
+	}
+
+	/*
+	* Bit scanning for walking the set squares of a bitboard, portable across compilers.
+	*/
+	namespace bits {
+
+		constexpr int deBruijnSquares[64] = {
+			0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+			62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+			63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+			46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+		};
+
+		// the square (0-63) of the lowest set bit, the bitboard must not be empty
+		constexpr int lowestSquare(std::uint64_t bitboard) {
+			return deBruijnSquares[((bitboard & (~bitboard + 1)) * 0x03f79d71b4cb0a89) >> 58];
+		}
+	}
+
 }
\ No newline at end of file
@@ -0,0 +1,555 @@
+/**
+ * @file Cluster.cpp
+ *
+ * Implementation of the Cluster class, the coordinator's split of a search and the worker that
+ * searches a part of it.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "Cluster.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+#include "Commands.h"
+#include "MoveGeneration.h"
+
+// Only entries searched at least this deep travel between processes, the shallow ones are
+// quicker to search again than to send.
+static const int SHARED_DEPTH = 6;
+
+// The most entries sent with a search or its result, the deepest are kept.
+static const std::size_t SHARED_ENTRIES = 4096;
+
+// The entries sent in one "tt" line.
+static const std::size_t ENTRIES_PER_LINE = 64;
+
+// Options naming files or workers belong to the machine a process runs on. A coordinator keeps
+// them to itself and a worker refuses them, so whoever connects to a worker can't make it open
+// files or connect out.
+static const char* const LOCAL_OPTIONS[] = { "evalfile", "tablebasepath", "bookfile", "hashfile", "clusterworkers" };
+
+std::mutex Cluster::mutex;
+std::vector<Cluster::Worker> Cluster::workers;
+std::map<std::string, std::string> Cluster::options;
+bool Cluster::stopRequested = false;
+bool Cluster::ponderHitRequested = false;
+
+
+/**
+ * Check if an option is one of the machine's own, by its name in lower case.
+ */
+static bool isLocalOption(const std::string& key)
+{
+    return std::find(std::begin(LOCAL_OPTIONS), std::end(LOCAL_OPTIONS), key) != std::end(LOCAL_OPTIONS);
+}
+
+
+/**
+ * Write the deepest entries of the transposition table as "tt" lines, a batch of entries each.
+ * Must not be called during a search.
+ *
+ * @return The lines, "tt <key> <data> <key> <data> ...".
+ */
+static std::vector<std::string> tableLines()
+{
+    const std::vector<TranspositionTable::Record> records = BoardEvaluation::transpositionTable.collect(SHARED_DEPTH, SHARED_ENTRIES);
+
+    std::vector<std::string> lines;
+    for (std::size_t first = 0; first < records.size(); first += ENTRIES_PER_LINE) {
+        std::string line = "tt";
+        for (std::size_t i = first; i < records.size() && i < first + ENTRIES_PER_LINE; i++) {
+            line += " " + std::to_string(records[i].key) + " " + std::to_string(records[i].data);
+        }
+        lines.push_back(line);
+    }
+
+    return lines;
+}
+
+
+/**
+ * Store the entries of a "tt" line in the transposition table. A malformed line is ignored from
+ * the first entry that can't be read.
+ *
+ * @param tokens The tokens of the line, "tt" first.
+ */
+static void receiveTable(const std::vector<std::string>& tokens)
+{
+    try {
+        for (std::size_t i = 1; i + 1 < tokens.size(); i += 2) {
+            TranspositionTable::Record record;
+            record.key = std::stoull(tokens[i]);
+            record.data = std::stoull(tokens[i + 1]);
+            BoardEvaluation::transpositionTable.merge(record);
+        }
+    }
+    catch (const std::exception&) {
+    }
+}
+
+
+/**
+ * Read the "result" line of a worker.
+ *
+ * @param tokens The tokens of the line, "result" first.
+ * @param result Set to the result, its best move is the first of the line.
+ * @return True if the line was read.
+ */
+static bool parseResult(const std::vector<std::string>& tokens, SearchResult& result)
+{
+    if (tokens.size() < 8 || tokens[6] != "pv") return false;
+
+    try {
+        result.score = std::stoi(tokens[1]);
+        result.mateIn = std::stoi(tokens[2]);
+        result.depth = std::stoi(tokens[3]);
+        result.selDepth = std::stoi(tokens[4]);
+        result.stats.nodes = std::stoull(tokens[5]);
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+
+    result.pv.clear();
+    ChessMove move;
+    for (std::size_t i = 7; i < tokens.size() && Engine::parseMove(tokens[i], move); i++) result.pv.push_back(move);
+    if (result.pv.empty()) return false;
+
+    result.bestMove = result.pv[0];
+    result.hasPonderMove = result.pv.size() >= 2;
+    if (result.hasPonderMove) result.ponderMove = result.pv[1];
+    return true;
+}
+
+
+/**
+ * Order the results of the parts, a mate found beats any score and a shorter mate a longer one.
+ *
+ * @param result The result of a part.
+ * @return Its rank, the higher the better.
+ */
+static std::int64_t rank(const SearchResult& result)
+{
+    const std::int64_t MATE = 1000000000;
+    if (result.mateIn > 0) return MATE - result.mateIn;
+    if (result.mateIn < 0) return -MATE - result.mateIn;
+    return result.score;
+}
+
+
+/**
+ * Connect to the workers, replacing the ones connected before, and set the options the
+ * coordinator was set to on them.
+ *
+ * @param addresses The workers, "host:port" separated by commas. Empty or "<empty>" for none.
+ * @return The number of workers connected.
+ */
+int Cluster::connect(const std::string& addresses)
+{
+    std::vector<Worker> connected;
+
+    std::size_t start = 0;
+    while (addresses != "<empty>" && start < addresses.size()) {
+        const std::size_t end = std::min(addresses.find(',', start), addresses.size());
+        const std::vector<std::string> tokens = commands::tokenize(addresses.substr(start, end - start));
+        start = end + 1;
+        if (tokens.empty()) continue;
+
+        Worker worker;
+        worker.address = tokens[0];
+
+        const std::size_t colon = worker.address.rfind(':');
+        int port = 0;
+        try {
+            if (colon != std::string::npos) port = std::stoi(worker.address.substr(colon + 1));
+        }
+        catch (const std::exception&) {
+        }
+
+        if (port > 0) worker.socket = Socket::connect(worker.address.substr(0, colon), port);
+        if (!worker.socket) {
+            commands::printLine("info string can't connect to worker " + worker.address);
+            continue;
+        }
+        connected.push_back(std::move(worker));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    workers = std::move(connected);
+
+    for (Worker& worker : workers) {
+        for (const auto& option : options) worker.socket->sendLine(option.second);
+    }
+
+    return static_cast<int>(workers.size());
+}
+
+
+/**
+ * Check if searches are spread over workers.
+ *
+ * @return True while at least one worker is connected.
+ */
+bool Cluster::isActive()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::any_of(workers.begin(), workers.end(), [](const Worker& worker) { return worker.socket != nullptr; });
+}
+
+
+/**
+ * Search a position over the coordinator and its workers. The root moves are dealt round-robin,
+ * the move the transposition table holds for the position first so the coordinator, which reports
+ * its lines as they come, searches the likely best move. Each worker gets the position, the deep
+ * entries of the table and its moves, then the coordinator searches its own part and collects the
+ * workers' results and entries once it is done.
+ *
+ * @param engine The coordinator's engine, with the position to search.
+ * @param limits When the search has to end, every part gets the same limits.
+ * @param isWhite A boolean indicating the player's color (true for white, false for black).
+ * @param onInfo Called with the lines of the coordinator's part, and a last line of the whole search
+ *               unless a part finished shallower than those lines, then it is printed as an info string.
+ * @return The best result of the parts, with the nodes of every part.
+ */
+SearchResult Cluster::search(Engine& engine, const SearchLimits& limits, bool isWhite, const std::function<void(const SearchInfo&)>& onInfo)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const ChessBoard board = engine.getBoard();
+
+    std::vector<ChessMove> rootMoves = limits.searchMoves;
+    if (rootMoves.empty()) rootMoves = MoveGeneration::generateColorsLegalMoves(&board, isWhite);
+
+    TranspositionTable::Entry entry;
+    if (BoardEvaluation::transpositionTable.probe(board.getPositionKey(isWhite), entry)) {
+        const auto hashMove = std::find(rootMoves.begin(), rootMoves.end(), entry.move);
+        if (hashMove != rootMoves.end()) std::rotate(rootMoves.begin(), hashMove, hashMove + 1);
+    }
+
+    std::vector<std::size_t> live;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopRequested = false;
+        ponderHitRequested = false;
+
+        for (std::size_t i = 0; i < workers.size(); i++) {
+            if (workers[i].socket) live.push_back(i);
+        }
+    }
+
+    // a part per process, as long as there are moves for them
+    const std::size_t partCount = std::min(rootMoves.size(), live.size() + 1);
+    if (partCount < 2) return engine.search(limits, isWhite, onInfo);
+
+    std::vector<std::vector<ChessMove>> parts(partCount);
+    for (std::size_t i = 0; i < rootMoves.size(); i++) parts[i % partCount].push_back(rootMoves[i]);
+
+    // the node limit is for the whole search, shared out between the parts
+    SearchLimits partLimits = limits;
+    partLimits.searchMoves.clear();
+    if (limits.nodes > 0) partLimits.nodes = std::max<std::uint64_t>(1, limits.nodes / partCount);
+
+    std::string fen;
+    std::vector<std::string> moves;
+    engine.getPosition(fen, moves);
+
+    std::string position = "position fen " + fen + " moves";
+    for (const std::string& move : moves) position += " " + move;
+
+    std::string go = std::string("go ") + (isWhite ? "w" : "b");
+    if (partLimits.depth > 0) go += " depth " + std::to_string(partLimits.depth);
+    if (partLimits.moveTime > 0) go += " movetime " + std::to_string(partLimits.moveTime);
+    if (partLimits.nodes > 0) go += " nodes " + std::to_string(partLimits.nodes);
+    if (partLimits.mate > 0) go += " mate " + std::to_string(partLimits.mate);
+    if (partLimits.infinite) go += " infinite";
+    if (partLimits.ponder) go += " ponder";
+
+    const std::vector<std::string> table = tableLines();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (std::size_t part = 1; part < partCount; part++) {
+            Worker& worker = workers[live[part - 1]];
+
+            std::string line = go + " searchmoves";
+            for (const ChessMove& move : parts[part]) line += " " + Engine::moveToString(move);
+
+            bool sent = worker.socket->sendLine(position);
+            for (std::size_t i = 0; sent && i < table.size(); i++) sent = worker.socket->sendLine(table[i]);
+            sent = sent && worker.socket->sendLine(line);
+
+            // the worker didn't get its part, the coordinator searches it
+            if (!sent) {
+                commands::printLine("info string lost worker " + worker.address);
+                worker.socket.reset();
+                parts[0].insert(parts[0].end(), parts[part].begin(), parts[part].end());
+                parts[part].clear();
+                continue;
+            }
+
+            worker.searching = true;
+            worker.stopped = stopRequested;
+            if (stopRequested) worker.socket->sendLine("stop");
+            else if (ponderHitRequested) worker.socket->sendLine("ponderhit");
+        }
+    }
+
+    SearchLimits localLimits = partLimits;
+    localLimits.searchMoves = parts[0];
+
+    // the deepest line the coordinator reported, the last line mustn't go back below it
+    int reportedDepth = 0;
+    const auto onPartInfo = [&](const SearchInfo& info) {
+        reportedDepth = std::max(reportedDepth, info.depth);
+        if (onInfo) onInfo(info);
+    };
+
+    SearchResult best = engine.search(localLimits, isWhite, onPartInfo);
+    std::uint64_t nodes = best.stats.nodes;
+
+    // the depth every part finished, the depth reported never passes what the whole search covered
+    int depth = best.depth;
+
+    for (std::size_t part = 1; part < partCount; part++) {
+        Worker& worker = workers[live[part - 1]];
+        if (parts[part].empty()) continue;
+
+        SearchResult result;
+        bool received = false;
+        bool done = false;
+
+        std::string line;
+        while (!done && worker.socket->readLine(line)) {
+            const std::vector<std::string> tokens = commands::tokenize(line);
+            if (tokens.empty()) continue;
+
+            if (tokens[0] == "result") received = parseResult(tokens, result);
+            else if (tokens[0] == "tt") receiveTable(tokens);
+            else if (tokens[0] == "done") done = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        worker.searching = false;
+        if (!done) {
+            commands::printLine("info string lost worker " + worker.address);
+            worker.socket.reset();
+        }
+
+        if (!received) continue;
+        nodes += result.stats.nodes;
+        depth = std::min(depth, result.depth);
+
+        if (rank(result) > rank(best)) {
+            const SearchStats stats = best.stats;
+            best = result;
+            best.stats = stats;
+        }
+    }
+
+    best.stats.nodes = nodes;
+    best.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // the coordinator's lines only covered its own moves, end with the line of the whole search, at
+    // the depth every part finished. Below the depth already reported it is only a summary.
+    if (onInfo) {
+        SearchInfo info;
+        info.depth = depth;
+        info.selDepth = best.selDepth;
+        info.score = best.score;
+        info.mateIn = best.mateIn;
+        info.nodes = nodes;
+        info.time = best.time;
+        info.nps = best.time > 0 ? nodes * 1000 / static_cast<std::uint64_t>(best.time) : nodes;
+        info.hashFull = BoardEvaluation::transpositionTable.hashFull();
+        info.tbHits = best.stats.tablebaseHits;
+        info.pv = best.pv;
+
+        if (depth >= reportedDepth) onInfo(info);
+        else commands::printLine("info string whole search " + commands::formatInfo(info).substr(5));
+    }
+
+    return best;
+}
+
+
+/**
+ * End the workers' parts of the running search, each is told once. A part sent after this is
+ * told straight away.
+ */
+void Cluster::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stopRequested = true;
+
+    for (Worker& worker : workers) {
+        if (!worker.socket || !worker.searching || worker.stopped) continue;
+        worker.stopped = true;
+        worker.socket->sendLine("stop");
+    }
+}
+
+
+/**
+ * Turn the workers' parts of the running ponder search into normal searches.
+ */
+void Cluster::ponderHit()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ponderHitRequested = true;
+
+    for (Worker& worker : workers) {
+        if (worker.socket && worker.searching && !worker.stopped) worker.socket->sendLine("ponderhit");
+    }
+}
+
+
+/**
+ * Set an option on the workers, now and on every worker connected later. Setting an option
+ * again replaces the line sent to later workers. Options naming files or workers aren't sent,
+ * each worker is given its own when it starts.
+ *
+ * @param name The name of the option.
+ * @param line The "setoption" line that set it on the coordinator.
+ */
+void Cluster::setOption(const std::string& name, const std::string& line)
+{
+    std::string key = name;
+    std::transform(key.begin(), key.end(), key.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    if (isLocalOption(key)) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    options[key] = line;
+
+    for (Worker& worker : workers) {
+        if (worker.socket) worker.socket->sendLine(line);
+    }
+}
+
+
+/**
+ * Run as a worker: serve coordinators one after another, until the port can't be listened on.
+ * The transposition table is kept from one coordinator to the next.
+ *
+ * @param address The local address to listen on, "127.0.0.1" unless coordinators on other machines connect.
+ * @param port The port to listen on.
+ * @return The exit code of the process.
+ */
+int Cluster::serve(const std::string& address, int port)
+{
+    std::unique_ptr<Socket> listener = Socket::listen(address, port);
+    if (!listener) {
+        commands::printLine("info string can't listen on " + address + " port " + std::to_string(port));
+        return 1;
+    }
+    commands::printLine("info string worker listening on " + address + " port " + std::to_string(port));
+
+    for (;;) {
+        std::unique_ptr<Socket> coordinator = listener->accept();
+        if (!coordinator) return 1;
+
+        commands::printLine("info string coordinator connected");
+        serveCoordinator(*coordinator);
+        commands::printLine("info string coordinator disconnected");
+    }
+}
+
+
+/**
+ * Serve one coordinator until it disconnects. Its lines are read on this thread and a search
+ * runs on a thread of its own, so a stop or ponderhit reaches it while it searches. A search
+ * ends by sending its result, the deep entries of the table and "done".
+ *
+ * @param coordinator The connection to the coordinator.
+ */
+void Cluster::serveCoordinator(Socket& coordinator)
+{
+    Engine engine;
+    std::thread searchThread;
+    std::atomic<bool> searchRunning(false);
+
+    const auto endSearch = [&engine, &searchThread]() {
+        engine.stop();
+        if (searchThread.joinable()) searchThread.join();
+    };
+
+    std::string line;
+    while (coordinator.readLine(line)) {
+        const std::vector<std::string> tokens = commands::tokenize(line);
+        if (!tokens.empty() && tokens[0] == "tt") {
+            receiveTable(tokens);
+            continue;
+        }
+
+        const commands::Command command = commands::parseCommand(line);
+        switch (command.type) {
+        case commands::CommandType::POSITION: {
+            std::string fen;
+            std::vector<std::string> moves;
+            if (commands::parsePosition(command.args, fen, moves) && engine.setPosition(fen, moves) != Engine::PositionStatus::OK) {
+                commands::printLine("info string can't set up the position of the coordinator");
+            }
+            break;
+        }
+
+        case commands::CommandType::GO: {
+            endSearch();
+
+            bool isWhite = engine.getBoard().currPlayer;
+            const SearchLimits limits = commands::parseGo(command.args, isWhite);
+
+            searchRunning = true;
+            searchThread = std::thread([&engine, &coordinator, &searchRunning, limits, isWhite]() {
+                const SearchResult result = engine.search(limits, isWhite);
+
+                std::string line = "result " + std::to_string(result.score) + " " + std::to_string(result.mateIn)
+                    + " " + std::to_string(result.depth) + " " + std::to_string(result.selDepth)
+                    + " " + std::to_string(result.stats.nodes) + " pv";
+                for (const ChessMove& move : result.pv) line += " " + Engine::moveToString(move);
+
+                coordinator.sendLine(line);
+                for (const std::string& entries : tableLines()) coordinator.sendLine(entries);
+                coordinator.sendLine("done");
+                searchRunning = false;
+            });
+
+            // a stop read before the search starts would be missed, wait for it to start
+            while (searchRunning && !engine.isSearching()) std::this_thread::yield();
+            break;
+        }
+
+        case commands::CommandType::STOP: engine.stop(); break;
+        case commands::CommandType::PONDERHIT: engine.ponderHit(); break;
+
+        case commands::CommandType::SETOPTION: {
+            // the name is every word between "name" and "value"
+            const auto nameStart = std::find(command.args.begin(), command.args.end(), "name");
+            std::string key;
+            for (auto word = nameStart == command.args.end() ? nameStart : nameStart + 1; word != command.args.end() && *word != "value"; ++word) {
+                key += (key.empty() ? "" : " ") + *word;
+            }
+            std::transform(key.begin(), key.end(), key.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+            if (isLocalOption(key)) {
+                commands::printLine("info string refused option " + key + " from the coordinator");
+                break;
+            }
+
+            endSearch();
+            commands::uci_setOption(command.args);
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    endSearch();
+}
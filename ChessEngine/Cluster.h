@@ -0,0 +1,123 @@
+/**
+ * @file Cluster.h
+ *
+ * Declaration of the Cluster class, a search split over several engine processes.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Engine.h"
+#include "Socket.h"
+
+/**
+ * @class Cluster
+ *
+ * Spreads a search over worker processes, on this machine or others, for more cores than one
+ * machine has. A worker is the engine started as "worker <port> [bind address]", it serves one
+ * coordinator at a time over TCP, on 127.0.0.1 unless given another address. The coordinator is
+ * a normal engine with the ClusterWorkers option set to its workers, "host:port,host:port". The
+ * workers get every option the coordinator is set to except those naming files or workers, which
+ * a worker is given on its command line and refuses from a coordinator.
+ *
+ * A search splits the root moves round-robin into a part per process, the coordinator keeping the
+ * first part, and every part is searched as a whole search of its own, restricted to its moves
+ * like "go searchmoves". The best result of the parts wins, a mate before any score. The deep
+ * entries of the transposition table travel with the search: the coordinator sends its own with
+ * the position and every worker sends back its own with its result, in batches of one line each.
+ *
+ * The protocol is lines of text. The coordinator sends "position", "tt <key> <data> ...", "go",
+ * "stop", "ponderhit" and "setoption" lines, the commands of the command line front end, and a
+ * worker answers a search with "result <score> <mate> <depth> <seldepth> <nodes> pv <moves>",
+ * its "tt" lines and "done". A worker that can't be reached is dropped, its moves searched by the
+ * coordinator when it drops before its search starts and lost when it drops during it.
+ */
+class Cluster
+{
+public:
+    /**
+     * Connect to the workers, replacing the ones connected before. Must not be called during a search.
+     *
+     * @param addresses The workers, "host:port" separated by commas. Empty or "<empty>" for none.
+     * @return The number of workers connected.
+     */
+    static int connect(const std::string& addresses);
+
+    /**
+     * Check if searches are spread over workers.
+     *
+     * @return True while at least one worker is connected.
+     */
+    static bool isActive();
+
+    /**
+     * Search a position over the coordinator and its workers. Blocks until every part has ended.
+     *
+     * @param engine The coordinator's engine, with the position to search.
+     * @param limits When the search has to end, every part gets the same limits.
+     * @param isWhite A boolean indicating the player's color (true for white, false for black).
+     * @param onInfo Called with the lines of the coordinator's part, and a last line of the whole search
+     *               unless a part finished shallower than those lines, then it is printed as an info string.
+     * @return The best result of the parts, with the nodes of every part.
+     */
+    static SearchResult search(Engine& engine, const SearchLimits& limits, bool isWhite, const std::function<void(const SearchInfo&)>& onInfo);
+
+    /**
+     * End the workers' parts of the running search, each is told once. The coordinator's own part
+     * is stopped as any other search.
+     */
+    static void stop();
+
+    /**
+     * Turn the workers' parts of the running ponder search into normal searches.
+     */
+    static void ponderHit();
+
+    /**
+     * Set an option on the workers, now and on every worker connected later.
+     *
+     * @param name The name of the option.
+     * @param line The "setoption" line that set it on the coordinator.
+     */
+    static void setOption(const std::string& name, const std::string& line);
+
+    /**
+     * Run as a worker: serve coordinators one after another, until the port can't be listened on.
+     *
+     * @param address The local address to listen on, "127.0.0.1" unless coordinators on other machines connect.
+     * @param port The port to listen on.
+     * @return The exit code of the process.
+     */
+    static int serve(const std::string& address, int port);
+
+private:
+    /**
+     * @struct Worker
+     * A connected worker process.
+     */
+    struct Worker {
+        std::string address;            ///< "host:port", for messages.
+        std::unique_ptr<Socket> socket; ///< The connection, null once the worker dropped.
+        bool searching = false;         ///< True while a part of the running search was sent to it.
+        bool stopped = false;           ///< True once it was told to stop the running search.
+    };
+
+    /**
+     * Serve one coordinator until it disconnects.
+     */
+    static void serveCoordinator(Socket& coordinator);
+
+    static std::mutex mutex;                           ///< Guards the workers' sockets and flags, and the options.
+    static std::vector<Worker> workers;                ///< The connected workers, in the order of the option.
+    static std::map<std::string, std::string> options; ///< The setoption line of every option set, by lower case name.
+    static bool stopRequested;                         ///< Set once the running search was told to stop.
+    static bool ponderHitRequested;                    ///< Set once the running ponder search was told of a ponderhit.
+};
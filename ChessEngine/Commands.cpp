@@ -12,17 +12,284 @@
 #include "Commands.h"
 #include "MoveGeneration.h"
 #include "BoardEvaluation.h"
+#include "Cluster.h"
+#include "Engine.h"
+#include "OpeningBook.h"
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// The search runs on its own thread so commands are still read while it thinks.
+static std::thread searchThread;
+static std::atomic<bool> searchRunning(false);
+static bool searchIsInfinite = false;
+
+// The engine of the last search, the one stop and ponderhit go to.
+static Engine* searchEngine = nullptr;
+static std::mutex outputMutex;
+
+// The book is only used for the first bookDepth plies after the position command's position.
+static int bookDepth = 20;
+
+// The file the transposition table is loaded from when set and saved to on quit.
+static std::string hashFile;
+
+// True when the transposition table is spread over every NUMA node.
+static bool numaInterleave = false;
+
+// True after "debug on", every search then ends with its counters as info strings.
+static bool debugMode = false;
+
+
+// The name of every command, looked up once per token until a line's command is found.
+static const std::unordered_map<std::string, commands::CommandType> commandNames = {
+    { "uci", commands::CommandType::UCI },
+    { "debug", commands::CommandType::DEBUG },
+    { "isready", commands::CommandType::ISREADY },
+    { "setoption", commands::CommandType::SETOPTION },
+    { "register", commands::CommandType::REGISTER },
+    { "ucinewgame", commands::CommandType::UCINEWGAME },
+    { "position", commands::CommandType::POSITION },
+    { "go", commands::CommandType::GO },
+    { "stop", commands::CommandType::STOP },
+    { "ponderhit", commands::CommandType::PONDERHIT },
+    { "quit", commands::CommandType::QUIT },
+    { "display", commands::CommandType::DISPLAY },
+    { "moves", commands::CommandType::MOVES },
+    { "check", commands::CommandType::CHECK },
+    { "mate", commands::CommandType::MATE },
+    { "piece", commands::CommandType::PIECE },
+    { "move", commands::CommandType::MOVE },
+    { "toggle", commands::CommandType::TOGGLE },
+    { "stats", commands::CommandType::STATS },
+    { "savehash", commands::CommandType::SAVEHASH },
+    { "loadhash", commands::CommandType::LOADHASH }
+};
+
+
+/**
+ * Splits a line into its whitespace separated tokens, in one pass over the line.
+ *
+ * @param line The line to split.
+ * @return The tokens, in the order of the line.
+ */
+std::vector<std::string> commands::tokenize(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    std::size_t i = 0;
+
+    while (i < line.size()) {
+        while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) i++;
+
+        const std::size_t start = i;
+        while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i]))) i++;
+
+        if (i > start) tokens.emplace_back(line, start, i - start);
+    }
+
+    return tokens;
+}
+
+
+/**
+ * Identifies the command of a line. The first token naming a command decides it and the tokens
+ * after it become its arguments, unknown tokens before it are skipped. Every token is looked
+ * at once at most, so the time is linear in the length of the line.
+ *
+ * @param line The line to parse.
+ * @return The command, of type NONE when no token names one.
+ */
+commands::Command commands::parseCommand(const std::string& line)
+{
+    std::vector<std::string> tokens = tokenize(line);
+    Command command;
+
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        const auto name = commandNames.find(tokens[i]);
+        if (name == commandNames.end()) continue;
+
+        command.type = name->second;
+        command.args.assign(std::make_move_iterator(tokens.begin() + i + 1), std::make_move_iterator(tokens.end()));
+        break;
+    }
+
+    return command;
+}
+
+
+/**
+ * Checks if a token is a square in algebraic notation, such as "e4".
+ *
+ * @param token The token.
+ * @param offset Where in the token the square starts.
+ * @return True if the two characters at offset are a square.
+ */
+static bool isSquare(const std::string& token, std::size_t offset)
+{
+    return token.size() >= offset + 2
+        && token[offset] >= 'a' && token[offset] <= 'h'
+        && token[offset + 1] >= '1' && token[offset + 1] <= '8';
+}
+
+
+/**
+ * Checks if a token is a move in long algebraic notation, such as "e2e4".
+ *
+ * @param token The token.
+ * @return True if the token is a move.
+ */
+static bool isMoveToken(const std::string& token)
+{
+    return token.size() == 4 && isSquare(token, 0) && isSquare(token, 2);
+}
+
+
+/**
+ * Reads a whole number token, clocks can be negative so a leading minus is allowed.
+ *
+ * @param token The token.
+ * @param value Set to the number.
+ * @return True if the token is a number that fits in value.
+ */
+static bool parseNumber(const std::string& token, std::int64_t& value)
+{
+    const std::size_t digits = token.size() - (!token.empty() && token[0] == '-' ? 1 : 0);
+    if (digits == 0 || digits > 18) return false;
+    if (!std::all_of(token.end() - digits, token.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; })) return false;
+
+    value = std::stoll(token);
+    return true;
+}
+
+
+/**
+ * Joins tokens back together with single spaces, for values such as paths that may contain spaces.
+ *
+ * @param args The tokens.
+ * @param first The first token to join.
+ * @param last One past the last token to join.
+ * @return The joined tokens.
+ */
+static std::string joinTokens(const std::vector<std::string>& args, std::size_t first, std::size_t last)
+{
+    std::string joined;
+    for (std::size_t i = first; i < last && i < args.size(); i++) {
+        if (!joined.empty()) joined += ' ';
+        joined += args[i];
+    }
+    return joined;
+}
+
+
+/**
+ * @struct EngineOption
+ * An option the engine offers, announced by the "uci" command and changed by "setoption".
+ */
+struct EngineOption {
+    std::string name;
+    std::string type;         ///< "spin", "check", "string" or "button", as in the UCI protocol.
+    std::string defaultValue; ///< Empty for a button.
+    int min = 0;              ///< The least value of a spin option.
+    int max = 0;              ///< The greatest value of a spin option.
+    std::function<void(const std::string& value, int number)> apply; ///< Applies a new value, number holds it for a spin option.
+};
+
+
+// Every option of the engine, in the order the "uci" command announces them.
+static const std::vector<EngineOption> engineOptions = {
+    { "Hash", "spin", "16", 1, 65536, [](const std::string&, int number) {
+        TranspositionTable& table = BoardEvaluation::transpositionTable;
+        table.resize(static_cast<std::size_t>(number), BoardEvaluation::threadCount, numaInterleave);
+        commands::printLine("info string " + table.memoryReport());
+    } },
+    { "Clear Hash", "button", "", 0, 0, [](const std::string&, int) {
+        BoardEvaluation::transpositionTable.clear(BoardEvaluation::threadCount);
+    } },
+    { "Threads", "spin", "1", 1, 512, [](const std::string&, int number) {
+        BoardEvaluation::setThreadCount(number);
+    } },
+    { "MultiPV", "spin", "1", 1, 256, [](const std::string&, int number) {
+        BoardEvaluation::multiPv = number;
+    } },
+    { "Ponder", "check", "false", 0, 0, [](const std::string&, int) {
+        // the engine ponders whenever it is told "go ponder", the option only tells the GUI it can
+    } },
+    { "EvalFile", "string", "<empty>", 0, 0, [](const std::string& value, int) {
+        if (Nnue::load(value)) commands::printLine("info string loaded network " + value);
+        else commands::printLine("info string could not load network " + value + ", evaluating by material");
+    } },
+    { "TablebasePath", "string", "<empty>", 0, 0, [](const std::string& value, int) {
+        const int tables = Tablebase::init(value);
+        if (tables > 0) commands::printLine("info string found " + std::to_string(tables) + " tablebases of up to " + std::to_string(Tablebase::largestTable()) + " pieces");
+        else commands::printLine("info string no tablebases found");
+    } },
+    { "ProbeDepth", "spin", "1", 1, 100, [](const std::string&, int number) {
+        BoardEvaluation::probeDepth = number;
+    } },
+    { "BookFile", "string", "<empty>", 0, 0, [](const std::string& value, int) {
+        if (OpeningBook::open(value)) commands::printLine("info string loaded book " + value + " with " + std::to_string(OpeningBook::size()) + " entries");
+        else commands::printLine("info string no book loaded");
+    } },
+    { "BookDepth", "spin", "20", 0, 1000, [](const std::string&, int number) {
+        bookDepth = number;
+    } },
+    { "HashFile", "string", "<empty>", 0, 0, [](const std::string& value, int) {
+        hashFile = value == "<empty>" ? "" : value;
+        if (!hashFile.empty() && BoardEvaluation::transpositionTable.load(hashFile)) commands::printLine("info string loaded hash from " + hashFile);
+    } },
+    { "NumaInterleave", "check", "false", 0, 0, [](const std::string& value, int) {
+        numaInterleave = value == "true";
+        TranspositionTable& table = BoardEvaluation::transpositionTable;
+        table.resize(table.megabytes(), BoardEvaluation::threadCount, numaInterleave);
+        commands::printLine("info string " + table.memoryReport());
+    } },
+    { "ClusterWorkers", "string", "<empty>", 0, 0, [](const std::string& value, int) {
+        commands::printLine("info string connected to " + std::to_string(Cluster::connect(value)) + " workers");
+    } }
+};
+
+
+/**
+ * Compares two option names, which UCI says are not case sensitive.
+ */
+static bool sameOptionName(const std::string& a, const std::string& b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+
+/**
+ * Writes a line of output. Both the command thread and the search thread write to standard
+ * output, the lock keeps their lines from being interleaved.
+ *
+ * @param line The line to write, without the line ending.
+ */
+void commands::printLine(const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << line << std::endl;
+}
 
 
 /**
 * Displays the current state of the chessboard in the console.
 *
-* @param board Pointer to the ChessBoard object representing the current game state.
+* @param engine The engine whose position is displayed.
 */
-void commands::engine_display(const ChessBoard* board)
+void commands::engine_display(const Engine* engine)
 {
+    const ChessBoard position = engine->getBoard();
+    const ChessBoard* board = &position;
+
     const char pieceSymbols[] = {
     '-', // ChessBoard::PieceType::EMPTY
     'P', // ChessBoard::PieceType::WHITE_PAWN
@@ -39,37 +306,54 @@ void commands::engine_display(const ChessBoard* board)
     'k'  // ChessBoard::PieceType::BLACK_KING
     };
 
-    std::cout << std::endl;
+    // the board is written as one block, so no line of a running search lands inside it
+    std::string text = "\n";
     for (std::int8_t i = 63; i >= 0; i--)
     {
-        if (i % 8 == 7) std::cout << " " << (i / 8) + 1 << " | ";
+        if (i % 8 == 7) text += " " + std::to_string((i / 8) + 1) + " | ";
 
         ChessBoard::PieceType piece = board->getPieceTypeAtSquare(i / 8, i % 8);
         char currSquare = pieceSymbols[static_cast<int>(piece)+1];
 
-        std::cout << currSquare << ' ';
-        if (i % 8 == 0) std::cout << std::endl;
+        text += currSquare;
+        text += ' ';
+        if (i % 8 == 0) text += '\n';
     }
 
-    std::cout << "   '----------------" << std::endl << "     a b c d e f g h\n" << std::endl;
-    std::cout << (board->currPlayer ? "      Whites's Move" : "      Black's Move") << std::endl;
+    text += "   '----------------\n     a b c d e f g h\n\n";
+    text += board->currPlayer ? "      Whites's Move" : "      Black's Move";
+    printLine(text);
 }
 
 /**
-* Placeholder function for processing the "uci" command.
+* Processes the "uci" command, identifies the engine and announces every option it offers,
+* then "uciok" to tell the GUI the engine is ready for the protocol.
 */
 void commands::uci_uci()
 {
+    printLine("id name ChessEngine");
+    printLine("id author Martin N");
+
+    for (const EngineOption& option : engineOptions) {
+        std::string line = "option name " + option.name + " type " + option.type;
+        if (option.type != "button") line += " default " + option.defaultValue;
+        if (option.type == "spin") line += " min " + std::to_string(option.min) + " max " + std::to_string(option.max);
+        printLine(line);
+    }
+
+    printLine("uciok");
 }
 
 
 /**
-* Placeholder function for processing the "debug" command.
+* Processes the "debug" command. In debug mode every search ends with its counters, the ones
+* the "stats" command prints, sent as info strings.
 *
-* @param mode The debug mode (either "on" or "off").
+* @param args The arguments of the "debug" command, the debug mode (either "on" or "off").
 */
-void commands::uci_debug(std::string mode)
+void commands::uci_debug(const std::vector<std::string>& args)
 {
+    if (!args.empty() && (args[0] == "on" || args[0] == "off")) debugMode = args[0] == "on";
 }
 
 /**
@@ -77,14 +361,20 @@ void commands::uci_debug(std::string mode)
 */
 void commands::uci_isready()
 {
-    std::cout << "readyok" << std::endl;
+    printLine("readyok");
 }
 
 /**
- * Placeholder function for processing the "ucinewgame" command.
+ * Processes the "ucinewgame" command. The next position belongs to another game, so the move
+ * ordering and the game's positions are forgotten. The transposition table is only aged, it
+ * would take longer to zero than the GUI should wait; "Clear Hash" empties it.
  */
-void commands::uci_newGame()
+void commands::uci_newGame(Engine* engine)
 {
+    uci_stop();
+    engine->newGame();
+
+    engine->setPosition(Engine::startFen, std::vector<std::string>());
 }
 
 /**
@@ -119,227 +409,407 @@ std::string numericToSquare(int numeric) {
 }
 
 /**
- * Processes the "position" command in UCI and updates the chessboard accordingly.
+ * Reads the arguments of a "position" command. The position is "startpos" or "fen" followed by
+ * the FEN fields, "fen" may be left out. The moves follow, after an optional "moves" token.
  *
- * @param board Pointer to the ChessBoard object representing the current game state.
- * @param details The details of the "position" command, including FEN and move history.
+ * @param args The arguments of the "position" command.
+ * @param fen Set to the FEN of the position.
+ * @param moves Set to the moves played from it.
+ * @return False if the command names no position.
  */
-void commands::uci_position(ChessBoard* board, std::string details)
+bool commands::parsePosition(const std::vector<std::string>& args, std::string& fen, std::vector<std::string>& moves)
 {
-    // Remove spaces using erase-remove idiom
-    details.erase(std::remove_if(details.begin(), details.end(), ::isspace), details.end());
-
-    std::smatch match;
-    if (std::regex_match(details, match, uci_positionCmd)) {
+    std::size_t next = 0;
+    fen = Engine::startFen;
 
-        // Check which part of the regex was matched
-        if (match[2].str() == "startpos") {
-
-            std::string replacement = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
-
-            std::regex pattern("startpos");
-            details = std::regex_replace(details, pattern, replacement);
-            return uci_position(board, details);
+    if (next < args.size() && args[next] == "startpos") {
+        next++;
+    }
+    else {
+        if (next < args.size() && args[next] == "fen") next++;
+        if (next >= args.size()) return false;
 
-        }
+        // the placement, the side to move, and the castling rights, en passant square and move
+        // counters, which the engine doesn't use
+        const std::size_t first = next++;
+        if (next < args.size() && (args[next] == "w" || args[next] == "b")) next++;
+        for (int field = 0; field < 4 && next < args.size() && args[next] != "moves" && !isMoveToken(args[next]); field++) next++;
 
-        // It's the FEN variant
-        std::string fen = match[3].str();
-        std::string color = match[4].str();
-        std::string castlingRights = match[5].str();
-        std::string enPassant = match[7].str();
-        std::string halfMoves = match[9].str();
-        std::string fullMoves = match[10].str();
-
-        bool whitesMove = color == "w";
-        commands::loadFEN(board, fen);
-        board->currPlayer = whitesMove;
-
-
-        // Handle the moves
-        std::string moves = match[11].str();
-        std::regex moveRegex(R"([a-h][1-8][a-h][1-8])");
-        std::sregex_iterator it(moves.begin(), moves.end(), moveRegex);
-        std::sregex_iterator end;
-
-        while (it != end) {
-            std::string currMove = it->str();
-            int fromSquare = squareToNumeric(currMove.substr(0, 2));
-            int toSquare = squareToNumeric(currMove.substr(2, 4));
-
-            // verify is legal move
-            std::vector<ChessMove> fromSquareLegals = MoveGeneration::generateSquaresLegalMoves(board, fromSquare, whitesMove);
-            
-            bool isLegal = false;
-            for (ChessMove move : fromSquareLegals) {
-                if (move.toSquare == toSquare) {
-                    isLegal = true;
-                    break;
-                }
-            }
+        fen = joinTokens(args, first, next);
+    }
 
-            if (!isLegal) {
-                std::cout << "illegal move: " << currMove.substr(0, 2) << "->" << currMove.substr(2, 4) << std::endl;
-                board->clearBoard();
-                return;
-            }
+    if (next < args.size() && args[next] == "moves") next++;
+    moves.assign(args.begin() + next, args.end());
+    return true;
+}
 
-            board->makeMove(fromSquare, toSquare);
 
-            whitesMove = !whitesMove;
-            ++it;
-        }
+/**
+ * Processes the "position" command in UCI and updates the chessboard accordingly. The engine
+ * only changes its position once the whole command is read, a command with an invalid FEN is
+ * ignored and one with an illegal move clears the board.
+ *
+ * @param engine The engine whose position is set up.
+ * @param args The arguments of the "position" command, the position and the moves played from it.
+ */
+void commands::uci_position(Engine* engine, const std::vector<std::string>& args)
+{
+    std::string fen;
+    std::vector<std::string> moves;
+    if (!parsePosition(args, fen, moves)) return;
+
+    std::size_t illegalMove = 0;
+    switch (engine->setPosition(fen, moves, &illegalMove)) {
+    case Engine::PositionStatus::OK:
+        break;
+
+    case Engine::PositionStatus::INVALID_FEN:
+        printLine("info string invalid fen " + fen.substr(0, fen.find(' ')));
+        break;
+
+    case Engine::PositionStatus::ILLEGAL_MOVE:
+        printLine("illegal move: " + moves[illegalMove]);
+        engine->setBoard(ChessBoard());
+        break;
     }
 }
 
 
 /**
- * Processes the "go" command in UCI and selects the best move for the engine to play.
+ * Formats a count as a percentage of a total.
  *
- * @param board Pointer to the ChessBoard object representing the current game state.
- * @param details The details of the "go" command, including the time control information.
+ * @param count The count.
+ * @param total The total, may be 0.
+ * @return The percentage with one decimal, for example "93.2%".
  */
-void commands::uci_go(ChessBoard* board, std::string details)
+static std::string percentage(std::uint64_t count, std::uint64_t total)
 {
-    std::smatch match;
-    std::regex_match(details, match, uci_goCmd);
+    const std::uint64_t permille = total == 0 ? 0 : count * 1000 / total;
+    return std::to_string(permille / 10) + "." + std::to_string(permille % 10) + "%";
+}
 
-    ChessMove bestMove = BoardEvaluation::getBestNextMove(board, stoi(match[2]), match[1] == "w");
-    std::string fromSq = numericToSquare(bestMove.fromSquare);
-    std::string toSq = numericToSquare(bestMove.toSquare);
 
-    std::cout << "\nBest Move " << fromSq << toSq << std::endl;
+/**
+ * Formats the counters of a search, one counter per line.
+ *
+ * @param stats The counters.
+ * @return The lines, for example "nodes            52000".
+ */
+static std::vector<std::string> formatStats(const SearchStats& stats)
+{
+    return {
+        "nodes            " + std::to_string(stats.nodes),
+        "qnodes           " + std::to_string(stats.qNodes) + " (" + percentage(stats.qNodes, stats.nodes) + ")",
+        "seldepth         " + std::to_string(stats.selDepth),
+        "tt hits          " + std::to_string(stats.tableHits) + " / " + std::to_string(stats.tableProbes) + " (" + percentage(stats.tableHits, stats.tableProbes) + ")",
+        "first move cuts  " + std::to_string(stats.firstMoveCutoffs) + " / " + std::to_string(stats.betaCutoffs) + " (" + percentage(stats.firstMoveCutoffs, stats.betaCutoffs) + ")",
+        "null move cuts   " + std::to_string(stats.nullMoveCutoffs) + " / " + std::to_string(stats.nullMoveTries) + " (" + percentage(stats.nullMoveCutoffs, stats.nullMoveTries) + ")",
+        "pawn hash hits   " + std::to_string(stats.pawnHits) + " / " + std::to_string(stats.pawnProbes) + " (" + percentage(stats.pawnHits, stats.pawnProbes) + ")",
+        "tb hits          " + std::to_string(stats.tablebaseHits),
+        "eval cache hits  " + std::to_string(stats.evalHits) + " / " + std::to_string(stats.evalProbes) + " (" + percentage(stats.evalHits, stats.evalProbes) + ")",
+        "lmr held         " + std::to_string(stats.lmrSearches - stats.lmrResearches) + " / " + std::to_string(stats.lmrSearches) + " (" + percentage(stats.lmrSearches - stats.lmrResearches, stats.lmrSearches) + ")"
+    };
 }
 
 
 /**
- * Loads a chessboard state from a Forsyth-Edwards Notation (FEN) string.
+ * Formats a line of search output as a UCI "info" line.
  *
- * @param board Pointer to the ChessBoard object to update.
- * @param fen The FEN string representing the desired chessboard state.
- * @return True if the FEN was successfully loaded; otherwise, false.
+ * @param info The line reported by the search.
+ * @return The "info" line, for example "info depth 6 seldepth 12 multipv 1 score cp 35 nodes 52000
+ *         nps 410000 hashfull 12 tbhits 0 time 126 pv e2e4 e7e5".
  */
-bool commands::loadFEN(ChessBoard* board, const std::string& fen) {
-    if (fen.empty()) return false; // Empty FEN string
+std::string commands::formatInfo(const SearchInfo& info)
+{
+    std::string line = "info depth " + std::to_string(info.depth) + " seldepth " + std::to_string(info.selDepth)
+        + " multipv " + std::to_string(info.multiPv);
+
+    if (info.mateIn != 0) line += " score mate " + std::to_string(info.mateIn);
+    else line += " score cp " + std::to_string(info.score);
 
-    int rank = 7; // Start from rank 8 (index 7 in an array)
-    int file = 7; // Start from file A (index 7 in an array)
+    line += " nodes " + std::to_string(info.nodes) + " nps " + std::to_string(info.nps)
+        + " hashfull " + std::to_string(info.hashFull) + " tbhits " + std::to_string(info.tbHits)
+        + " time " + std::to_string(info.time);
 
-    board->clearBoard();
+    line += " pv";
+    for (const ChessMove& move : info.pv) line += " " + Engine::moveToString(move);
 
-    for (char fenChar : fen) {
-        if (fenChar == '/') {
-            // Move to the next rank
-            rank--;
-            file = 7;
-            continue;
+    return line;
+}
+
+
+/**
+ * Reads the search limits of a "go" command. Without a depth, movetime, nodes, mate or clock the
+ * search is infinite.
+ *
+ * Besides the UCI arguments the engine accepts a color, "w" or "b", to search for instead of the
+ * side to move, and a bare number as the depth. With only the clocks given the search gets the
+ * remaining time of its side divided by the moves to go, 30 when unknown, plus half the increment.
+ *
+ * @param args The arguments of the "go" command.
+ * @param isWhite The side to move, set to the color to search for.
+ * @return The search limits.
+ */
+SearchLimits commands::parseGo(const std::vector<std::string>& args, bool& isWhite)
+{
+    SearchLimits limits;
+    std::int64_t clock[2] = { -1, -1 };
+    std::int64_t increment[2] = { 0, 0 };
+    std::int64_t movesToGo = 0;
+
+    for (std::size_t i = 0; i < args.size(); i++) {
+        const std::string& token = args[i];
+        std::int64_t value = 0;
+
+        if (token == "ponder") limits.ponder = true;
+        else if (token == "infinite") limits.infinite = true;
+        else if (token == "w" || token == "b") isWhite = token == "w";
+        else if (token == "searchmoves") {
+            ChessMove move;
+            while (i + 1 < args.size() && Engine::parseMove(args[i + 1], move)) {
+                limits.searchMoves.push_back(move);
+                i++;
+            }
         }
-        if (rank < 0 || file < 0) return false; // Invalid FEN string format
-        
-       
-        else if (isdigit(fenChar)) {
-            // Empty squares
-            int emptySquares = fenChar - '0';
-            file -= emptySquares;
+        else if (parseNumber(token, value)) {
+            if (value > 0) limits.depth = static_cast<int>(std::min<std::int64_t>(value, 1000));
         }
-        else {
-            // Non-empty squares (pieces)
-            ChessBoard::PieceType piece;
-            switch (fenChar) {
-                case 'P': piece = ChessBoard::PieceType::WHITE_PAWN; break;
-                case 'R': piece = ChessBoard::PieceType::WHITE_ROOK; break;
-                case 'N': piece = ChessBoard::PieceType::WHITE_KNIGHT; break;
-                case 'B': piece = ChessBoard::PieceType::WHITE_BISHOP; break;
-                case 'Q': piece = ChessBoard::PieceType::WHITE_QUEEN; break;
-                case 'K': piece = ChessBoard::PieceType::WHITE_KING; break;
-                case 'p': piece = ChessBoard::PieceType::BLACK_PAWN; break;
-                case 'r': piece = ChessBoard::PieceType::BLACK_ROOK; break;
-                case 'n': piece = ChessBoard::PieceType::BLACK_KNIGHT; break;
-                case 'b': piece = ChessBoard::PieceType::BLACK_BISHOP; break;
-                case 'q': piece = ChessBoard::PieceType::BLACK_QUEEN; break;
-                case 'k': piece = ChessBoard::PieceType::BLACK_KING; break;
-                default: return false; // Invalid character in FEN string
-            }
-            board->setPiece(piece, rank, file);
-            file--;
+        else if (i + 1 < args.size() && parseNumber(args[i + 1], value)) {
+            // every other argument is a name followed by its number
+            i++;
+            if (token == "depth") limits.depth = static_cast<int>(std::max<std::int64_t>(0, std::min<std::int64_t>(value, 1000)));
+            else if (token == "movetime") limits.moveTime = static_cast<int>(std::max<std::int64_t>(0, std::min<std::int64_t>(value, std::numeric_limits<int>::max())));
+            else if (token == "nodes") limits.nodes = static_cast<std::uint64_t>(std::max<std::int64_t>(0, value));
+            else if (token == "mate") limits.mate = static_cast<int>(std::max<std::int64_t>(0, std::min<std::int64_t>(value, 1000)));
+            else if (token == "wtime") clock[0] = value;
+            else if (token == "btime") clock[1] = value;
+            else if (token == "winc") increment[0] = value;
+            else if (token == "binc") increment[1] = value;
+            else if (token == "movestogo") movesToGo = value;
         }
     }
 
-    return true;
+    const int side = isWhite ? 0 : 1;
+    if (limits.moveTime == 0 && clock[side] >= 0) {
+        const std::int64_t budget = clock[side] / (movesToGo > 0 ? movesToGo : 30) + std::max<std::int64_t>(increment[side], 0) / 2;
+
+        // keep a little in hand for the time the move takes to reach the GUI
+        limits.moveTime = static_cast<int>(std::max<std::int64_t>(1, std::min<std::int64_t>(budget, clock[side] - 50)));
+    }
+
+    if (limits.depth == 0 && limits.moveTime == 0 && limits.nodes == 0 && limits.mate == 0) limits.infinite = true;
+    return limits;
+}
+
+
+/**
+ * Processes the "go" command in UCI and starts searching for the best move for the engine to play.
+ * The search runs on a separate thread and prints its move when it ends, so "stop", "ponderhit"
+ * and "isready" are handled while it runs. Early in the game a move from the opening book is
+ * played straight away instead.
+ *
+ * @param engine The engine to search with.
+ * @param args The arguments of the "go" command, including the search limits.
+ */
+void commands::uci_go(Engine* engine, const std::vector<std::string>& args)
+{
+    const ChessBoard board = engine->getBoard();
+    bool isWhite = board.currPlayer;
+    const SearchLimits limits = parseGo(args, isWhite);
+
+    // only one search at a time
+    uci_stop();
+
+    ChessMove bookMove;
+    if (!limits.ponder && engine->getPly() < bookDepth && OpeningBook::pickMove(&board, isWhite, bookMove)) {
+        const std::string move = Engine::moveToString(bookMove);
+        printLine("info string book move " + move);
+        printLine("bestmove " + move);
+        return;
+    }
+
+    searchRunning = true;
+    searchIsInfinite = limits.infinite || limits.ponder;
+    searchEngine = engine;
+    searchThread = std::thread([engine, limits, isWhite]() {
+        const auto onInfo = [](const SearchInfo& info) { printLine(formatInfo(info)); };
+        const SearchResult result = Cluster::isActive() ? Cluster::search(*engine, limits, isWhite, onInfo) : engine->search(limits, isWhite, onInfo);
+
+        std::string line = "bestmove " + Engine::moveToString(result.bestMove);
+        if (result.hasPonderMove) line += " ponder " + Engine::moveToString(result.ponderMove);
+
+        if (debugMode) {
+            for (const std::string& stat : formatStats(result.stats)) printLine("info string " + stat);
+        }
+        printLine(line);
+        searchRunning = false;
+    });
+
+    // the search copies the position when it starts, wait for that so later commands can't change it first
+    while (searchRunning && !engine->isSearching()) std::this_thread::yield();
+}
+
+
+/**
+ * Processes the "stop" command in UCI, ends the running search which then prints its best move.
+ */
+void commands::uci_stop()
+{
+    // keep raising the flag until the search sees it, a search that is only just starting resets it
+    while (searchRunning) {
+        Cluster::stop();
+        searchEngine->stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (searchThread.joinable()) searchThread.join();
+}
+
+
+/**
+ * Waits for the running search to print its move. A search that only ends when it is told to
+ * is stopped instead.
+ */
+void commands::finishSearch()
+{
+    if (searchIsInfinite) return uci_stop();
+    if (searchThread.joinable()) searchThread.join();
+}
+
+
+/**
+ * Processes the "ponderhit" command in UCI, the opponent played the expected move so the
+ * ponder search carries on as a normal search.
+ */
+void commands::uci_ponderHit()
+{
+    if (searchRunning) searchEngine->ponderHit();
+    Cluster::ponderHit();
+}
+
+
+/**
+ * Processes the "setoption" command in UCI and changes one of the options the "uci" command
+ * announces. The name is matched whatever its case, a spin value is clamped to the option's
+ * range and a check value must be "true" or "false". A button takes no value.
+ * The name and the value run until the next keyword, so both may contain spaces.
+ *
+ * @param args The arguments of the "setoption" command, "name" and the option name, then "value" and its value.
+ */
+void commands::uci_setOption(const std::vector<std::string>& args)
+{
+    const auto nameStart = std::find(args.begin(), args.end(), "name");
+    const auto valueStart = std::find(nameStart, args.end(), "value");
+    if (nameStart == args.end()) return;
+
+    const std::size_t nameIndex = static_cast<std::size_t>(nameStart - args.begin()) + 1;
+    const std::size_t valueIndex = static_cast<std::size_t>(valueStart - args.begin());
+    const std::string name = joinTokens(args, nameIndex, valueIndex);
+    const std::string value = joinTokens(args, valueIndex + 1, args.size());
+
+    const auto option = std::find_if(engineOptions.begin(), engineOptions.end(), [&name](const EngineOption& candidate) {
+        return sameOptionName(candidate.name, name);
+    });
+    if (option == engineOptions.end()) {
+        printLine("info string unknown option " + name);
+        return;
+    }
+
+    std::int64_t parsed = 0;
+    if (option->type == "spin" && !parseNumber(value, parsed)) return;
+    if (option->type == "check" && value != "true" && value != "false") return;
+    const int number = static_cast<int>(std::max<std::int64_t>(option->min, std::min<std::int64_t>(parsed, option->max)));
+
+    // options never change under a running search
+    uci_stop();
+    option->apply(value, number);
+
+    // the workers of a cluster search with the same options
+    if (option->name != "ClusterWorkers") Cluster::setOption(option->name, "setoption " + joinTokens(args, 0, args.size()));
 }
 
+
 /**
  * Processes the "moves" command and prints legal moves from a specified square.
  *
- * @param board Pointer to the ChessBoard object representing the current game state.
- * @param details The details of the "moves" command, including the source square and color.
+ * @param engine The engine whose position is read.
+ * @param args The arguments of the "moves" command, the source square and color.
  */
-void commands::engine_moves(ChessBoard* board, std::string details)
+void commands::engine_moves(const Engine* engine, const std::vector<std::string>& args)
 {
-    std::smatch match;
-    if (std::regex_match(details, match, engine_movesCmd)) {
+    const ChessBoard position = engine->getBoard();
+    const ChessBoard* board = &position;
 
-        int square = squareToNumeric(match[1]);
-        bool color = match[2] == "w";
+    if (args.size() >= 2 && args[0].size() == 2 && isSquare(args[0], 0) && (args[1] == "w" || args[1] == "b")) {
+
+        int square = squareToNumeric(args[0]);
+        bool color = args[1] == "w";
         
         std::vector<ChessMove> moves = MoveGeneration::generateSquaresLegalMoves(board, square, color);
 
+        std::string line;
         for (ChessMove move : moves) {
-            std::cout << numericToSquare(move.toSquare) << " ";
+            line += numericToSquare(move.toSquare) + " ";
         }
 
-        std::cout << std::endl;
+        printLine(line);
     }
 }
 
 /**
  * Processes the "check" command and checks if a specified color is in check.
  *
- * @param board Pointer to the ChessBoard object representing the current game state.
- * @param details The details of the "check" command, including the color to check.
+ * @param engine The engine whose position is read.
+ * @param args The arguments of the "check" command, the color to check.
  */
-void commands::engine_isCheck(ChessBoard* board, std::string details)
+void commands::engine_isCheck(const Engine* engine, const std::vector<std::string>& args)
 {
-    std::smatch match;
-    if (std::regex_match(details, match, engine_isCheckCmd)) {
-        bool color = match[1] == "w";
+    const ChessBoard position = engine->getBoard();
+    const ChessBoard* board = &position;
+
+    if (!args.empty() && (args[0] == "w" || args[0] == "b")) {
+        bool color = args[0] == "w";
 
         std::string result = MoveGeneration::isCheck(board, color) ? "yes" : "no";
-        std::cout << result << std::endl;
+        printLine(result);
     }
 }
 
 /**
  * Processes the "mate" command and checks if a specified color is in checkmate.
  *
- * @param board Pointer to the ChessBoard object representing the current game state.
- * @param details The details of the "mate" command, including the color to check.
+ * @param engine The engine whose position is read.
+ * @param args The arguments of the "mate" command, the color to check.
  */
-void commands::engine_isMate(ChessBoard* board, std::string details)
+void commands::engine_isMate(const Engine* engine, const std::vector<std::string>& args)
 {
-    std::smatch match;
-    if (std::regex_match(details, match, engine_isMateCmd)) {
-        bool color = match[1] == "w";
+    const ChessBoard position = engine->getBoard();
+    const ChessBoard* board = &position;
+
+    if (!args.empty() && (args[0] == "w" || args[0] == "b")) {
+        bool color = args[0] == "w";
 
         std::string result = BoardEvaluation::isCheckMate(board, color) ? "yes" : "no";
-        std::cout << result << std::endl;
+        printLine(result);
     }
 }
 
 /**
  * Processes the "piece" command and prints the type of piece on a specified square.
  *
- * @param board Pointer to the ChessBoard object representing the current game state.
- * @param details The details of the "piece" command, including the square.
+ * @param engine The engine whose position is read.
+ * @param args The arguments of the "piece" command, the square.
  */
-void commands::engine_piece(ChessBoard* board, std::string details)
+void commands::engine_piece(const Engine* engine, const std::vector<std::string>& args)
 {
-    std::smatch match;
-    if (std::regex_match(details, match, engine_pieceCmd)) {
-        std::string squareStr = match[1];
+    const ChessBoard position = engine->getBoard();
+    const ChessBoard* board = &position;
+
+    if (!args.empty() && args[0].size() == 2 && isSquare(args[0], 0)) {
+        std::string squareStr = args[0];
         int square = squareToNumeric(squareStr);
 
-        std::cout << ChessBoard::pieceTypeToFen(board->getPieceTypeAtSquare(square/8, square%8)) << std::endl;
+        printLine(ChessBoard::pieceTypeToFen(board->getPieceTypeAtSquare(square/8, square%8)));
     
     }
 }
@@ -347,18 +817,25 @@ void commands::engine_piece(ChessBoard* board, std::string details)
 /**
  * Processes the "move" command and makes a move on the chessboard if it's legal.
  *
- * @param board Pointer to the ChessBoard object representing the current game state.
- * @param details The details of the "move" command, including the source and destination squares.
+ * @param engine The engine whose position the move is played on, its game history is forgotten.
+ * @param args The arguments of the "move" command, the source and destination squares, written
+ *             apart or together, and optionally "y" to display the board.
  */
-void commands::engine_move(ChessBoard* board, std::string details)
+void commands::engine_move(Engine* engine, const std::vector<std::string>& args)
 {
-    std::smatch match;
-    if (std::regex_match(details, match, engine_moveCmd)) {
+    ChessBoard position = engine->getBoard();
+    ChessBoard* board = &position;
+
+    std::size_t next = 0;
+    std::string squares = next < args.size() ? args[next++] : "";
+    if (squares.size() == 2 && next < args.size()) squares += args[next++];
 
-        int squareFrom = squareToNumeric(match[1]);
-        int squareTo = squareToNumeric(match[2]);
+    if (isMoveToken(squares)) {
+
+        int squareFrom = squareToNumeric(squares.substr(0, 2));
+        int squareTo = squareToNumeric(squares.substr(2, 2));
         
-        bool display = match[3] == "y";
+        bool display = next < args.size() && args[next] == "y";
         bool color = board->currPlayer;
 
         std::vector<ChessMove> moves = MoveGeneration::generateSquaresLegalMoves(board, squareFrom, color);
@@ -366,11 +843,99 @@ void commands::engine_move(ChessBoard* board, std::string details)
         for (ChessMove move : moves) {
             if (move.toSquare == squareTo) {
                 board->makeMove(squareFrom, squareTo);
-                if (display) engine_display(board);
+                engine->setBoard(position);
+                if (display) engine_display(engine);
                 return;
             }
         }
 
-        std::cout << "Illegal Move for " << (color ? "white" : "black") << std::endl;
+        printLine(std::string("Illegal Move for ") + (color ? "white" : "black"));
+    }
+}
+
+/**
+ * Processes the "toggle" command and switches one of the selective search features on or off.
+ *
+ * @param args The arguments of the "toggle" command, the feature and its new state.
+ */
+void commands::engine_toggle(const std::vector<std::string>& args)
+{
+    static const std::vector<std::string> features = { "nullmove", "lmr", "futility", "razoring", "lmp", "checkext" };
+
+    if (args.size() >= 2 && std::find(features.begin(), features.end(), args[0]) != features.end() && (args[1] == "on" || args[1] == "off")) {
+        const std::string feature = args[0];
+        const bool enabled = args[1] == "on";
+
+        // options never change under a running search
+        uci_stop();
+
+        SearchOptions& options = BoardEvaluation::options;
+
+        if (feature == "nullmove") options.nullMovePruning = enabled;
+        else if (feature == "lmr") options.lateMoveReductions = enabled;
+        else if (feature == "futility") options.futilityPruning = enabled;
+        else if (feature == "razoring") options.razoring = enabled;
+        else if (feature == "lmp") options.lateMovePruning = enabled;
+        else if (feature == "checkext") options.checkExtensions = enabled;
+
+        printLine(feature + " " + (enabled ? "on" : "off"));
+    }
+}
+
+
+/**
+ * Processes the "stats" command and prints the counters of the last completed search.
+ *
+ * @param engine The engine whose search is reported.
+ */
+void commands::engine_stats(const Engine* engine)
+{
+    for (const std::string& line : formatStats(engine->getLastStats())) printLine(line);
+}
+
+
+/**
+ * Processes the "savehash" command, writes the transposition table to a file.
+ *
+ * @param args The arguments of the "savehash" command, the path of the file.
+ */
+void commands::engine_saveHash(const std::vector<std::string>& args)
+{
+    const std::string path = joinTokens(args, 0, args.size());
+    if (!path.empty()) {
+        uci_stop();
+
+        if (BoardEvaluation::transpositionTable.save(path)) printLine("info string saved hash to " + path);
+        else printLine("info string could not save hash to " + path);
+    }
+}
+
+
+/**
+ * Processes the "loadhash" command, replaces the transposition table with one saved to a file.
+ *
+ * @param args The arguments of the "loadhash" command, the path of the file.
+ */
+void commands::engine_loadHash(const std::vector<std::string>& args)
+{
+    const std::string path = joinTokens(args, 0, args.size());
+    if (!path.empty()) {
+        uci_stop();
+
+        if (BoardEvaluation::transpositionTable.load(path)) printLine("info string loaded hash from " + path);
+        else printLine("info string could not load hash from " + path);
     }
 }
+
+
+/**
+ * Saves the transposition table to the HashFile option's file, if one is set. Called when the
+ * engine quits, so the next session starts from this one's results.
+ */
+void commands::autoSaveHash()
+{
+    if (hashFile.empty()) return;
+
+    uci_stop();
+    if (!BoardEvaluation::transpositionTable.save(hashFile)) printLine("info string could not save hash to " + hashFile);
+}
@@ -2,55 +2,105 @@
  * @file commands.cpp
  *
  * Implementation of commands related to a chess engine using the Universal Chess Interface (UCI) protocol.
- * This file contains regular expressions for parsing UCI and engine-specific commands, as well as functions
+ * This file contains the tokenizing parser for UCI and engine-specific commands, as well as functions
  * to handle and process these commands.
  *
  * @author Martin N
  * @date 09/2023
  */
 
+#pragma once
 #include <string>
-#include <regex>
-#include <unordered_map>
-#include "ChessBoard.h"
+#include <vector>
+#include "Engine.h"
 
 namespace commands {
 
-    // Regular expressions for engine and UCI commands
-
-    // Engine specific commands
-    const std::regex engine_displayCmd(R"(.*display\s*)");
-    const std::regex engine_movesCmd(R"(.*moves\s*([a-h][1-8])\s*([wb])\s*)");
-    const std::regex engine_isCheckCmd(R"(.*check\s*([wb])\s*)");
-    const std::regex engine_isMateCmd(R"(.*mate\s*([wb])\s*)");
-    const std::regex engine_pieceCmd(R"(.*piece\s*([a-h][1-8])\s*)");
-    const std::regex engine_moveCmd(R"(.*move\s*([a-h][1-8])\s*([a-h][1-8])\s*([y]|[n])?)");
-    //const std::regex engine_play(R"(.*play ([cp]) ([cp])\s*)");
-
-    // UCI specific commands
-    const std::regex uci_uciCmd(R"(.*uci\s*)");
-    const std::regex uci_debugCmd(R"(.*debug\s*(on|off)\s*)");
-    const std::regex uci_isreadyCmd(R"(.*isready\s*)");
-    const std::regex uci_newgameCmd(R"(.*ucinewgame\s*)");
-    const std::regex uci_positionCmd(R"((.*position\s*)(startpos|((?:[rnbqkpRNBQKP1-8]+/){7}[rnbqkpRNBQKP1-8]+)\s*([bw])\s*((-|[KQkq]){1,4})\s*(-|[a-h][1-8])\s*((\d)+\s*(\d)+))\s*(?:moves\s*(([a-h]\s*[1-8]\s*[a-h]\s*[1-8]\s*)+))?$)");
-    const std::regex uci_goCmd(R"(go ([w]|[b]) ([1-9]))");
+    /**
+     * The commands the engine understands. A line is identified by its first token that names
+     * a command, unknown tokens before it are skipped as the UCI protocol asks.
+     */
+    enum class CommandType {
+        NONE,
+
+        // UCI commands
+        UCI,
+        DEBUG,
+        ISREADY,
+        SETOPTION,
+        REGISTER,
+        UCINEWGAME,
+        POSITION,
+        GO,
+        STOP,
+        PONDERHIT,
+        QUIT,
+
+        // Engine specific commands
+        DISPLAY,
+        MOVES,
+        CHECK,
+        MATE,
+        PIECE,
+        MOVE,
+        TOGGLE,
+        STATS,
+        SAVEHASH,
+        LOADHASH
+    };
+
+    /**
+     * A command line, split into the command and the tokens that follow it.
+     */
+    struct Command {
+        CommandType type = CommandType::NONE;
+        std::vector<std::string> args;
+    };
+
+    // Splits a line into its whitespace separated tokens
+    std::vector<std::string> tokenize(const std::string& line);
+
+    // Identifies the command of a line, in time linear in the length of the line
+    Command parseCommand(const std::string& line);
+
+    // Reads the position and moves of a "position" command
+    bool parsePosition(const std::vector<std::string>& args, std::string& fen, std::vector<std::string>& moves);
+
+    // Reads the search limits of a "go" command, and the color to search for
+    SearchLimits parseGo(const std::vector<std::string>& args, bool& isWhite);
+
+    // Formats a line of search output as a UCI "info" line
+    std::string formatInfo(const SearchInfo& info);
 
     // Function prototypes for handling UCI commands
     void uci_uci();
-    void uci_debug(std::string mode);
+    void uci_debug(const std::vector<std::string>& args);
     void uci_isready();
-    void uci_newGame();
-    void uci_position(ChessBoard* board, std::string details);
-    void uci_go(ChessBoard* board, std::string details);
+    void uci_newGame(Engine* engine);
+    void uci_position(Engine* engine, const std::vector<std::string>& args);
+    void uci_go(Engine* engine, const std::vector<std::string>& args);
+    void uci_setOption(const std::vector<std::string>& args);
+    void uci_stop();
+    void uci_ponderHit();
+
+    // Waits for the running search to end, a search without limits is stopped
+    void finishSearch();
+
+    // Writes a line of output, safe to call from the search thread
+    void printLine(const std::string& line);
 
     // Function prototypes for handling engine-specific commands
-    void engine_display(const ChessBoard* board);
-    void engine_moves(ChessBoard* board, std::string details);
-    void engine_isCheck(ChessBoard* board, std::string details);
-    void engine_isMate(ChessBoard* board, std::string details);
-    void engine_piece(ChessBoard* board, std::string details);
-    void engine_move(ChessBoard* board, std::string details);
-
-    // Function for loading FEN (Forsyth-Edwards Notation) into a ChessBoard
-    bool loadFEN(ChessBoard* board, const std::string& fen);
+    void engine_display(const Engine* engine);
+    void engine_moves(const Engine* engine, const std::vector<std::string>& args);
+    void engine_isCheck(const Engine* engine, const std::vector<std::string>& args);
+    void engine_isMate(const Engine* engine, const std::vector<std::string>& args);
+    void engine_piece(const Engine* engine, const std::vector<std::string>& args);
+    void engine_move(Engine* engine, const std::vector<std::string>& args);
+    void engine_toggle(const std::vector<std::string>& args);
+    void engine_stats(const Engine* engine);
+    void engine_saveHash(const std::vector<std::string>& args);
+    void engine_loadHash(const std::vector<std::string>& args);
+
+    // Saves the transposition table to the HashFile option's file, if one is set
+    void autoSaveHash();
 }
@@ -0,0 +1,523 @@
+/**
+ * @file Engine.cpp
+ *
+ * Implementation of the Engine class, the engine's library interface.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "Engine.h"
+#include "MoveGeneration.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+const std::string Engine::startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1";
+
+/**
+ * Checks if the two characters of a token at an offset are a square, such as "e4".
+ */
+static bool isSquare(const std::string& token, std::size_t offset)
+{
+    return token.size() >= offset + 2
+        && token[offset] >= 'a' && token[offset] <= 'h'
+        && token[offset + 1] >= '1' && token[offset + 1] <= '8';
+}
+
+
+/**
+ * Converts a square in algebraic notation to the engine's numbering, with the h file first.
+ */
+static std::uint8_t squareIndex(const std::string& token, std::size_t offset)
+{
+    const int file = token[offset] - 'a';
+    const int rank = token[offset + 1] - '1';
+    return static_cast<std::uint8_t>(rank * 8 + (7 - file));
+}
+
+
+/**
+ * Converts a square of the engine's numbering to algebraic notation.
+ */
+static std::string squareName(int square)
+{
+    const char file = static_cast<char>('a' + (7 - square % 8));
+    const char rank = static_cast<char>('1' + square / 8);
+    return std::string(1, file) + std::string(1, rank);
+}
+
+
+/**
+ * Create an engine with the starting position set up, searching with the transposition table
+ * of the process.
+ */
+Engine::Engine() : Engine(BoardEvaluation::transpositionTable)
+{
+}
+
+
+/**
+ * Create an engine with the starting position set up, searching with its own table.
+ *
+ * @param table The transposition table, it must outlive the engine.
+ */
+Engine::Engine(TranspositionTable& table)
+{
+    state.table = &table;
+    setPosition(startFen, std::vector<std::string>());
+}
+
+
+/**
+ * Create an engine with the position, game history and transposition table of another, but
+ * not its search.
+ *
+ * @param other The engine to copy.
+ */
+Engine::Engine(const Engine& other)
+{
+    std::lock_guard<std::mutex> lock(other.mutex);
+
+    state.table = other.state.table;
+    board = other.board;
+    startPosition = other.startPosition;
+    moves = other.moves;
+    gameKeys = other.gameKeys;
+}
+
+
+/**
+ * Set up a position and the moves played from it. Nothing changes unless the whole position
+ * can be set up.
+ *
+ * A controller sends the whole game before every move. When the position is the one set up last,
+ * and so are the moves before the last ones, only the new moves are checked and played, so the cost
+ * per move stays the same however long the game gets. The keys of the positions played since the
+ * last capture or pawn move are kept, so the search sees repetitions of them.
+ *
+ * @param fen The position in Forsyth-Edwards Notation. Only the piece placement and the side
+ *            to move are read, white moves when the side is left out.
+ * @param moves The moves played from the position.
+ * @param illegalMove Set to the index of the first illegal move, when one is and it isn't null.
+ * @return Whether the position was set up.
+ */
+Engine::PositionStatus Engine::setPosition(const std::string& fen, const std::vector<std::string>& moves, std::size_t* illegalMove)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const bool extendsLast = !startPosition.empty() && fen == startPosition
+        && moves.size() >= this->moves.size()
+        && std::equal(this->moves.begin(), this->moves.end(), moves.begin());
+
+    ChessBoard position;
+    std::vector<std::uint64_t> keys;
+    std::size_t next = 0;
+
+    if (extendsLast) {
+        position = board;
+        keys = gameKeys;
+        next = this->moves.size();
+    }
+    else {
+        std::istringstream fields(fen);
+        std::string placement;
+        std::string side;
+        fields >> placement >> side;
+
+        if (std::count(placement.begin(), placement.end(), '/') != 7 || !loadFEN(&position, placement)) return PositionStatus::INVALID_FEN;
+        position.currPlayer = side != "b";
+    }
+
+    for (; next < moves.size(); next++) {
+        ChessMove move;
+        bool isLegal = false;
+
+        if (parseMove(moves[next], move)) {
+            const std::vector<ChessMove> legalMoves = MoveGeneration::generateSquaresLegalMoves(&position, move.fromSquare, position.currPlayer);
+            isLegal = std::find(legalMoves.begin(), legalMoves.end(), move) != legalMoves.end();
+        }
+
+        if (!isLegal) {
+            if (illegalMove != nullptr) *illegalMove = next;
+            return PositionStatus::ILLEGAL_MOVE;
+        }
+
+        // a capture or pawn move can't be undone, no earlier position can repeat
+        const ChessBoard::PieceType moved = position.getPieceTypeAtSquare(move.fromSquare / 8, move.fromSquare % 8);
+        const bool isCapture = position.getPieceTypeAtSquare(move.toSquare / 8, move.toSquare % 8) != ChessBoard::PieceType::EMPTY;
+        if (isCapture || moved == ChessBoard::PieceType::WHITE_PAWN || moved == ChessBoard::PieceType::BLACK_PAWN) keys.clear();
+        else keys.push_back(position.getPositionKey(position.currPlayer));
+
+        position.makeMove(move.fromSquare, move.toSquare);
+    }
+
+    board = position;
+    gameKeys = keys;
+    if (extendsLast) this->moves.insert(this->moves.end(), moves.begin() + this->moves.size(), moves.end());
+    else this->moves = moves;
+    startPosition = fen;
+
+    return PositionStatus::OK;
+}
+
+
+/**
+ * Replace the position with a board, the game history before it is forgotten.
+ *
+ * @param board The board, its current player is the side to move.
+ */
+void Engine::setBoard(const ChessBoard& board)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->board = board;
+    startPosition.clear();
+    moves.clear();
+    gameKeys.clear();
+}
+
+
+/**
+ * Get a copy of the board of the position.
+ *
+ * @return The board.
+ */
+ChessBoard Engine::getBoard() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return board;
+}
+
+
+/**
+ * Get the position as setPosition takes it, so it can be set up on another engine.
+ *
+ * @param fen Set to the FEN of the last setPosition, or of the board after setBoard.
+ * @param moves Set to the moves played from it.
+ */
+void Engine::getPosition(std::string& fen, std::vector<std::string>& moves) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    fen = startPosition.empty() ? toFEN(board) : startPosition;
+    moves = this->moves;
+}
+
+
+/**
+ * Get the number of moves played from the FEN of the last setPosition.
+ *
+ * @return The number of plies, 0 after setBoard.
+ */
+int Engine::getPly() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<int>(moves.size());
+}
+
+
+/**
+ * Search the position for the side to move.
+ *
+ * @param limits When the search has to end.
+ * @param onInfo Called with each line of a completed iteration, on the search thread. May be empty.
+ * @return What the search found.
+ */
+SearchResult Engine::search(const SearchLimits& limits, const std::function<void(const SearchInfo&)>& onInfo)
+{
+    return search(limits, getBoard().currPlayer, onInfo);
+}
+
+
+/**
+ * Search the position for a player. The position is copied when the search is asked for, so
+ * it can be set up again while the search runs. The search waits for a running search of this
+ * engine to end before it starts, the searches of other engines don't hold it up.
+ *
+ * @param limits When the search has to end.
+ * @param isWhite A boolean indicating the player's color (true for white, false for black).
+ * @param onInfo Called with each line of a completed iteration, on the search thread. May be empty.
+ * @return What the search found.
+ */
+SearchResult Engine::search(const SearchLimits& limits, bool isWhite, const std::function<void(const SearchInfo&)>& onInfo)
+{
+    ChessBoard position;
+    std::vector<std::uint64_t> keys;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        position = board;
+
+        // the game's positions only lead up to the board when the side to move searches
+        if (isWhite == board.currPlayer) keys = gameKeys;
+    }
+
+    std::lock_guard<std::mutex> searchLock(searchMutex);
+    searching = true;
+
+    SearchResult result;
+    state.infoHandler = [&result, &onInfo](const SearchInfo& info) {
+        if (info.multiPv == 1) {
+            result.score = info.score;
+            result.mateIn = info.mateIn;
+            result.depth = info.depth;
+            result.selDepth = info.selDepth;
+            result.pv = info.pv;
+        }
+        if (onInfo) onInfo(info);
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    result.bestMove = BoardEvaluation::search(state, &position, limits, isWhite, keys);
+    result.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    result.stats = BoardEvaluation::getLastStats(state);
+
+    state.infoHandler = nullptr;
+    searching = false;
+
+    // the threads may have voted for another move than the main thread's line starts with
+    if (result.pv.empty() || !(result.pv[0] == result.bestMove)) result.pv.assign(1, result.bestMove);
+
+    if (result.pv.size() >= 2) {
+        result.hasPonderMove = true;
+        result.ponderMove = result.pv[1];
+    }
+
+    return result;
+}
+
+
+/**
+ * End this engine's running search, if it has one, and wait until it has returned. Only this
+ * engine's stop token is raised, the searches of other engines go on.
+ */
+void Engine::stop()
+{
+    // keep raising the flag until the search sees it, a search that is only just starting resets it
+    while (searching) {
+        BoardEvaluation::stop(state);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+
+/**
+ * The opponent played the move this engine's ponder search is pondering on.
+ */
+void Engine::ponderHit()
+{
+    if (searching) BoardEvaluation::ponderHit(state);
+}
+
+
+/**
+ * Check if this engine is searching.
+ *
+ * @return True while a search of this engine runs.
+ */
+bool Engine::isSearching() const
+{
+    return searching;
+}
+
+
+/**
+ * Forget the move ordering learned in earlier games, for a new game, and age the entries of the
+ * transposition table. Waits for a running search to end first.
+ */
+void Engine::newGame()
+{
+    std::lock_guard<std::mutex> searchLock(searchMutex);
+    BoardEvaluation::newGame(state);
+}
+
+
+/**
+ * Search with another transposition table from the next search on. Waits for a running search
+ * to end first.
+ *
+ * @param table The transposition table, it must outlive the engine.
+ */
+void Engine::setTable(TranspositionTable& table)
+{
+    std::lock_guard<std::mutex> searchLock(searchMutex);
+    state.table = &table;
+}
+
+
+/**
+ * Get the counters of this engine's last completed search, summed over all its threads.
+ *
+ * @return The counters of the last search.
+ */
+SearchStats Engine::getLastStats() const
+{
+    return BoardEvaluation::getLastStats(state);
+}
+
+
+/**
+ * Count the legal move sequences of a number of plies from the position, to check the move
+ * generation against known counts.
+ *
+ * @param depth The number of plies.
+ * @return The number of leaf positions, 1 for depth 0.
+ */
+std::uint64_t Engine::perft(int depth) const
+{
+    return perft(getBoard(), depth);
+}
+
+
+std::uint64_t Engine::perft(const ChessBoard& board, int depth)
+{
+    if (depth <= 0) return 1;
+
+    const std::vector<ChessMove> legalMoves = MoveGeneration::generateColorsLegalMoves(&board, board.currPlayer);
+    if (depth == 1) return legalMoves.size();
+
+    std::uint64_t count = 0;
+    for (const ChessMove& move : legalMoves) {
+        ChessBoard child = board;
+        child.makeMove(move.fromSquare, move.toSquare);
+        count += perft(child, depth - 1);
+    }
+
+    return count;
+}
+
+
+/**
+ * Static evaluation of the position, with the network when one is loaded, the way the search
+ * evaluates its leaves.
+ *
+ * @return The evaluation in centipawns, positive when the side to move is ahead.
+ */
+int Engine::evaluate() const
+{
+    const ChessBoard position = getBoard();
+
+    if (Nnue::isLoaded()) {
+        Nnue::Accumulator accumulator;
+        Nnue::refresh(accumulator, &position);
+        return Nnue::evaluate(accumulator, position.currPlayer);
+    }
+
+    return BoardEvaluation::staticEval(&position, position.currPlayer);
+}
+
+
+/**
+ * Read a move in long algebraic notation.
+ *
+ * @param token The move, such as "e2e4".
+ * @param move Set to the move.
+ * @return True if the token is a move.
+ */
+bool Engine::parseMove(const std::string& token, ChessMove& move)
+{
+    if (token.size() != 4 || !isSquare(token, 0) || !isSquare(token, 2)) return false;
+
+    move = ChessMove(squareIndex(token, 0), squareIndex(token, 2));
+    return true;
+}
+
+
+/**
+ * Write a move in long algebraic notation.
+ *
+ * @param move The move.
+ * @return The move, such as "e2e4".
+ */
+std::string Engine::moveToString(const ChessMove& move)
+{
+    return squareName(move.fromSquare) + squareName(move.toSquare);
+}
+
+
+/**
+ * Loads the piece placement of a FEN onto a board, emptying it first.
+ *
+ * @param board Pointer to the ChessBoard object to update.
+ * @param placement The piece placement field of a FEN.
+ * @return True if the placement was read.
+ */
+bool Engine::loadFEN(ChessBoard* board, const std::string& placement)
+{
+    if (placement.empty()) return false;
+
+    int rank = 7; // Start from rank 8
+    int file = 7; // Start from file a, the engine counts files from h
+
+    board->clearBoard();
+
+    for (char fenChar : placement) {
+        if (fenChar == '/') {
+            rank--;
+            file = 7;
+            continue;
+        }
+        if (rank < 0 || file < 0) return false;
+
+        if (isdigit(static_cast<unsigned char>(fenChar))) {
+            file -= fenChar - '0';
+            continue;
+        }
+
+        ChessBoard::PieceType piece;
+        switch (fenChar) {
+            case 'P': piece = ChessBoard::PieceType::WHITE_PAWN; break;
+            case 'R': piece = ChessBoard::PieceType::WHITE_ROOK; break;
+            case 'N': piece = ChessBoard::PieceType::WHITE_KNIGHT; break;
+            case 'B': piece = ChessBoard::PieceType::WHITE_BISHOP; break;
+            case 'Q': piece = ChessBoard::PieceType::WHITE_QUEEN; break;
+            case 'K': piece = ChessBoard::PieceType::WHITE_KING; break;
+            case 'p': piece = ChessBoard::PieceType::BLACK_PAWN; break;
+            case 'r': piece = ChessBoard::PieceType::BLACK_ROOK; break;
+            case 'n': piece = ChessBoard::PieceType::BLACK_KNIGHT; break;
+            case 'b': piece = ChessBoard::PieceType::BLACK_BISHOP; break;
+            case 'q': piece = ChessBoard::PieceType::BLACK_QUEEN; break;
+            case 'k': piece = ChessBoard::PieceType::BLACK_KING; break;
+            default: return false; // Invalid character in FEN string
+        }
+        board->setPiece(piece, rank, file);
+        file--;
+    }
+
+    return true;
+}
+
+
+/**
+ * Write a board as a FEN, without castling rights or an en passant square as the engine has neither.
+ *
+ * @param board The board, its current player is the side to move.
+ * @return The FEN.
+ */
+std::string Engine::toFEN(const ChessBoard& board)
+{
+    std::string fen;
+
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+
+        // files a to h, which the engine numbers from 7 down to 0
+        for (int file = 7; file >= 0; file--) {
+            const ChessBoard::PieceType piece = board.getPieceTypeAtSquare(rank, file);
+            if (piece == ChessBoard::PieceType::EMPTY) {
+                empty++;
+                continue;
+            }
+
+            if (empty > 0) fen += static_cast<char>('0' + empty);
+            empty = 0;
+            fen += ChessBoard::pieceTypeToFen(piece);
+        }
+
+        if (empty > 0) fen += static_cast<char>('0' + empty);
+        if (rank > 0) fen += '/';
+    }
+
+    return fen + (board.currPlayer ? " w - - 0 1" : " b - - 0 1");
+}
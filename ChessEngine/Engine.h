@@ -0,0 +1,255 @@
+/**
+ * @file Engine.h
+ *
+ * Declaration of the Engine class, the engine as a library: a position and the searches,
+ * perft and evaluation of it, without the text protocol of the command line front end.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BoardEvaluation.h"
+#include "ChessBoard.h"
+
+/**
+ * @struct SearchResult
+ *
+ * What a search found: its move, the line it expects and the counters of the search.
+ */
+struct SearchResult
+{
+    ChessMove bestMove;         ///< The move to play.
+    bool hasPonderMove = false; ///< True if the search expects a reply to the move.
+    ChessMove ponderMove;       ///< The expected reply, the move to ponder on.
+    int score = 0;              ///< The score of the move in centipawns, from the side to move's point of view.
+    int mateIn = 0;             ///< Moves until mate, negative when being mated, 0 if no mate was found.
+    int depth = 0;              ///< The deepest iteration the search completed.
+    int selDepth = 0;           ///< The deepest ply the main thread reached, quiescence included.
+    std::vector<ChessMove> pv;  ///< The principal variation of the deepest iteration.
+    std::int64_t time = 0;      ///< Milliseconds the search took.
+    SearchStats stats;          ///< The counters of the search, summed over all its threads.
+};
+
+/**
+ * @class Engine
+ *
+ * An engine that can be embedded in another program. Each Engine holds its own position, game
+ * history and search state, the contexts of its search threads and its stop token, and every
+ * method is safe to call from any thread. The searches of different Engine objects run side by
+ * side, those of one Engine one at a time. An engine searches with the transposition table of
+ * the process unless it is given one of its own. The thread count and the other options are
+ * process wide, changed on BoardEvaluation directly, between searches.
+ *
+ * Moves are written in long algebraic notation, such as "e2e4".
+ */
+class Engine
+{
+public:
+    /**
+     * The result of setting up a position.
+     */
+    enum class PositionStatus {
+        OK,           ///< The position was set up.
+        INVALID_FEN,  ///< The FEN couldn't be read, the position is unchanged.
+        ILLEGAL_MOVE  ///< One of the moves is illegal, the position is unchanged.
+    };
+
+    /**
+     * The FEN of the starting position.
+     */
+    static const std::string startFen;
+
+    /**
+     * Create an engine with the starting position set up, searching with the transposition
+     * table of the process.
+     */
+    Engine();
+
+    /**
+     * Create an engine with the starting position set up, searching with its own table.
+     *
+     * @param table The transposition table, it must outlive the engine.
+     */
+    explicit Engine(TranspositionTable& table);
+
+    /**
+     * Create an engine with the position, game history and transposition table of another, but
+     * not its search.
+     *
+     * @param other The engine to copy.
+     */
+    Engine(const Engine& other);
+
+    Engine& operator=(const Engine&) = delete;
+
+    /**
+     * Set up a position and the moves played from it. When the position and the moves before
+     * the last ones are those set up last, only the new moves are checked and played.
+     *
+     * @param fen The position in Forsyth-Edwards Notation. Only the piece placement and the side
+     *            to move are read, white moves when the side is left out.
+     * @param moves The moves played from the position.
+     * @param illegalMove Set to the index of the first illegal move, when one is and it isn't null.
+     * @return Whether the position was set up.
+     */
+    PositionStatus setPosition(const std::string& fen, const std::vector<std::string>& moves, std::size_t* illegalMove = nullptr);
+
+    /**
+     * Replace the position with a board, the game history before it is forgotten.
+     *
+     * @param board The board, its current player is the side to move.
+     */
+    void setBoard(const ChessBoard& board);
+
+    /**
+     * Get a copy of the board of the position.
+     *
+     * @return The board.
+     */
+    ChessBoard getBoard() const;
+
+    /**
+     * Get the position as setPosition takes it, so it can be set up on another engine.
+     *
+     * @param fen Set to the FEN of the last setPosition, or of the board after setBoard.
+     * @param moves Set to the moves played from it.
+     */
+    void getPosition(std::string& fen, std::vector<std::string>& moves) const;
+
+    /**
+     * Get the number of moves played from the FEN of the last setPosition.
+     *
+     * @return The number of plies, 0 after setBoard.
+     */
+    int getPly() const;
+
+    /**
+     * Search the position for the side to move. Blocks until the search ends, which with an
+     * infinite or ponder search is only once it is stopped.
+     *
+     * @param limits When the search has to end.
+     * @param onInfo Called with each line of a completed iteration, on the search thread. May be empty.
+     * @return What the search found.
+     */
+    SearchResult search(const SearchLimits& limits, const std::function<void(const SearchInfo&)>& onInfo = nullptr);
+
+    /**
+     * Search the position for a player, who need not be the side to move.
+     *
+     * @param limits When the search has to end.
+     * @param isWhite A boolean indicating the player's color (true for white, false for black).
+     * @param onInfo Called with each line of a completed iteration, on the search thread. May be empty.
+     * @return What the search found.
+     */
+    SearchResult search(const SearchLimits& limits, bool isWhite, const std::function<void(const SearchInfo&)>& onInfo = nullptr);
+
+    /**
+     * End this engine's running search, if it has one, and wait until it has returned. The
+     * searches of other engines go on. Must not be called from the onInfo callback of the search.
+     */
+    void stop();
+
+    /**
+     * The opponent played the move this engine's ponder search is pondering on, it becomes a
+     * normal search and its limits start to count from now.
+     */
+    void ponderHit();
+
+    /**
+     * Check if this engine is searching.
+     *
+     * @return True while a search of this engine runs.
+     */
+    bool isSearching() const;
+
+    /**
+     * Forget the move ordering learned in earlier games, for a new game, and age the entries of
+     * the transposition table. Waits for a running search to end first.
+     */
+    void newGame();
+
+    /**
+     * Search with another transposition table from the next search on. Waits for a running
+     * search to end first.
+     *
+     * @param table The transposition table, it must outlive the engine.
+     */
+    void setTable(TranspositionTable& table);
+
+    /**
+     * Get the counters of this engine's last completed search, summed over all its threads.
+     *
+     * @return The counters of the last search.
+     */
+    SearchStats getLastStats() const;
+
+    /**
+     * Count the legal move sequences of a number of plies from the position.
+     *
+     * @param depth The number of plies.
+     * @return The number of leaf positions, 1 for depth 0.
+     */
+    std::uint64_t perft(int depth) const;
+
+    /**
+     * Static evaluation of the position, without a search.
+     *
+     * @return The evaluation in centipawns, positive when the side to move is ahead.
+     */
+    int evaluate() const;
+
+    /**
+     * Read a move in long algebraic notation.
+     *
+     * @param token The move, such as "e2e4".
+     * @param move Set to the move.
+     * @return True if the token is a move.
+     */
+    static bool parseMove(const std::string& token, ChessMove& move);
+
+    /**
+     * Write a move in long algebraic notation.
+     *
+     * @param move The move.
+     * @return The move, such as "e2e4".
+     */
+    static std::string moveToString(const ChessMove& move);
+
+    /**
+     * Loads the piece placement of a FEN onto a board, emptying it first.
+     *
+     * @param board Pointer to the ChessBoard object to update.
+     * @param placement The piece placement field of a FEN.
+     * @return True if the placement was read.
+     */
+    static bool loadFEN(ChessBoard* board, const std::string& placement);
+
+    /**
+     * Write a board as a FEN, without castling rights or an en passant square as the engine has neither.
+     *
+     * @param board The board, its current player is the side to move.
+     * @return The FEN.
+     */
+    static std::string toFEN(const ChessBoard& board);
+
+private:
+    mutable std::mutex mutex;            ///< Guards the position below.
+    ChessBoard board;                    ///< The position.
+    std::string startPosition;           ///< The FEN of the last setPosition, empty after setBoard.
+    std::vector<std::string> moves;      ///< The moves of the last setPosition.
+    std::vector<std::uint64_t> gameKeys; ///< The keys of the positions before the board, back to the last capture or pawn move.
+
+    std::mutex searchMutex;               ///< Held while a search of this engine runs, its searches run one at a time.
+    SearchState state;                    ///< The contexts, table and stop token of this engine's searches.
+    std::atomic<bool> searching{ false }; ///< True while a search of this engine runs.
+
+    static std::uint64_t perft(const ChessBoard& board, int depth);
+};
@@ -0,0 +1,57 @@
+/**
+ * @file EvalCache.cpp
+ *
+ * Implementation of the cache of static evaluations.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "EvalCache.h"
+#include <algorithm>
+
+/**
+ * Create an empty cache.
+ *
+ * @param entryCount The number of entries, a power of two.
+ */
+EvalCache::EvalCache(std::size_t entryCount) : entries(entryCount), indexMask(entryCount - 1)
+{
+}
+
+/**
+ * Look up the evaluation of a position.
+ *
+ * @param key The Zobrist key of the position, including the side to move.
+ * @param score Set to the cached evaluation when the position is found.
+ * @return True if the position was found.
+ */
+bool EvalCache::probe(std::uint64_t key, int& score) const
+{
+    const Entry& entry = entries[key & indexMask];
+    if (entry.key != key) return false;
+
+    score = entry.score;
+    return true;
+}
+
+/**
+ * Store the evaluation of a position, replacing whatever shared its entry.
+ *
+ * @param key The Zobrist key of the position, including the side to move.
+ * @param score The evaluation.
+ */
+void EvalCache::store(std::uint64_t key, int score)
+{
+    Entry& entry = entries[key & indexMask];
+    entry.key = key;
+    entry.score = score;
+}
+
+/**
+ * Remove every entry, needed whenever the evaluation function changes.
+ */
+void EvalCache::clear()
+{
+    std::fill(entries.begin(), entries.end(), Entry());
+}
@@ -0,0 +1,62 @@
+/**
+ * @file EvalCache.h
+ *
+ * Declaration of the EvalCache class, a cache of static evaluations keyed by position.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class EvalCache
+ *
+ * A direct mapped table of static evaluations. The search reaches the same leaf again and again,
+ * in the re-searches of principal variation search and in every iteration of iterative deepening,
+ * and each time the evaluation would be computed from scratch. Each search thread owns a cache,
+ * so it needs no locking.
+ */
+class EvalCache
+{
+public:
+    /**
+     * Create an empty cache.
+     *
+     * @param entryCount The number of entries, a power of two.
+     */
+    explicit EvalCache(std::size_t entryCount = 16384);
+
+    /**
+     * Look up the evaluation of a position.
+     *
+     * @param key The Zobrist key of the position, including the side to move.
+     * @param score Set to the cached evaluation when the position is found.
+     * @return True if the position was found.
+     */
+    bool probe(std::uint64_t key, int& score) const;
+
+    /**
+     * Store the evaluation of a position, replacing whatever shared its entry.
+     *
+     * @param key The Zobrist key of the position, including the side to move.
+     * @param score The evaluation.
+     */
+    void store(std::uint64_t key, int score);
+
+    /**
+     * Remove every entry, needed whenever the evaluation function changes.
+     */
+    void clear();
+
+private:
+    struct Entry {
+        std::uint64_t key = 0;
+        int score = 0;
+    };
+
+    std::vector<Entry> entries;
+    std::size_t indexMask;
+};
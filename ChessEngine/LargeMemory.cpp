@@ -0,0 +1,268 @@
+/**
+ * @file LargeMemory.cpp
+ *
+ * Implementation of the LargeMemory class, the platform specific huge page and NUMA allocation.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "LargeMemory.h"
+#include <algorithm>
+#include <fstream>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+// The size of a huge page on x86-64 and most other 64 bit systems.
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static std::size_t roundUp(std::size_t bytes, std::size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+
+#if defined(_WIN32)
+/**
+ * Enable the "lock pages in memory" privilege of the process, which large pages need. It only
+ * succeeds when an administrator has granted the privilege to the user.
+ */
+static bool enableLockMemoryPrivilege() {
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return false;
+
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    // AdjustTokenPrivileges reports success even when the privilege wasn't granted
+    const bool enabled = LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid)
+        && AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL)
+        && GetLastError() == ERROR_SUCCESS;
+
+    CloseHandle(token);
+    return enabled;
+}
+#endif
+
+
+#if defined(__linux__)
+/**
+ * Get the NUMA nodes that are online, as a bit per node, from a list like "0-1,3".
+ */
+static unsigned long onlineNumaNodes() {
+    std::ifstream file("/sys/devices/system/node/online");
+    std::string list;
+    if (!(file >> list)) return 1;
+
+    unsigned long mask = 0;
+    std::size_t start = 0;
+    while (start < list.size()) {
+        const std::size_t end = std::min(list.find(',', start), list.size());
+        const std::string range = list.substr(start, end - start);
+        const std::size_t dash = range.find('-');
+
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int node = first; node <= last && node < static_cast<int>(8 * sizeof(mask)); node++) mask |= 1UL << node;
+
+        start = end + 1;
+    }
+
+    return mask;
+}
+#endif
+
+
+LargeMemory::~LargeMemory()
+{
+    release();
+}
+
+LargeMemory::LargeMemory(LargeMemory&& other) noexcept
+    : base(other.base), length(other.length), mode(other.mode), nodes(other.nodes)
+{
+    other.base = nullptr;
+    other.length = 0;
+    other.mode = PageMode::NONE;
+    other.nodes = 1;
+}
+
+LargeMemory& LargeMemory::operator=(LargeMemory&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        std::swap(base, other.base);
+        std::swap(length, other.length);
+        std::swap(mode, other.mode);
+        std::swap(nodes, other.nodes);
+    }
+    return *this;
+}
+
+
+/**
+ * Allocate a block, releasing the one allocated before. Explicit huge pages are tried first,
+ * then transparent huge pages, then plain pages. The block is zeroed by the system.
+ *
+ * @param bytes The size of the block in bytes.
+ * @param interleave True to spread the pages over every NUMA node.
+ * @return True if the block was allocated.
+ */
+bool LargeMemory::allocate(std::size_t bytes, bool interleave)
+{
+    release();
+
+#if defined(_WIN32)
+    (void)interleave;
+
+    const SIZE_T largePage = GetLargePageMinimum();
+    if (largePage != 0 && enableLockMemoryPrivilege()) {
+        const std::size_t rounded = roundUp(bytes, largePage);
+        base = VirtualAlloc(NULL, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (base != nullptr) {
+            length = rounded;
+            mode = PageMode::HUGE_PAGES;
+            return true;
+        }
+    }
+
+    base = VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (base == nullptr) return false;
+
+    length = bytes;
+    mode = PageMode::NORMAL;
+    return true;
+#else
+    const std::size_t rounded = roundUp(bytes, HUGE_PAGE_SIZE);
+
+#if defined(MAP_HUGETLB)
+    void* block = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (block != MAP_FAILED) {
+        base = block;
+        length = rounded;
+        mode = PageMode::HUGE_PAGES;
+    }
+#endif
+
+    if (base == nullptr) {
+        // one huge page extra, so the block can start on a huge page boundary
+        void* block = mmap(nullptr, rounded + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == MAP_FAILED) return false;
+
+        char* start = static_cast<char*>(block);
+        char* aligned = reinterpret_cast<char*>(roundUp(reinterpret_cast<std::size_t>(start), HUGE_PAGE_SIZE));
+        const std::size_t head = static_cast<std::size_t>(aligned - start);
+        if (head > 0) munmap(start, head);
+        munmap(aligned + rounded, HUGE_PAGE_SIZE - head);
+
+        base = aligned;
+        length = rounded;
+        mode = PageMode::NORMAL;
+
+#if defined(MADV_HUGEPAGE)
+        if (madvise(base, length, MADV_HUGEPAGE) == 0) mode = PageMode::TRANSPARENT_HUGE_PAGES;
+#endif
+    }
+
+#if defined(__linux__) && defined(SYS_mbind)
+    // the policy is set before any page is touched, so every page follows it
+    const unsigned long nodeMask = onlineNumaNodes();
+    int nodeCount = 0;
+    for (unsigned long mask = nodeMask; mask != 0; mask &= mask - 1) nodeCount++;
+
+    const int MPOL_INTERLEAVE_POLICY = 3;
+    if (interleave && nodeCount > 1 && syscall(SYS_mbind, base, length, MPOL_INTERLEAVE_POLICY, &nodeMask, 8 * sizeof(nodeMask) + 1, 0) == 0) {
+        nodes = nodeCount;
+    }
+#else
+    (void)interleave;
+#endif
+
+    return true;
+#endif
+}
+
+
+/**
+ * Release the block, if one is allocated.
+ */
+void LargeMemory::release()
+{
+    if (base == nullptr) return;
+
+#if defined(_WIN32)
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, length);
+#endif
+
+    base = nullptr;
+    length = 0;
+    mode = PageMode::NONE;
+    nodes = 1;
+}
+
+
+/**
+ * Get the start of the block.
+ *
+ * @return A pointer to the block, nullptr when none is allocated.
+ */
+void* LargeMemory::data() const
+{
+    return base;
+}
+
+
+/**
+ * Get the kind of pages the block got.
+ *
+ * @return The page mode.
+ */
+LargeMemory::PageMode LargeMemory::pageMode() const
+{
+    return mode;
+}
+
+
+/**
+ * Get the number of NUMA nodes the block is interleaved over.
+ *
+ * @return The number of nodes, 1 when the block isn't interleaved.
+ */
+int LargeMemory::interleavedNodes() const
+{
+    return nodes;
+}
+
+
+/**
+ * Describe how the block was allocated, for example "transparent huge pages, interleaved over
+ * 2 NUMA nodes".
+ *
+ * @return The description.
+ */
+std::string LargeMemory::describe() const
+{
+    std::string description;
+    switch (mode) {
+    case PageMode::NONE: return "not allocated";
+    case PageMode::NORMAL: description = "normal pages"; break;
+    case PageMode::TRANSPARENT_HUGE_PAGES: description = "transparent huge pages"; break;
+    case PageMode::HUGE_PAGES: description = "huge pages"; break;
+    }
+
+    if (nodes > 1) description += ", interleaved over " + std::to_string(nodes) + " NUMA nodes";
+    return description;
+}
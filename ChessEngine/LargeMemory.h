@@ -0,0 +1,96 @@
+/**
+ * @file LargeMemory.h
+ *
+ * Declaration of the LargeMemory class, big zeroed allocations on huge pages where the system
+ * allows them.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * @class LargeMemory
+ *
+ * A large block of memory for tables probed at random, such as the transposition table. On
+ * 4 KB pages every probe of a big table misses the TLB, so the block asks for huge pages first:
+ * explicit huge pages through MAP_HUGETLB on Linux or large pages on Windows, then transparent
+ * huge pages through madvise, and plain pages when neither is granted. On Linux the pages can
+ * also be interleaved over the NUMA nodes, so no single node's memory serves every probe.
+ *
+ * The memory is reserved but not touched, so a page lands on the node of the thread that first
+ * writes it. It is released when the object is destroyed. It can be moved but not copied.
+ */
+class LargeMemory
+{
+public:
+    /**
+     * The kind of pages an allocation got.
+     */
+    enum class PageMode {
+        NONE,                   ///< Nothing is allocated.
+        NORMAL,                 ///< Plain pages of the system's default size.
+        TRANSPARENT_HUGE_PAGES, ///< Plain pages the kernel was advised to back with huge pages.
+        HUGE_PAGES              ///< Explicit huge or large pages.
+    };
+
+    LargeMemory() = default;
+    ~LargeMemory();
+
+    LargeMemory(const LargeMemory&) = delete;
+    LargeMemory& operator=(const LargeMemory&) = delete;
+    LargeMemory(LargeMemory&& other) noexcept;
+    LargeMemory& operator=(LargeMemory&& other) noexcept;
+
+    /**
+     * Allocate a block, releasing the one allocated before.
+     *
+     * @param bytes The size of the block in bytes.
+     * @param interleave True to spread the pages over every NUMA node.
+     * @return True if the block was allocated.
+     */
+    bool allocate(std::size_t bytes, bool interleave);
+
+    /**
+     * Release the block, if one is allocated.
+     */
+    void release();
+
+    /**
+     * Get the start of the block.
+     *
+     * @return A pointer to the block, nullptr when none is allocated.
+     */
+    void* data() const;
+
+    /**
+     * Get the kind of pages the block got.
+     *
+     * @return The page mode.
+     */
+    PageMode pageMode() const;
+
+    /**
+     * Get the number of NUMA nodes the block is interleaved over.
+     *
+     * @return The number of nodes, 1 when the block isn't interleaved.
+     */
+    int interleavedNodes() const;
+
+    /**
+     * Describe how the block was allocated, for example "transparent huge pages, interleaved
+     * over 2 NUMA nodes".
+     *
+     * @return The description.
+     */
+    std::string describe() const;
+
+private:
+    void* base = nullptr;
+    std::size_t length = 0;
+    PageMode mode = PageMode::NONE;
+    int nodes = 1;
+};
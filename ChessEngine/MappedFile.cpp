@@ -0,0 +1,144 @@
+/**
+ * @file MappedFile.cpp
+ *
+ * Implementation of the MappedFile class, the platform specific memory mapping of files.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "MappedFile.h"
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : bytes(other.bytes), length(other.length), handle(other.handle)
+{
+    other.bytes = nullptr;
+    other.length = 0;
+    other.handle = nullptr;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        std::swap(handle, other.handle);
+    }
+    return *this;
+}
+
+
+/**
+ * Map a file, unmapping the one mapped before.
+ *
+ * @param path The path of the file.
+ * @return True if the file was mapped, an empty file can't be.
+ */
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // the mapping keeps the file open, its own handle isn't needed any more
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return false;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    bytes = static_cast<const std::uint8_t*>(view);
+    length = static_cast<std::size_t>(fileSize.QuadPart);
+    handle = mapping;
+    return true;
+#else
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        ::close(file);
+        return false;
+    }
+
+    // the mapping stays valid after the file is closed
+    void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED) return false;
+
+    bytes = static_cast<const std::uint8_t*>(view);
+    length = static_cast<std::size_t>(status.st_size);
+    return true;
+#endif
+}
+
+
+/**
+ * Unmap the file, if one is mapped.
+ */
+void MappedFile::close()
+{
+    if (bytes == nullptr) return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(bytes);
+    CloseHandle(handle);
+#else
+    munmap(const_cast<std::uint8_t*>(bytes), length);
+#endif
+
+    bytes = nullptr;
+    length = 0;
+    handle = nullptr;
+}
+
+
+/**
+ * Get the first byte of the mapped file.
+ *
+ * @return A pointer to the bytes of the file, nullptr when none is mapped.
+ */
+const std::uint8_t* MappedFile::data() const
+{
+    return bytes;
+}
+
+
+/**
+ * Get the size of the mapped file.
+ *
+ * @return The size in bytes, 0 when none is mapped.
+ */
+std::size_t MappedFile::size() const
+{
+    return length;
+}
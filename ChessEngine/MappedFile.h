@@ -0,0 +1,65 @@
+/**
+ * @file MappedFile.h
+ *
+ * Declaration of the MappedFile class, a read only file mapped into memory.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class MappedFile
+ *
+ * Maps a whole file into memory for reading, through mmap on POSIX systems and a file mapping on
+ * Windows. Pages are only loaded when they are read and are shared with every other process
+ * mapping the same file, so large tables cost nothing until they are used. The file is unmapped
+ * when the object is destroyed. It can be moved but not copied.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * Map a file, unmapping the one mapped before.
+     *
+     * @param path The path of the file.
+     * @return True if the file was mapped, an empty file can't be.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Unmap the file, if one is mapped.
+     */
+    void close();
+
+    /**
+     * Get the first byte of the mapped file.
+     *
+     * @return A pointer to the bytes of the file, nullptr when none is mapped.
+     */
+    const std::uint8_t* data() const;
+
+    /**
+     * Get the size of the mapped file.
+     *
+     * @return The size in bytes, 0 when none is mapped.
+     */
+    std::size_t size() const;
+
+private:
+    const std::uint8_t* bytes = nullptr;
+    std::size_t length = 0;
+    void* handle = nullptr;
+};
@@ -9,41 +9,59 @@
  * @return A vector containing ChessMove objects representing legal moves.
  */
 std::vector<ChessMove> MoveGeneration::generateColorsLegalMoves(const ChessBoard* board, bool forWhite) {
-	std::vector<ChessMove> pseudoMoves;
+	return generateColorsLegalMoves(board, forWhite, getAttackInfo(board));
+}
+
+
+/**
+ * Generates all legal moves for a specific color, reusing the attacks already computed for the
+ * board. Only king moves, moves of pinned pieces and moves out of check need to be played out
+ * to test their legality.
+ * @param board Pointer to the ChessBoard object representing the current board state.
+ * @param forWhite A boolean indicating whether to generate moves for white pieces (true) or black pieces (false).
+ * @param attacks The attacks of the board, from getAttackInfo.
+ * @return A vector containing ChessMove objects representing legal moves.
+ */
+std::vector<ChessMove> MoveGeneration::generateColorsLegalMoves(const ChessBoard* board, bool forWhite, const AttackInfo& attacks) {
 	std::vector<ChessMove> legalMoves;
 
-	// Get all pseudo moves for pawns, rooks, knights, bishops, queens, and kings.
-	const std::uint64_t* pawns = forWhite ? &board->whitePawns : &board->blackPawns;
-	const std::uint64_t* rooks = forWhite ? &board->whiteRooks : &board->blackRooks;
-	const std::uint64_t* knights = forWhite ? &board->whiteKnights : &board->blackKnights;
-	const std::uint64_t* bishops = forWhite ? &board->whiteBishops : &board->blackBishops;
-	const std::uint64_t* queens = forWhite ? &board->whiteQueens : &board->blackQueens;
-	const std::uint64_t* king = forWhite ? &board->whiteKing : &board->blackKing;
+	const int color = forWhite ? 1 : 0;
+	const std::uint64_t ownPieces = forWhite ? board->getAllWhitePieces() : board->getAllBlackPieces();
+	const std::uint64_t pawns = forWhite ? board->whitePawns : board->blackPawns;
+	const std::uint64_t king = forWhite ? board->whiteKing : board->blackKing;
 
-	std::uint64_t unprocessedPieces = board->getAllPieces();
+	// without en passant, a move outside of check can only expose the king if the king itself
+	// or a piece pinned to it moves, every other move is legal as it stands.
+	const std::uint64_t needsTest = attacks.inCheck[color] ? ownPieces : (king | attacks.pinned[color]);
 
-	// Loop through each square on the board.
-	for (std::uint8_t i = 0; i < 64; i++) {
-		std::uint64_t currMoves = 0;
+	std::uint64_t unprocessedPieces = ownPieces;
 
-		if (((*pawns >> i) & 1) == 1) currMoves = pawnPseudoMovesBitboard(board, &i, forWhite);
-		else if (((*rooks >> i) & 1) == 1) currMoves = rookPseudoMovesBitboard(board, &i, forWhite);
-		else if (((*knights >> i) & 1) == 1) currMoves = knightPseudoMovesBitboard(board, &i, forWhite);
-		else if (((*bishops >> i) & 1) == 1) currMoves = bishopPseudoMovesBitboard(board, &i, forWhite);
-		else if (((*queens >> i) & 1) == 1) currMoves = queenPseudoMovesBitboard(board, &i, forWhite);
-		else if (((*king >> i) & 1) == 1) currMoves = kingPseudoMovesBitboard(board, &i, forWhite);
+	// Loop through each of the color's pieces, lowest square first.
+	while (unprocessedPieces != 0) {
+		const std::uint8_t i = (std::uint8_t)data::bits::lowestSquare(unprocessedPieces);
+		unprocessedPieces &= unprocessedPieces - 1;
 
-		if (currMoves == 0) continue;
+		// pawns push as well as capture, every other piece moves to the squares it attacks.
+		std::uint64_t currMoves = ((pawns >> i) & 1) == 1
+			? pawnPseudoMovesBitboard(board, &i, forWhite)
+			: attacks.attacksFrom[i] & ~ownPieces;
+		const bool testMoves = ((needsTest >> i) & 1) == 1;
 
 		// Loop through possible destination squares.
-		for (std::uint8_t j = 0; j < 64; j++) {
-			if (((currMoves >> j) & 1) != 1) continue;
+		while (currMoves != 0) {
+			const std::uint8_t j = (std::uint8_t)data::bits::lowestSquare(currMoves);
+			currMoves &= currMoves - 1;
 			ChessMove move(i, j);
-			ChessBoard newBoard = *board; // Create a copy of the board by value
-			newBoard.makeMove(move.fromSquare, move.toSquare);
 
-			// Check if the move results in the player's own king being in check.
-			if (!isCheck(&newBoard, forWhite)) legalMoves.push_back(move);
+			if (testMoves) {
+				ChessBoard newBoard = *board; // Create a copy of the board by value
+				newBoard.makeMove(move.fromSquare, move.toSquare);
+
+				// Check if the move results in the player's own king being in check.
+				if (isCheck(&newBoard, forWhite)) continue;
+			}
+
+			legalMoves.push_back(move);
 		}
 	}
 
@@ -103,11 +121,13 @@ std::vector<ChessMove> MoveGeneration::generateSquaresLegalMoves(const ChessBoar
  */
 bool MoveGeneration::isCheck(const ChessBoard* board, bool forWhite)
 {
-	if (forWhite) {
-		return (getDangerSquares(board, false) & board->whiteKing) != 0;
-	}
+	const std::uint64_t king = forWhite ? board->whiteKing : board->blackKing;
+	if (king == 0) return false;
 
-	return (getDangerSquares(board, true) & board->blackKing) != 0;
+	// look outwards from the king for enemy attackers rather than computing every enemy attack
+	const std::uint64_t enemyPieces = forWhite ? board->getAllBlackPieces() : board->getAllWhitePieces();
+	const std::uint8_t kingSquare = (std::uint8_t)data::bits::lowestSquare(king);
+	return (getAttackersTo(board, kingSquare, board->getAllPieces()) & enemyPieces) != 0;
 }
 
 
@@ -145,6 +165,123 @@ std::uint64_t MoveGeneration::getDangerSquares(const ChessBoard* board, bool asW
 }
 
 
+/**
+ * Computes the attacks of every piece on the board, with the per side unions, double attacks,
+ * king zones, pins and checks derived from them.
+ * @param board Pointer to the ChessBoard object representing the current board state.
+ * @return The attack information of the board.
+ */
+AttackInfo MoveGeneration::getAttackInfo(const ChessBoard* board)
+{
+	AttackInfo info;
+
+	const std::uint64_t occupied = board->getAllPieces();
+	const std::uint64_t hFile = data::masks::fileMask[0];
+	const std::uint64_t aFile = data::masks::fileMask[7];
+
+	for (int type = 0; type < 12; type++) {
+		const ChessBoard::PieceType piece = static_cast<ChessBoard::PieceType>(type);
+		const int color = type < 6 ? 1 : 0;
+		std::uint64_t pieces = board->getPieceBitboard(piece);
+
+		while (pieces != 0) {
+			const std::uint8_t square = (std::uint8_t)data::bits::lowestSquare(pieces);
+			const std::uint64_t bit = pieces & (~pieces + 1);
+			pieces &= pieces - 1;
+
+			std::uint64_t attacks = 0;
+			switch (piece) {
+			case ChessBoard::PieceType::WHITE_PAWN: attacks = ((bit & ~aFile) << 9) | ((bit & ~hFile) << 7); break;
+			case ChessBoard::PieceType::BLACK_PAWN: attacks = ((bit & ~aFile) >> 7) | ((bit & ~hFile) >> 9); break;
+			case ChessBoard::PieceType::WHITE_KNIGHT:
+			case ChessBoard::PieceType::BLACK_KNIGHT: attacks = movetables::knightMoveTable[square]; break;
+			case ChessBoard::PieceType::WHITE_BISHOP:
+			case ChessBoard::PieceType::BLACK_BISHOP: attacks = bishopAttacks(square, occupied); break;
+			case ChessBoard::PieceType::WHITE_ROOK:
+			case ChessBoard::PieceType::BLACK_ROOK: attacks = rookAttacks(square, occupied); break;
+			case ChessBoard::PieceType::WHITE_QUEEN:
+			case ChessBoard::PieceType::BLACK_QUEEN: attacks = bishopAttacks(square, occupied) | rookAttacks(square, occupied); break;
+			default: attacks = movetables::kingMoveTable[square]; break;
+			}
+
+			info.attacksFrom[square] = attacks;
+			info.byPieceType[type] |= attacks;
+			info.doubleAttacks[color] |= info.bySide[color] & attacks;
+			info.bySide[color] |= attacks;
+		}
+	}
+
+	for (int color = 0; color < 2; color++) {
+		const bool isWhite = color == 1;
+		const std::uint64_t king = isWhite ? board->whiteKing : board->blackKing;
+		if (king == 0) continue;
+
+		const std::uint8_t kingSquare = (std::uint8_t)data::bits::lowestSquare(king);
+		const std::uint64_t ownPieces = isWhite ? board->getAllWhitePieces() : board->getAllBlackPieces();
+		const std::uint64_t enemyPieces = isWhite ? board->getAllBlackPieces() : board->getAllWhitePieces();
+		const std::uint64_t enemyQueens = isWhite ? board->blackQueens : board->whiteQueens;
+
+		info.kingZone[color] = king | movetables::kingMoveTable[kingSquare];
+		info.kingZoneAttacks[color] = info.kingZone[color] & info.bySide[1 - color];
+		info.inCheck[color] = (king & info.bySide[1 - color]) != 0;
+
+		// a pinner is an enemy slider that would see the king if the own pieces were not there. The
+		// rays from the king and from the pinner meet on the pinned piece, and only if it stands alone.
+		const std::uint64_t kingStraight = rookAttacks(kingSquare, occupied);
+		const std::uint64_t kingDiagonal = bishopAttacks(kingSquare, occupied);
+
+		std::uint64_t pinners = rookAttacks(kingSquare, enemyPieces) & ((isWhite ? board->blackRooks : board->whiteRooks) | enemyQueens);
+		while (pinners != 0) {
+			const std::uint8_t pinner = (std::uint8_t)data::bits::lowestSquare(pinners);
+			pinners &= pinners - 1;
+			info.pinned[color] |= kingStraight & rookAttacks(pinner, occupied) & ownPieces;
+		}
+
+		pinners = bishopAttacks(kingSquare, enemyPieces) & ((isWhite ? board->blackBishops : board->whiteBishops) | enemyQueens);
+		while (pinners != 0) {
+			const std::uint8_t pinner = (std::uint8_t)data::bits::lowestSquare(pinners);
+			pinners &= pinners - 1;
+			info.pinned[color] |= kingDiagonal & bishopAttacks(pinner, occupied) & ownPieces;
+		}
+	}
+
+	return info;
+}
+
+
+/**
+ * Retrieves a bitboard of every piece, of either color, that attacks a square. Only pieces in
+ * the occupied bitboard are considered and only they block sliding pieces, so removing a piece
+ * from it reveals the sliders behind it (x-rays).
+ * @param board Pointer to the ChessBoard object representing the current board state.
+ * @param square The square (0-63) being attacked.
+ * @param occupied A bitboard of the squares considered occupied.
+ * @return A bitboard where set bits are the pieces attacking the square.
+ */
+std::uint64_t MoveGeneration::getAttackersTo(const ChessBoard* board, std::uint8_t square, std::uint64_t occupied)
+{
+	const std::uint64_t target = (std::uint64_t)1 << square;
+	const std::uint64_t hFile = data::masks::fileMask[0];
+	const std::uint64_t aFile = data::masks::fileMask[7];
+
+	// a pawn attacks the square if a pawn of the other color on the square would attack it back
+	const std::uint64_t whitePawnSources = ((target & ~hFile) >> 9) | ((target & ~aFile) >> 7);
+	const std::uint64_t blackPawnSources = ((target & ~hFile) << 7) | ((target & ~aFile) << 9);
+
+	const std::uint64_t diagonalSliders = board->whiteBishops | board->whiteQueens | board->blackBishops | board->blackQueens;
+	const std::uint64_t straightSliders = board->whiteRooks | board->whiteQueens | board->blackRooks | board->blackQueens;
+
+	const std::uint64_t attackers = (whitePawnSources & board->whitePawns)
+		| (blackPawnSources & board->blackPawns)
+		| (movetables::knightMoveTable[square] & (board->whiteKnights | board->blackKnights))
+		| (movetables::kingMoveTable[square] & (board->whiteKing | board->blackKing))
+		| (bishopAttacks(square, occupied) & diagonalSliders)
+		| (rookAttacks(square, occupied) & straightSliders);
+
+	return attackers & occupied;
+}
+
+
 /**
  * Generates pseudo moves for a knight located on a specific square on the chessboard.
  * @param board Pointer to the ChessBoard object representing the current board state.
@@ -196,14 +333,14 @@ std::uint64_t MoveGeneration::pawnPseudoMovesBitboard(const ChessBoard* board, c
 
 	// these are file masks, they will be used to enforce the board boundry when calculating
 	// if a pawn can currently capture left / right.
-	const std::uint64_t file1Mask = data::masks::rankMask[data::masks::file::FILE_1];
-	const std::uint64_t file8Mask = data::masks::rankMask[data::masks::file::FILE_8];
+	const std::uint64_t aFileMask = data::masks::fileMask[7];
+	const std::uint64_t hFileMask = data::masks::fileMask[0];
 
 	// Calculate shifted bitboards by directions based on color
 	const std::uint64_t forward = forWhite ? pawn << 8 : pawn >> 8;
 
-	const std::uint64_t captureLeft = forWhite ? (pawn & ~file1Mask) << 9 : (pawn & ~file1Mask) >> 7;
-	const std::uint64_t captureRight = forWhite ? (pawn & ~file8Mask) << 7 : (pawn & ~file8Mask) >> 9;
+	const std::uint64_t captureLeft = forWhite ? (pawn & ~aFileMask) << 9 : (pawn & ~aFileMask) >> 7;
+	const std::uint64_t captureRight = forWhite ? (pawn & ~hFileMask) << 7 : (pawn & ~hFileMask) >> 9;
 
 	// mask there shifted bitboards to determin if move is psudo legal.
 	std::uint64_t singleMove = forward & ~board->getAllPieces();
@@ -227,21 +364,33 @@ std::uint64_t MoveGeneration::pawnPseudoMovesBitboard(const ChessBoard* board, c
  * @return A bitboard representing pseudo moves for the bishop.
  */
 std::uint64_t MoveGeneration::bishopPseudoMovesBitboard(const ChessBoard* board, const std::uint8_t* square, bool forWhite)
+{
+	const std::uint64_t magicMoves = bishopAttacks(*square, board->getAllPieces());
+
+	// in a magic bitboard we can capture our own peices, to sort this out we can just mask out our own pieces.
+	return magicMoves & (forWhite ? ~board->getAllWhitePieces() : ~board->getAllBlackPieces());
+}
+
+
+/**
+ * Retrieves the squares a bishop attacks from a square, for any set of blockers.
+ * @param square The square (0-63) the bishop is on.
+ * @param occupied A bitboard of the squares considered occupied.
+ * @return A bitboard of the attacked squares, the first blocker in each direction included.
+ */
+std::uint64_t MoveGeneration::bishopAttacks(std::uint8_t square, std::uint64_t occupied)
 {
 	// get the current blocker bitboard in a blocker bitboard, any peice which can halt the sliding
 	// piece is marked as a 1. Everything else is marked as 0.
-	const std::uint64_t blockerBoard = data::masks::bishopBlockerMask[*square] & board->getAllPieces();
+	const std::uint64_t blockerBoard = data::masks::bishopBlockerMask[square] & occupied;
 
 	// using magic bitboards the magic index is calculated by the formula i = blocker * magic_number >> shifter
 	// we can find all this information in our chess data class, so we can simiply numbr crunch the formula.
-	const std::uint64_t magicIndex = (blockerBoard * data::magicbitboards::bishoptMagicNumbers[*square]) >> data::magicbitboards::bishopMagicKeyShift[*square];
+	const std::uint64_t magicIndex = (blockerBoard * data::magicbitboards::bishoptMagicNumbers[square]) >> data::magicbitboards::bishopMagicKeyShift[square];
 
 	// this is where the magic of magic biboards shine, we can simiply index into an already computed lookup table to
 	// find what the possible moves are.
-	const std::uint64_t magicMoves = movetables::bishopMoveTable[magicIndex + data::magicbitboards::bishopFlatternedIndices[*square]];
-
-	// in a magic bitboard we can capture our own peices, to sort this out we can just mask out our own pieces.
-	return magicMoves & (forWhite ? ~board->getAllWhitePieces() : ~board->getAllBlackPieces());
+	return movetables::bishopMoveTable[magicIndex + data::magicbitboards::bishopFlatternedIndices[square]];
 }
 
 
@@ -254,15 +403,95 @@ std::uint64_t MoveGeneration::bishopPseudoMovesBitboard(const ChessBoard* board,
  */
 std::uint64_t MoveGeneration::rookPseudoMovesBitboard(const ChessBoard* board, const std::uint8_t* square, bool forWhite)
 {
-	// follows same logic as the bishop generation
-	const std::uint64_t blockerBoard = data::masks::rookBlockerMask[*square] & board->getAllPieces();
-	const std::uint64_t magicIndex = (blockerBoard * data::magicbitboards::rooktMagicNumbers[*square]) >> data::magicbitboards::rooktMagicKeyShift[*square];
-	const std::uint64_t magicMoves = movetables::rookMoveTable[magicIndex + data::magicbitboards::rooktFlatternedIndices[*square]];
+	const std::uint64_t magicMoves = rookAttacks(*square, board->getAllPieces());
 
 	return magicMoves & (forWhite ? ~board->getAllWhitePieces() : ~board->getAllBlackPieces());
 }
 
 
+/**
+ * Retrieves the squares a rook attacks from a square, for any set of blockers.
+ * @param square The square (0-63) the rook is on.
+ * @param occupied A bitboard of the squares considered occupied.
+ * @return A bitboard of the attacked squares, the first blocker in each direction included.
+ */
+std::uint64_t MoveGeneration::rookAttacks(std::uint8_t square, std::uint64_t occupied)
+{
+	// follows same logic as the bishop generation
+	const std::uint64_t blockerBoard = data::masks::rookBlockerMask[square] & occupied;
+	const std::uint64_t magicIndex = (blockerBoard * data::magicbitboards::rooktMagicNumbers[square]) >> data::magicbitboards::rooktMagicKeyShift[square];
+	return movetables::rookMoveTable[magicIndex + data::magicbitboards::rooktFlatternedIndices[square]];
+}
+
+
+/**
+ * Walks the rays from a square in the given directions, each up to and including its first
+ * blocker, the way the move tables are generated.
+ * @param square The square (0-63) the piece is on.
+ * @param occupied A bitboard of the squares considered occupied.
+ * @param directions The rank and file steps of the four rays.
+ * @return A bitboard of the attacked squares.
+ */
+static std::uint64_t rayAttacks(int square, std::uint64_t occupied, const int (&directions)[4][2])
+{
+	std::uint64_t attacks = 0;
+	for (const auto& direction : directions) {
+		int rank = square / 8 + direction[0];
+		int file = square % 8 + direction[1];
+
+		for (; rank >= 0 && rank < 8 && file >= 0 && file < 8; rank += direction[0], file += direction[1]) {
+			const std::uint64_t bit = static_cast<std::uint64_t>(1) << (rank * 8 + file);
+			attacks |= bit;
+			if ((occupied & bit) != 0) break;
+		}
+	}
+
+	return attacks;
+}
+
+
+/**
+ * Checks the rook and bishop lookups against the attacks found by walking their rays, for
+ * every blocker pattern on every square. The move tables are generated apart from the magic
+ * numbers, so a magic that sends two patterns to the same entry, or a table that no longer
+ * matches its magics, shows up here rather than as illegal moves. It also checks the position
+ * Q7/1k6/8/8/8/8/8/6KQ b, where the king may not take on a8 as h1 x-rays through b7.
+ * @return True if every lookup matches its rays.
+ */
+bool MoveGeneration::checkSliderTables()
+{
+	static const int rookDirections[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+	static const int bishopDirections[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+
+	for (std::uint8_t square = 0; square < 64; square++) {
+		// every subset of the blocker masks, by the carry-rippler trick
+		const std::uint64_t rookMask = data::masks::rookBlockerMask[square];
+		std::uint64_t blockers = 0;
+		do {
+			if (rookAttacks(square, blockers) != rayAttacks(square, blockers, rookDirections)) return false;
+			blockers = (blockers - rookMask) & rookMask;
+		} while (blockers != 0);
+
+		const std::uint64_t bishopMask = data::masks::bishopBlockerMask[square];
+		blockers = 0;
+		do {
+			if (bishopAttacks(square, blockers) != rayAttacks(square, blockers, bishopDirections)) return false;
+			blockers = (blockers - bishopMask) & bishopMask;
+		} while (blockers != 0);
+	}
+
+	// the position a broken a8 bishop magic played b7a8 in, only b7b6 and b7c7 are legal
+	ChessBoard board;
+	board.setPiece(ChessBoard::PieceType::WHITE_QUEEN, 7, 7);
+	board.setPiece(ChessBoard::PieceType::WHITE_QUEEN, 0, 0);
+	board.setPiece(ChessBoard::PieceType::WHITE_KING, 0, 1);
+	board.setPiece(ChessBoard::PieceType::BLACK_KING, 6, 6);
+	board.currPlayer = false;
+
+	return generateColorsLegalMoves(&board, false).size() == 2;
+}
+
+
 /**
  * Generates pseudo moves for a queen located on a specific square on the chessboard.
  * A queen's pseudo moves are a combination of rook and bishop pseudo moves.
@@ -23,6 +23,11 @@
  */
 struct ChessMove {
 public:
+    /**
+     * Constructor for creating an empty ChessMove, from and to the same square.
+     */
+    ChessMove() : fromSquare(0), toSquare(0) {};
+
     /**
      * Constructor for creating a ChessMove object.
      * @param from The source square of the move.
@@ -36,10 +41,40 @@ public:
      */
     ChessMove(const ChessMove& other) : fromSquare(other.fromSquare), toSquare(other.toSquare) {}
 
+    /**
+     * Copy assignment from another ChessMove.
+     * @param other The ChessMove object to copy from.
+     */
+    ChessMove& operator=(const ChessMove& other) = default;
+
+    /**
+     * Compare two moves by their squares.
+     * @param other The ChessMove object to compare with.
+     * @return True if both moves go from and to the same squares.
+     */
+    bool operator==(const ChessMove& other) const { return fromSquare == other.fromSquare && toSquare == other.toSquare; }
+
     std::uint8_t fromSquare; ///< Source square of the move.
     std::uint8_t toSquare;   ///< Destination square of the move.
 };
 
+/**
+ * @struct AttackInfo
+ * The attacks of every piece on the board, computed once per node so the evaluation, check
+ * detection and move generation share the slider lookups instead of repeating them. Sides are
+ * indexed by color with 1 for white and 0 for black.
+ */
+struct AttackInfo {
+    std::uint64_t attacksFrom[64] = {};    ///< Squares attacked by the piece on each square, 0 for empty squares.
+    std::uint64_t byPieceType[12] = {};    ///< Union of the attacks of each piece type, indexed by ChessBoard::PieceType.
+    std::uint64_t bySide[2] = {};          ///< Every square each side attacks.
+    std::uint64_t doubleAttacks[2] = {};   ///< Squares each side attacks with at least two pieces.
+    std::uint64_t kingZone[2] = {};        ///< Each side's king square and the squares around it.
+    std::uint64_t kingZoneAttacks[2] = {}; ///< The squares of each side's king zone the other side attacks.
+    std::uint64_t pinned[2] = {};          ///< Each side's pieces pinned to their own king.
+    bool inCheck[2] = {};                  ///< Whether each side's king is attacked.
+};
+
 /**
  * @class MoveGeneration
  * Provides methods for generating legal chess moves, checking for checks, and finding danger squares.
@@ -54,6 +89,17 @@ public:
      */
     static std::vector<ChessMove> generateColorsLegalMoves(const ChessBoard* board, bool forWhite);
 
+    /**
+     * Generates all legal moves for a specific color, reusing the attacks already computed for the
+     * board. Only king moves, moves of pinned pieces and moves out of check need to be played out
+     * to test their legality.
+     * @param board Pointer to the ChessBoard object representing the current board state.
+     * @param forWhite A boolean indicating whether to generate moves for white pieces (true) or black pieces (false).
+     * @param attacks The attacks of the board, from getAttackInfo.
+     * @return A vector containing ChessMove objects representing legal moves.
+     */
+    static std::vector<ChessMove> generateColorsLegalMoves(const ChessBoard* board, bool forWhite, const AttackInfo& attacks);
+
     /**
      * Generates all legal moves for a piece located on a specific square on the chessboard.
      * @param board Pointer to the ChessBoard object representing the current board state.
@@ -79,6 +125,51 @@ public:
      */
     static std::uint64_t getDangerSquares(const ChessBoard* board, bool asWhite);
 
+    /**
+     * Computes the attacks of every piece on the board, with the per side unions, double attacks,
+     * king zones, pins and checks derived from them.
+     * @param board Pointer to the ChessBoard object representing the current board state.
+     * @return The attack information of the board.
+     */
+    static AttackInfo getAttackInfo(const ChessBoard* board);
+
+    /**
+     * Retrieves a bitboard of every piece, of either color, that attacks a square. Only pieces in
+     * the occupied bitboard are considered and only they block sliding pieces, so removing a piece
+     * from it reveals the sliders behind it (x-rays).
+     * @param board Pointer to the ChessBoard object representing the current board state.
+     * @param square The square (0-63) being attacked.
+     * @param occupied A bitboard of the squares considered occupied.
+     * @return A bitboard where set bits are the pieces attacking the square.
+     */
+    static std::uint64_t getAttackersTo(const ChessBoard* board, std::uint8_t square, std::uint64_t occupied);
+
+    /**
+     * Retrieves the squares a bishop attacks from a square, for any set of blockers.
+     * @param square The square (0-63) the bishop is on.
+     * @param occupied A bitboard of the squares considered occupied.
+     * @return A bitboard of the attacked squares, the first blocker in each direction included.
+     */
+    static std::uint64_t bishopAttacks(std::uint8_t square, std::uint64_t occupied);
+
+    /**
+     * Retrieves the squares a rook attacks from a square, for any set of blockers.
+     * @param square The square (0-63) the rook is on.
+     * @param occupied A bitboard of the squares considered occupied.
+     * @return A bitboard of the attacked squares, the first blocker in each direction included.
+     */
+    static std::uint64_t rookAttacks(std::uint8_t square, std::uint64_t occupied);
+
+    /**
+     * Checks the rook and bishop lookups against the attacks found by walking their rays, for
+     * every blocker pattern on every square. The move tables are generated apart from the magic
+     * numbers, so a magic that sends two patterns to the same entry, or a table that no longer
+     * matches its magics, shows up here rather than as illegal moves. It also checks the position
+     * Q7/1k6/8/8/8/8/8/6KQ b, where the king may not take on a8 as h1 x-rays through b7.
+     * @return True if every lookup matches its rays.
+     */
+    static bool checkSliderTables();
+
 private:
     // Functions to generate pseudo moves for specific pieces
     static std::uint64_t pawnPseudoMovesBitboard(const ChessBoard* board, const std::uint8_t* square, bool forWhite);
@@ -0,0 +1,363 @@
+/**
+ * @file Nnue.cpp
+ *
+ * Implementation of the efficiently updatable neural network evaluation, with AVX2, SSE2 and
+ * scalar versions of its kernels.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "Nnue.h"
+#include "ChessData.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__AVX2__)
+#define NNUE_USE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NNUE_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Hidden layer sums are scaled down by 2^6 before the clipped ReLU, the output by 16 to centipawns.
+constexpr int WEIGHT_SCALE_BITS = 6;
+constexpr int OUTPUT_SCALE = 16;
+
+constexpr std::uint32_t FILE_VERSION = 1;
+
+Nnue::Network Nnue::network;
+bool Nnue::loaded = false;
+
+
+/**
+ * Add a first layer weight row to an accumulator view.
+ */
+static void addRow(std::int16_t* values, const std::int16_t* row) {
+#if defined(NNUE_USE_AVX2)
+    for (int i = 0; i < Nnue::halfDimensions; i += 16) {
+        const __m256i sum = _mm256_add_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), sum);
+    }
+#elif defined(NNUE_USE_SSE2)
+    for (int i = 0; i < Nnue::halfDimensions; i += 8) {
+        const __m128i sum = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), sum);
+    }
+#else
+    for (int i = 0; i < Nnue::halfDimensions; i++) values[i] += row[i];
+#endif
+}
+
+
+/**
+ * Subtract a first layer weight row from an accumulator view.
+ */
+static void subtractRow(std::int16_t* values, const std::int16_t* row) {
+#if defined(NNUE_USE_AVX2)
+    for (int i = 0; i < Nnue::halfDimensions; i += 16) {
+        const __m256i difference = _mm256_sub_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), difference);
+    }
+#elif defined(NNUE_USE_SSE2)
+    for (int i = 0; i < Nnue::halfDimensions; i += 8) {
+        const __m128i difference = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), difference);
+    }
+#else
+    for (int i = 0; i < Nnue::halfDimensions; i++) values[i] -= row[i];
+#endif
+}
+
+
+/**
+ * Clamp an accumulator view to [0, 127] and narrow it to bytes, the input of the first hidden layer.
+ */
+static void clippedRelu(const std::int16_t* values, std::uint8_t* output) {
+#if defined(NNUE_USE_AVX2)
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < Nnue::halfDimensions; i += 32) {
+        const __m256i low = _mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), zero);
+        const __m256i high = _mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 16)), zero);
+
+        // packing saturates at 127 but works per 128 bit lane, the permute puts the lanes back in order
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), packed);
+    }
+#elif defined(NNUE_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < Nnue::halfDimensions; i += 16) {
+        const __m128i low = _mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)), zero);
+        const __m128i high = _mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + 8)), zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi16(low, high));
+    }
+#else
+    for (int i = 0; i < Nnue::halfDimensions; i++) output[i] = static_cast<std::uint8_t>(std::min(std::max<int>(values[i], 0), 127));
+#endif
+}
+
+
+/**
+ * The dot product of a layer's byte inputs with one row of its int8 weights.
+ *
+ * @param input The inputs, all in [0, 127].
+ * @param weights The weight row.
+ * @param count The number of inputs, a multiple of 32.
+ * @return The sum of the products.
+ */
+static std::int32_t dotProduct(const std::uint8_t* input, const std::int8_t* weights, int count) {
+#if defined(NNUE_USE_AVX2)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < count; i += 32) {
+        // inputs are at most 127 so the pairwise int16 sums can't saturate
+        const __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+    return _mm_cvtsi128_si32(total);
+#elif defined(NNUE_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < count; i += 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        const __m128i weight = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+
+        // widen to int16, zero extending the inputs and sign extending the weights
+        const __m128i inLow = _mm_unpacklo_epi8(in, zero);
+        const __m128i inHigh = _mm_unpackhi_epi8(in, zero);
+        const __m128i weightLow = _mm_srai_epi16(_mm_unpacklo_epi8(weight, weight), 8);
+        const __m128i weightHigh = _mm_srai_epi16(_mm_unpackhi_epi8(weight, weight), 8);
+
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(inLow, weightLow));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(inHigh, weightHigh));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    std::int32_t sum = 0;
+    for (int i = 0; i < count; i++) sum += input[i] * weights[i];
+    return sum;
+#endif
+}
+
+
+/**
+ * Run a hidden layer, an affine transform followed by a clipped ReLU.
+ *
+ * @param input The layer's inputs.
+ * @param inputCount The number of inputs.
+ * @param biases The layer's biases, one per output.
+ * @param weights The layer's weights, one row of inputCount per output.
+ * @param output Filled with the layer's outputs, hiddenDimensions of them.
+ */
+static void hiddenLayer(const std::uint8_t* input, int inputCount, const std::int32_t* biases, const std::int8_t* weights, std::uint8_t* output) {
+    for (int i = 0; i < Nnue::hiddenDimensions; i++) {
+        const std::int32_t sum = biases[i] + dotProduct(input, weights + i * inputCount, inputCount);
+        output[i] = static_cast<std::uint8_t>(std::min(std::max(sum >> WEIGHT_SCALE_BITS, 0), 127));
+    }
+}
+
+
+/**
+ * Read an array of little endian values from a network file.
+ */
+template <typename T>
+static bool readArray(std::ifstream& file, std::vector<T>& values, std::size_t count) {
+    values.resize(count);
+    file.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    return file.good();
+}
+
+
+/**
+ * Load a network file, replacing the network in use. Must not be called during a search.
+ *
+ * @param path The path of the network file.
+ * @return True if the file was read, on failure the previous network stays in use.
+ */
+bool Nnue::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char tag[4];
+    std::uint32_t version = 0;
+    file.read(tag, 4);
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!file || std::memcmp(tag, "CENN", 4) != 0 || version != FILE_VERSION) return false;
+
+    Network candidate;
+    std::vector<std::int32_t> outputBias;
+
+    const bool complete = readArray(file, candidate.featureBiases, halfDimensions)
+        && readArray(file, candidate.featureWeights, static_cast<std::size_t>(inputDimensions) * halfDimensions)
+        && readArray(file, candidate.hidden1Biases, hiddenDimensions)
+        && readArray(file, candidate.hidden1Weights, hiddenDimensions * 2 * halfDimensions)
+        && readArray(file, candidate.hidden2Biases, hiddenDimensions)
+        && readArray(file, candidate.hidden2Weights, hiddenDimensions * hiddenDimensions)
+        && readArray(file, outputBias, 1)
+        && readArray(file, candidate.outputWeights, hiddenDimensions);
+
+    // a longer file is a different architecture
+    if (!complete || file.peek() != std::ifstream::traits_type::eof()) return false;
+
+    candidate.outputBias = outputBias[0];
+    network = std::move(candidate);
+    loaded = true;
+    return true;
+}
+
+
+/**
+ * Check if a network is loaded.
+ *
+ * @return True if evaluate may be used.
+ */
+bool Nnue::isLoaded()
+{
+    return loaded;
+}
+
+
+/**
+ * Get the input a piece on a square switches on in one side's view. Black's view is flipped
+ * vertically, and pieces are split into the viewing side's and the opponent's.
+ *
+ * @param perspective The side whose view it is (true for white, false for black).
+ * @param kingSquare The square of that side's king.
+ * @param piece The piece, not a king.
+ * @param square The square of the piece.
+ * @return The index of the input.
+ */
+int Nnue::featureIndex(bool perspective, int kingSquare, ChessBoard::PieceType piece, int square)
+{
+    const int type = static_cast<int>(piece) % 6;
+    const bool pieceIsWhite = static_cast<int>(piece) < 6;
+    const int pieceIndex = type * 2 + (pieceIsWhite != perspective ? 1 : 0);
+
+    if (!perspective) {
+        kingSquare ^= 56;
+        square ^= 56;
+    }
+
+    return (kingSquare * 10 + pieceIndex) * 64 + square;
+}
+
+
+/**
+ * Build one side's view of the accumulator from scratch.
+ */
+void Nnue::refreshPerspective(Accumulator& accumulator, const ChessBoard* board, bool perspective)
+{
+    std::int16_t* values = accumulator.values[perspective];
+    std::copy(network.featureBiases.begin(), network.featureBiases.end(), values);
+
+    const std::uint64_t king = perspective ? board->whiteKing : board->blackKing;
+    if (king == 0) return;
+    const int kingSquare = data::bits::lowestSquare(king);
+
+    for (int type = 0; type < 12; type++) {
+        const ChessBoard::PieceType piece = static_cast<ChessBoard::PieceType>(type);
+        if (type % 6 == 5) continue; // kings are not inputs
+
+        std::uint64_t pieces = board->getPieceBitboard(piece);
+        while (pieces != 0) {
+            const int square = data::bits::lowestSquare(pieces);
+            pieces &= pieces - 1;
+            addRow(values, &network.featureWeights[static_cast<std::size_t>(featureIndex(perspective, kingSquare, piece, square)) * halfDimensions]);
+        }
+    }
+}
+
+
+/**
+ * Build both views of the accumulator from scratch.
+ *
+ * @param accumulator The accumulator to fill.
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ */
+void Nnue::refresh(Accumulator& accumulator, const ChessBoard* board)
+{
+    refreshPerspective(accumulator, board, true);
+    refreshPerspective(accumulator, board, false);
+}
+
+
+/**
+ * Derive the accumulator of the position after a move from the one before it. The moved piece
+ * switches one input off and another on and a captured piece switches one off, except when a
+ * king moves, then every input of its own view changes and that view is rebuilt.
+ *
+ * @param parent The accumulator of the position before the move.
+ * @param child Filled with the accumulator of the position after the move.
+ * @param board The position before the move.
+ * @param newBoard The position after the move.
+ * @param move The move that was made.
+ */
+void Nnue::update(const Accumulator& parent, Accumulator& child, const ChessBoard* board, const ChessBoard* newBoard, const ChessMove& move)
+{
+    const ChessBoard::PieceType moved = board->getPieceTypeAtSquare(move.fromSquare / 8, move.fromSquare % 8);
+    const ChessBoard::PieceType captured = board->getPieceTypeAtSquare(move.toSquare / 8, move.toSquare % 8);
+    const bool movedIsKing = moved == ChessBoard::PieceType::WHITE_KING || moved == ChessBoard::PieceType::BLACK_KING;
+    const bool moverIsWhite = static_cast<int>(moved) < 6;
+
+    for (int side = 0; side < 2; side++) {
+        const bool perspective = side == 1;
+
+        if (movedIsKing && moverIsWhite == perspective) {
+            refreshPerspective(child, newBoard, perspective);
+            continue;
+        }
+
+        std::int16_t* values = child.values[perspective];
+        std::copy(parent.values[perspective], parent.values[perspective] + halfDimensions, values);
+
+        const std::uint64_t king = perspective ? newBoard->whiteKing : newBoard->blackKing;
+        if (king == 0) continue;
+        const int kingSquare = data::bits::lowestSquare(king);
+
+        if (!movedIsKing) {
+            subtractRow(values, &network.featureWeights[static_cast<std::size_t>(featureIndex(perspective, kingSquare, moved, move.fromSquare)) * halfDimensions]);
+            addRow(values, &network.featureWeights[static_cast<std::size_t>(featureIndex(perspective, kingSquare, moved, move.toSquare)) * halfDimensions]);
+        }
+        if (captured != ChessBoard::PieceType::EMPTY) {
+            subtractRow(values, &network.featureWeights[static_cast<std::size_t>(featureIndex(perspective, kingSquare, captured, move.toSquare)) * halfDimensions]);
+        }
+    }
+}
+
+
+/**
+ * Evaluate a position from its accumulator. The side to move's view comes first, then the
+ * opponent's, followed by the two hidden layers and the output.
+ *
+ * @param accumulator The up to date accumulator of the position.
+ * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+ * @return The evaluation in centipawns, positive when currPlayer is ahead.
+ */
+int Nnue::evaluate(const Accumulator& accumulator, bool currPlayer)
+{
+    alignas(32) std::uint8_t input[2 * halfDimensions];
+    alignas(32) std::uint8_t hidden1[hiddenDimensions];
+    alignas(32) std::uint8_t hidden2[hiddenDimensions];
+
+    clippedRelu(accumulator.values[currPlayer], input);
+    clippedRelu(accumulator.values[!currPlayer], input + halfDimensions);
+
+    hiddenLayer(input, 2 * halfDimensions, network.hidden1Biases.data(), network.hidden1Weights.data(), hidden1);
+    hiddenLayer(hidden1, hiddenDimensions, network.hidden2Biases.data(), network.hidden2Weights.data(), hidden2);
+
+    const std::int32_t output = network.outputBias + dotProduct(hidden2, network.outputWeights.data(), hiddenDimensions);
+    return output / OUTPUT_SCALE;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file Nnue.h
+ *
+ * Declaration of the Nnue class, an efficiently updatable neural network evaluation. The first
+ * layer is kept up to date move by move in an accumulator, so evaluating a position costs little
+ * more than the three small layers on top of it.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MoveGeneration.h"
+
+/**
+ * @class Nnue
+ *
+ * A HalfKP network, 2 x 256 -> 32 -> 32 -> 1. Each side has its own view of the board: one input
+ * for every (own king square, piece, square) combination, with the board flipped for black so both
+ * views look the same. A move only switches a couple of inputs on and off, so the 256 first layer
+ * sums of each view, the accumulator, are updated by adding and subtracting a few weight rows
+ * instead of being recomputed. Only a king move forces its own view to be rebuilt.
+ *
+ * The weights are quantised, int16 for the first layer and int8 for the rest, and run by AVX2 or
+ * SSE2 kernels when the compiler targets them, with a scalar fallback.
+ *
+ * A network file is a 4 byte "CENN" tag and a uint32 version of 1, followed by every layer in
+ * little endian order: the first layer's int16 biases[256] and weights[40960][256], then for each
+ * of the two hidden layers int32 biases[32] and int8 weights[32][inputs], and last the int32
+ * output bias and int8 output weights[32].
+ */
+class Nnue
+{
+public:
+    static const int inputDimensions = 64 * 10 * 64; ///< King square x non-king piece x square.
+    static const int halfDimensions = 256;           ///< First layer outputs of each view.
+    static const int hiddenDimensions = 32;          ///< Outputs of each of the two hidden layers.
+
+    /**
+     * @struct Accumulator
+     * The first layer sums of both views, indexed by color (1 for white, 0 for black).
+     */
+    struct Accumulator {
+        std::int16_t values[2][halfDimensions];
+    };
+
+    /**
+     * Load a network file, replacing the network in use. Must not be called during a search.
+     *
+     * @param path The path of the network file.
+     * @return True if the file was read, on failure the previous network stays in use.
+     */
+    static bool load(const std::string& path);
+
+    /**
+     * Check if a network is loaded.
+     *
+     * @return True if evaluate may be used.
+     */
+    static bool isLoaded();
+
+    /**
+     * Build both views of the accumulator from scratch.
+     *
+     * @param accumulator The accumulator to fill.
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     */
+    static void refresh(Accumulator& accumulator, const ChessBoard* board);
+
+    /**
+     * Derive the accumulator of the position after a move from the one before it.
+     *
+     * @param parent The accumulator of the position before the move.
+     * @param child Filled with the accumulator of the position after the move.
+     * @param board The position before the move.
+     * @param newBoard The position after the move.
+     * @param move The move that was made.
+     */
+    static void update(const Accumulator& parent, Accumulator& child, const ChessBoard* board, const ChessBoard* newBoard, const ChessMove& move);
+
+    /**
+     * Evaluate a position from its accumulator.
+     *
+     * @param accumulator The up to date accumulator of the position.
+     * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+     * @return The evaluation in centipawns, positive when currPlayer is ahead.
+     */
+    static int evaluate(const Accumulator& accumulator, bool currPlayer);
+
+private:
+    struct Network {
+        std::vector<std::int16_t> featureBiases;
+        std::vector<std::int16_t> featureWeights;
+        std::vector<std::int32_t> hidden1Biases;
+        std::vector<std::int8_t> hidden1Weights;
+        std::vector<std::int32_t> hidden2Biases;
+        std::vector<std::int8_t> hidden2Weights;
+        std::int32_t outputBias = 0;
+        std::vector<std::int8_t> outputWeights;
+    };
+
+    static int featureIndex(bool perspective, int kingSquare, ChessBoard::PieceType piece, int square);
+    static void refreshPerspective(Accumulator& accumulator, const ChessBoard* board, bool perspective);
+
+    static Network network;
+    static bool loaded;
+};
@@ -0,0 +1,127 @@
+/**
+ * @file OpeningBook.h
+ *
+ * Declaration of the OpeningBook class, opening moves read from a book file mapped into memory.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MoveGeneration.h"
+
+/**
+ * @class OpeningBook
+ *
+ * An opening book in the Polyglot file layout: an array of 16 byte entries sorted by position
+ * key, each a big endian uint64 key, uint16 move, uint16 weight and uint32 learn value. A move
+ * packs the to file and rank in bits 0 to 5 and the from file and rank in bits 6 to 11, files
+ * counted from a and ranks from 1. The positions are keyed by the Polyglot Zobrist key, so
+ * standard Polyglot books can be used, as far as their lines stay within the moves the engine plays.
+ *
+ * The file is memory mapped and a lookup is a binary search over it, so finding the moves of a
+ * position takes microseconds whatever the size of the book.
+ */
+class OpeningBook
+{
+public:
+    static const std::size_t entrySize = 16; ///< The bytes of an entry in the file.
+
+    /**
+     * @struct Entry
+     * A move of a position in the book.
+     */
+    struct Entry {
+        std::uint64_t key = 0;     ///< The position key.
+        ChessMove move;            ///< The move played from the position.
+        std::uint16_t weight = 0;  ///< How often to play the move relative to the others, 0 for never.
+        std::uint32_t learn = 0;   ///< Free for the book builder, for example game counts.
+    };
+
+    /**
+     * Map a book file, replacing the book in use.
+     *
+     * @param path The path of the book. An empty path or "<empty>" only closes the book in use.
+     * @return True if the book was mapped.
+     */
+    static bool open(const std::string& path);
+
+    /**
+     * Get the number of entries of the book in use.
+     *
+     * @return The number of entries, 0 when no book is open.
+     */
+    static std::size_t size();
+
+    /**
+     * Get the key a position is stored under, the Polyglot key.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+     * @return The position key.
+     */
+    static std::uint64_t positionKey(const ChessBoard* board, bool currPlayer);
+
+    /**
+     * Look up every book move of a position.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+     * @return The entries of the position, in the order of the file.
+     */
+    static std::vector<Entry> lookup(const ChessBoard* board, bool currPlayer);
+
+    /**
+     * Pick a book move of a position at random, weighted by the entries' weights. Moves that
+     * aren't legal in the position are never picked.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+     * @param move Set to the move picked.
+     * @return True if the book has a move for the position.
+     */
+    static bool pickMove(const ChessBoard* board, bool currPlayer, ChessMove& move);
+
+    /**
+     * Pack a move into the 16 bit form of a book entry.
+     *
+     * @param move The move.
+     * @return The packed move.
+     */
+    static std::uint16_t encodeMove(const ChessMove& move);
+
+    /**
+     * Unpack a move from the 16 bit form of a book entry.
+     *
+     * @param move The packed move.
+     * @return The move.
+     */
+    static ChessMove decodeMove(std::uint16_t move);
+
+    /**
+     * Write an entry in the file layout.
+     *
+     * @param entry The entry.
+     * @param bytes The entrySize bytes to write it to.
+     */
+    static void writeEntry(const Entry& entry, std::uint8_t* bytes);
+
+    /**
+     * Read an entry from the file layout.
+     *
+     * @param bytes The entrySize bytes of the entry.
+     * @return The entry.
+     */
+    static Entry readEntry(const std::uint8_t* bytes);
+
+private:
+    static MappedFile file;
+    static std::mt19937 random;
+};
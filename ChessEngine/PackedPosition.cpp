@@ -0,0 +1,396 @@
+/**
+ * @file PackedPosition.cpp
+ *
+ * Implementation of the PackedPosition struct and of the classes that read and write files of
+ * packed positions.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "PackedPosition.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "ChessData.h"
+#include "Engine.h"
+
+// The positions buffered by the reader and the writer.
+constexpr std::size_t BUFFER_POSITIONS = 4096;
+
+// The offsets of the fields of a packed position.
+constexpr std::size_t OCCUPANCY_OFFSET = 0;
+constexpr std::size_t PIECES_OFFSET = 8;
+constexpr std::size_t STATE_OFFSET = 24;
+constexpr std::size_t RESULT_OFFSET = 25;
+constexpr std::size_t SCORE_OFFSET = 26;
+constexpr std::size_t PLY_OFFSET = 28;
+
+const std::size_t PackedPosition::size;
+const int PackedPosition::maxScore;
+
+static std::uint64_t readLittleEndian(const std::uint8_t* bytes, int count) {
+    std::uint64_t value = 0;
+    for (int i = count - 1; i >= 0; i--) value = (value << 8) | bytes[i];
+    return value;
+}
+
+static void writeLittleEndian(std::uint8_t* bytes, std::uint64_t value, int count) {
+    for (int i = 0; i < count; i++) bytes[i] = static_cast<std::uint8_t>(value >> (8 * i));
+}
+
+/**
+ * Check that a board has one king of each colour, a position without them can't be searched.
+ */
+static bool hasBothKings(const ChessBoard& board) {
+    const std::uint64_t whiteKing = board.getPieceBitboard(ChessBoard::PieceType::WHITE_KING);
+    const std::uint64_t blackKing = board.getPieceBitboard(ChessBoard::PieceType::BLACK_KING);
+    return whiteKing != 0 && (whiteKing & (whiteKing - 1)) == 0 && blackKing != 0 && (blackKing & (blackKing - 1)) == 0;
+}
+
+
+/**
+ * Pack a position.
+ *
+ * @param board The board, its current player is the side to move.
+ * @param score The score in centipawns from the side to move's point of view, clamped to maxScore.
+ * @param result The result of the game.
+ * @param ply The ply of the game the position was played at.
+ * @param packed Set to the packed position.
+ * @return False if the board has more than 32 pieces or isn't one king of each colour.
+ */
+bool PackedPosition::pack(const ChessBoard& board, int score, GameResult result, int ply, PackedPosition& packed)
+{
+    packed = PackedPosition();
+    if (!hasBothKings(board)) return false;
+
+    const std::uint64_t occupancy = board.getAllPieces();
+    writeLittleEndian(packed.bytes + OCCUPANCY_OFFSET, occupancy, 8);
+
+    int piece = 0;
+    for (std::uint64_t squares = occupancy; squares != 0; squares &= squares - 1, piece++) {
+        if (piece == 32) return false;
+
+        const int square = data::bits::lowestSquare(squares);
+        const int type = static_cast<int>(board.getPieceTypeAtSquare(square / 8, square % 8));
+        packed.bytes[PIECES_OFFSET + piece / 2] |= static_cast<std::uint8_t>(type << (piece % 2 == 0 ? 0 : 4));
+    }
+
+    packed.bytes[STATE_OFFSET] = board.currPlayer ? 1 : 0;
+    packed.bytes[RESULT_OFFSET] = static_cast<std::uint8_t>(result);
+
+    const int clamped = std::max(-maxScore, std::min(score, maxScore));
+    writeLittleEndian(packed.bytes + SCORE_OFFSET, static_cast<std::uint16_t>(static_cast<std::int16_t>(clamped)), 2);
+    writeLittleEndian(packed.bytes + PLY_OFFSET, static_cast<std::uint16_t>(std::max(0, std::min(ply, 65535))), 2);
+    return true;
+}
+
+
+/**
+ * Unpack the board of the position.
+ *
+ * @param board Set to the board, with its current player set to the side to move.
+ * @return False if the position is malformed, more than 32 pieces, an unknown piece or not one
+ *         king of each colour.
+ */
+bool PackedPosition::unpack(ChessBoard& board) const
+{
+    board.clearBoard();
+    board.currPlayer = whiteToMove();
+
+    int piece = 0;
+    for (std::uint64_t squares = readLittleEndian(bytes + OCCUPANCY_OFFSET, 8); squares != 0; squares &= squares - 1, piece++) {
+        if (piece == 32) return false;
+
+        const int square = data::bits::lowestSquare(squares);
+        const int type = (bytes[PIECES_OFFSET + piece / 2] >> (piece % 2 == 0 ? 0 : 4)) & 0xF;
+        if (type > static_cast<int>(ChessBoard::PieceType::BLACK_KING)) return false;
+
+        board.setPiece(static_cast<ChessBoard::PieceType>(type), square / 8, square % 8);
+    }
+
+    return hasBothKings(board);
+}
+
+
+/**
+ * @return True if white is to move in the position.
+ */
+bool PackedPosition::whiteToMove() const
+{
+    return (bytes[STATE_OFFSET] & 1) != 0;
+}
+
+
+/**
+ * @return The score in centipawns from the side to move's point of view.
+ */
+int PackedPosition::score() const
+{
+    return static_cast<std::int16_t>(readLittleEndian(bytes + SCORE_OFFSET, 2));
+}
+
+
+/**
+ * @return The result of the game, UNKNOWN for a value that isn't a GameResult.
+ */
+PackedPosition::GameResult PackedPosition::result() const
+{
+    return bytes[RESULT_OFFSET] <= static_cast<std::uint8_t>(GameResult::UNKNOWN) ? static_cast<GameResult>(bytes[RESULT_OFFSET]) : GameResult::UNKNOWN;
+}
+
+
+/**
+ * @return The ply of the game the position was played at.
+ */
+int PackedPosition::ply() const
+{
+    return static_cast<int>(readLittleEndian(bytes + PLY_OFFSET, 2));
+}
+
+
+/**
+ * Find the value of an EPD operation, the text between its opcode and the semicolon that ends it.
+ */
+static bool findOperation(const std::string& line, const std::string& opcode, std::string& value)
+{
+    const std::size_t start = line.find(" " + opcode + " ");
+    if (start == std::string::npos) return false;
+
+    const std::size_t valueStart = start + opcode.size() + 2;
+    const std::size_t end = std::min(line.find(';', valueStart), line.size());
+    value = line.substr(valueStart, end - valueStart);
+    return true;
+}
+
+
+/**
+ * Read a FEN or EPD line. The EPD operations "ce" and "c9" are read as the score and the result,
+ * a FEN's full move number or the "fmvn" operation gives the ply.
+ *
+ * @param line The line.
+ * @param packed Set to the packed position.
+ * @return False if the line holds no position.
+ */
+bool PackedPosition::fromFen(const std::string& line, PackedPosition& packed)
+{
+    std::vector<std::string> fields;
+    std::size_t start = line.find_first_not_of(" \t\r");
+    while (start != std::string::npos && fields.size() < 6) {
+        const std::size_t end = std::min(line.find_first_of(" \t\r", start), line.size());
+        fields.push_back(line.substr(start, end - start));
+        start = line.find_first_not_of(" \t\r", end);
+    }
+    if (fields.empty()) return false;
+
+    ChessBoard board;
+    if (!Engine::loadFEN(&board, fields[0])) return false;
+    board.currPlayer = fields.size() < 2 || fields[1] != "b";
+
+    int score = 0;
+    GameResult result = GameResult::UNKNOWN;
+    int ply = 0;
+
+    std::string value;
+    try {
+        if (findOperation(line, "ce", value)) score = std::stoi(value);
+
+        // the full move number of a FEN, or of the fmvn operation of an EPD line, 1 without either
+        const bool fullMoveField = fields.size() == 6 && std::all_of(fields[5].begin(), fields[5].end(), [](char c) { return c >= '0' && c <= '9'; });
+        if (fullMoveField) value = fields[5];
+        else if (!findOperation(line, "fmvn", value)) value = "1";
+        ply = std::max(0, (std::stoi(value) - 1) * 2 + (board.currPlayer ? 0 : 1));
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+
+    if (findOperation(line, "c9", value)) {
+        if (value.find("1/2") != std::string::npos) result = GameResult::DRAW;
+        else if (value.find("1-0") != std::string::npos) result = GameResult::WHITE_WINS;
+        else if (value.find("0-1") != std::string::npos) result = GameResult::BLACK_WINS;
+    }
+
+    return pack(board, score, result, ply, packed);
+}
+
+
+/**
+ * Write the position as a FEN, without the score and result.
+ *
+ * @return The FEN, with the full move number of its ply.
+ */
+std::string PackedPosition::toFen() const
+{
+    ChessBoard board;
+    unpack(board);
+
+    // the engine writes "0 1" as the move counters, the full move number comes from the ply
+    const std::string fen = Engine::toFEN(board);
+    return fen.substr(0, fen.rfind(' ') + 1) + std::to_string(ply() / 2 + 1);
+}
+
+
+/**
+ * Write the position as an EPD line with the score, full move number and result as "ce", "fmvn"
+ * and "c9" operations, the operations fromFen reads back.
+ *
+ * @return The line, for example "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - ce 538; fmvn 31; c9 \"1-0\";".
+ */
+std::string PackedPosition::toEpd() const
+{
+    ChessBoard board;
+    unpack(board);
+
+    // the four position fields of the FEN, without its move counters
+    const std::string fen = Engine::toFEN(board);
+    std::string epd = fen.substr(0, fen.rfind(' ', fen.rfind(' ') - 1)) + " ce " + std::to_string(score()) + "; fmvn " + std::to_string(ply() / 2 + 1) + ";";
+
+    switch (result()) {
+    case GameResult::WHITE_WINS: epd += " c9 \"1-0\";"; break;
+    case GameResult::BLACK_WINS: epd += " c9 \"0-1\";"; break;
+    case GameResult::DRAW: epd += " c9 \"1/2-1/2\";"; break;
+    case GameResult::UNKNOWN: break;
+    }
+
+    return epd;
+}
+
+
+PackedWriter::~PackedWriter()
+{
+    close();
+}
+
+
+/**
+ * Create or truncate a file, or append to it.
+ *
+ * @param path The path of the file.
+ * @param append True to add to the positions already in the file.
+ * @return True if the file was opened.
+ */
+bool PackedWriter::open(const std::string& path, bool append)
+{
+    close();
+    file.open(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+    buffer.reserve(BUFFER_POSITIONS * PackedPosition::size);
+    return file.is_open();
+}
+
+
+/**
+ * Write a position, the buffer is written to the file once it is full.
+ *
+ * @param position The position.
+ * @return False once writing the file has failed.
+ */
+bool PackedWriter::write(const PackedPosition& position)
+{
+    buffer.insert(buffer.end(), position.bytes, position.bytes + PackedPosition::size);
+    if (buffer.size() >= BUFFER_POSITIONS * PackedPosition::size) return flush();
+    return static_cast<bool>(file);
+}
+
+
+/**
+ * Write the buffered positions to the file.
+ *
+ * @return False once writing the file has failed.
+ */
+bool PackedWriter::flush()
+{
+    if (!buffer.empty()) file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+
+/**
+ * Flush and close the file.
+ */
+void PackedWriter::close()
+{
+    if (!file.is_open()) return;
+    flush();
+    file.close();
+}
+
+
+/**
+ * Open a file of packed positions.
+ *
+ * @param path The path of the file.
+ * @return True if the file was opened.
+ */
+bool PackedReader::open(const std::string& path)
+{
+    file.close();
+    file.clear();
+    file.open(path, std::ios::binary);
+    buffer.clear();
+    next = 0;
+    return file.is_open();
+}
+
+
+/**
+ * Read the next position, refilling the buffer a block at a time. A trailing partial position
+ * is left out.
+ *
+ * @param position Set to the position.
+ * @return False at the end of the file.
+ */
+bool PackedReader::read(PackedPosition& position)
+{
+    if (next + PackedPosition::size > buffer.size()) {
+        buffer.resize(BUFFER_POSITIONS * PackedPosition::size);
+        file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        buffer.resize(static_cast<std::size_t>(file.gcount()));
+        next = 0;
+        if (buffer.size() < PackedPosition::size) return false;
+    }
+
+    std::memcpy(position.bytes, buffer.data() + next, PackedPosition::size);
+    next += PackedPosition::size;
+    return true;
+}
+
+
+/**
+ * Map a file of packed positions.
+ *
+ * @param path The path of the file.
+ * @return True if the file was mapped.
+ */
+bool PackedFile::open(const std::string& path)
+{
+    return file.open(path);
+}
+
+
+/**
+ * Get the number of positions of the file.
+ *
+ * @return The number of positions, 0 when none is mapped.
+ */
+std::size_t PackedFile::count() const
+{
+    return file.size() / PackedPosition::size;
+}
+
+
+/**
+ * Get a position.
+ *
+ * @param index The index of the position, below count().
+ * @return The position.
+ */
+PackedPosition PackedFile::at(std::size_t index) const
+{
+    PackedPosition position;
+    std::memcpy(position.bytes, file.data() + index * PackedPosition::size, PackedPosition::size);
+    return position;
+}
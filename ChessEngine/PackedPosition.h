@@ -0,0 +1,231 @@
+/**
+ * @file PackedPosition.h
+ *
+ * Declaration of the PackedPosition struct, a position with its score and game result in 32
+ * bytes, and of the classes that read and write files of them.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ChessBoard.h"
+#include "MappedFile.h"
+
+/**
+ * @struct PackedPosition
+ *
+ * A position in a fixed 32 bytes, for data sets of scored positions that are read without parsing
+ * text. All numbers are little endian:
+ *
+ * - bytes 0 to 7: the occupied squares, a bit per square as the engine numbers them, rank * 8 + 7 - file
+ * - bytes 8 to 23: the piece on every occupied square, in the order of the squares, 4 bits each as
+ *   the value of ChessBoard::PieceType, the first piece in the low half of byte 8
+ * - byte 24: bit 0 is set when white is to move, the other bits are 0
+ * - byte 25: the result of the game, a GameResult
+ * - bytes 26 and 27: the score in centipawns from the side to move's point of view, a signed number
+ *   clamped to +-32000, a mate is stored as +-32000
+ * - bytes 28 and 29: the ply of the game the position was played at
+ * - bytes 30 and 31: reserved, 0
+ *
+ * As the engine has no castling or en passant, there is nothing else to store.
+ */
+struct PackedPosition
+{
+    static const std::size_t size = 32; ///< The bytes of a position.
+    static const int maxScore = 32000;  ///< The largest score that can be stored, mates are stored as it.
+
+    /**
+     * The result of the game a position was played in, from white's point of view.
+     */
+    enum class GameResult : std::uint8_t {
+        BLACK_WINS = 0,
+        DRAW = 1,
+        WHITE_WINS = 2,
+        UNKNOWN = 3
+    };
+
+    std::uint8_t bytes[size] = {};
+
+    /**
+     * Pack a position.
+     *
+     * @param board The board, its current player is the side to move.
+     * @param score The score in centipawns from the side to move's point of view, clamped to maxScore.
+     * @param result The result of the game.
+     * @param ply The ply of the game the position was played at.
+     * @param packed Set to the packed position.
+     * @return False if the board has more than 32 pieces or isn't one king of each colour.
+     */
+    static bool pack(const ChessBoard& board, int score, GameResult result, int ply, PackedPosition& packed);
+
+    /**
+     * Unpack the board of the position.
+     *
+     * @param board Set to the board, with its current player set to the side to move.
+     * @return False if the position is malformed, more than 32 pieces, an unknown piece or not one
+     *         king of each colour.
+     */
+    bool unpack(ChessBoard& board) const;
+
+    /**
+     * @return True if white is to move in the position.
+     */
+    bool whiteToMove() const;
+
+    /**
+     * @return The score in centipawns from the side to move's point of view.
+     */
+    int score() const;
+
+    /**
+     * @return The result of the game, UNKNOWN for a value that isn't a GameResult.
+     */
+    GameResult result() const;
+
+    /**
+     * @return The ply of the game the position was played at.
+     */
+    int ply() const;
+
+    /**
+     * Read a FEN or EPD line. The EPD operations "ce" and "c9" are read as the score and the
+     * result, "ce 35; c9 \"1-0\";", and a FEN's full move number or the "fmvn" operation gives the ply.
+     *
+     * @param line The line.
+     * @param packed Set to the packed position.
+     * @return False if the line holds no position.
+     */
+    static bool fromFen(const std::string& line, PackedPosition& packed);
+
+    /**
+     * Write the position as a FEN, without the score and result.
+     *
+     * @return The FEN, with the full move number of its ply.
+     */
+    std::string toFen() const;
+
+    /**
+     * Write the position as an EPD line with the score, full move number and result as "ce",
+     * "fmvn" and "c9" operations.
+     *
+     * @return The line, for example "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - ce 538; fmvn 31; c9 \"1-0\";".
+     */
+    std::string toEpd() const;
+};
+
+/**
+ * @class PackedWriter
+ *
+ * Writes packed positions to a file one after another, through a buffer of a few thousand
+ * positions so a generator can write them one at a time.
+ */
+class PackedWriter
+{
+public:
+    ~PackedWriter();
+
+    /**
+     * Create or truncate a file, or append to it.
+     *
+     * @param path The path of the file.
+     * @param append True to add to the positions already in the file.
+     * @return True if the file was opened.
+     */
+    bool open(const std::string& path, bool append = false);
+
+    /**
+     * Write a position.
+     *
+     * @return False once writing the file has failed.
+     */
+    bool write(const PackedPosition& position);
+
+    /**
+     * Write the buffered positions to the file.
+     *
+     * @return False once writing the file has failed.
+     */
+    bool flush();
+
+    /**
+     * Flush and close the file.
+     */
+    void close();
+
+private:
+    std::ofstream file;
+    std::vector<std::uint8_t> buffer;
+};
+
+/**
+ * @class PackedReader
+ *
+ * Reads the positions of a file in order, a block at a time.
+ */
+class PackedReader
+{
+public:
+    /**
+     * Open a file of packed positions.
+     *
+     * @param path The path of the file.
+     * @return True if the file was opened.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Read the next position.
+     *
+     * @param position Set to the position.
+     * @return False at the end of the file.
+     */
+    bool read(PackedPosition& position);
+
+private:
+    std::ifstream file;
+    std::vector<std::uint8_t> buffer;
+    std::size_t next = 0; ///< The offset of the next position in the buffer.
+};
+
+/**
+ * @class PackedFile
+ *
+ * Random access to the positions of a file, memory mapped so only the pages read are loaded and
+ * any number of processes share them.
+ */
+class PackedFile
+{
+public:
+    /**
+     * Map a file of packed positions, a trailing partial position is left out.
+     *
+     * @param path The path of the file.
+     * @return True if the file was mapped.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Get the number of positions of the file.
+     *
+     * @return The number of positions, 0 when none is mapped.
+     */
+    std::size_t count() const;
+
+    /**
+     * Get a position.
+     *
+     * @param index The index of the position, below count().
+     * @return The position.
+     */
+    PackedPosition at(std::size_t index) const;
+
+private:
+    MappedFile file;
+};
@@ -0,0 +1,111 @@
+/**
+ * @file PawnTable.cpp
+ *
+ * Implementation of the pawn structure evaluation and the table caching it.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "PawnTable.h"
+#include "ChessData.h"
+
+// Pawn structure terms in centipawns.
+constexpr int DOUBLED_PAWN_PENALTY = 15;
+constexpr int ISOLATED_PAWN_PENALTY = 15;
+constexpr int BACKWARD_PAWN_PENALTY = 10;
+
+// Passed pawn bonus by rank, counted from the side's own back rank.
+constexpr int PASSED_PAWN_BONUS[8] = { 0, 5, 10, 20, 35, 60, 100, 0 };
+
+
+/**
+ * Create an empty table. An empty entry has key 0, which is also the key of a board without
+ * pawns, and its zero score and masks are exactly that board's evaluation.
+ *
+ * @param entryCount The number of entries, a power of two.
+ */
+PawnTable::PawnTable(std::size_t entryCount) : entries(entryCount), indexMask(entryCount - 1)
+{
+}
+
+
+/**
+ * Get the evaluation of the board's pawn structure, evaluating and storing it on a miss.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param hit Set to true if the structure was found in the table.
+ * @return The entry of the structure, valid until the next probe.
+ */
+const PawnEntry& PawnTable::probe(const ChessBoard* board, bool& hit)
+{
+    PawnEntry& entry = entries[board->pawnHash & indexMask];
+    hit = entry.key == board->pawnHash;
+    if (!hit) entry = evaluate(board);
+    return entry;
+}
+
+
+/**
+ * Evaluate the pawn structure of a board without the table. A pawn is doubled when another pawn
+ * of its side stands ahead of it on its file, isolated when its side has no pawns on the adjacent
+ * files, backward when the pawns on the adjacent files are all ahead of it and an enemy pawn
+ * guards the square in front of it, and passed when no enemy pawn can stop or capture it.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @return The evaluated entry.
+ */
+PawnEntry PawnTable::evaluate(const ChessBoard* board)
+{
+    using namespace data::masks;
+
+    PawnEntry entry;
+    entry.key = board->pawnHash;
+
+    const std::uint64_t hFile = fileMask[0];
+    const std::uint64_t aFile = fileMask[7];
+
+    for (int color = 0; color < 2; color++) {
+        const bool isWhite = color == 1;
+        const std::uint64_t pawns = isWhite ? board->whitePawns : board->blackPawns;
+        const std::uint64_t enemyPawns = isWhite ? board->blackPawns : board->whitePawns;
+
+        // squares the enemy pawns attack right now
+        const std::uint64_t enemyAttacks = isWhite
+            ? ((enemyPawns & ~hFile) >> 9) | ((enemyPawns & ~aFile) >> 7)
+            : ((enemyPawns & ~hFile) << 7) | ((enemyPawns & ~aFile) << 9);
+
+        int score = 0;
+
+        for (int square = 0; square < 64; square++) {
+            if (((pawns >> square) & 1) == 0) continue;
+
+            const int file = square % 8;
+            const int relativeRank = isWhite ? square / 8 : 7 - square / 8;
+            const bool isDoubled = (pawnMasks.forwardFile[color][square] & pawns) != 0;
+            const bool isIsolated = (adjacentFileMask[file] & pawns) == 0;
+
+            entry.attackSpans[color] |= pawnMasks.attackSpan[color][square];
+
+            if (isDoubled) score -= DOUBLED_PAWN_PENALTY;
+            if (isIsolated) score -= ISOLATED_PAWN_PENALTY;
+
+            // only the front pawn of a doubled pair can be passed
+            if (!isDoubled && (pawnMasks.passedPawn[color][square] & enemyPawns) == 0) {
+                entry.passedPawns[color] |= (std::uint64_t)1 << square;
+                score += PASSED_PAWN_BONUS[relativeRank];
+            }
+
+            const std::uint64_t supportSquares = adjacentFileMask[file] & ~pawnMasks.attackSpan[color][square];
+            const int stopSquare = isWhite ? square + 8 : square - 8;
+            if (!isIsolated && (supportSquares & pawns) == 0 && stopSquare >= 0 && stopSquare < 64
+                && ((enemyAttacks >> stopSquare) & 1) != 0) {
+                score -= BACKWARD_PAWN_PENALTY;
+            }
+        }
+
+        entry.score += isWhite ? score : -score;
+    }
+
+    return entry;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file PawnTable.h
+ *
+ * Declaration of the PawnTable class, a cache of the pawn structure evaluation keyed by the
+ * pawn hash of the position.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ChessBoard.h"
+
+/**
+ * @struct PawnEntry
+ *
+ * The evaluation of a pawn structure and the masks derived from it, indexed by color with
+ * 1 for white and 0 for black.
+ */
+struct PawnEntry
+{
+    std::uint64_t key = 0;              ///< The pawn hash of the structure.
+    int score = 0;                      ///< Doubled, isolated, backward and passed pawn terms, from white's point of view.
+    std::uint64_t passedPawns[2] = {};  ///< Each side's passed pawns.
+    std::uint64_t attackSpans[2] = {};  ///< Every square each side's pawns could ever attack.
+};
+
+/**
+ * @class PawnTable
+ *
+ * A direct mapped table of pawn structure evaluations. The pawns move in only a few of the moves
+ * searched, so most nodes find their structure here and only pay for the king and piece terms
+ * that depend on it. Each search thread owns a table, so it needs no locking.
+ */
+class PawnTable
+{
+public:
+    /**
+     * Create an empty table.
+     *
+     * @param entryCount The number of entries, a power of two.
+     */
+    explicit PawnTable(std::size_t entryCount = 8192);
+
+    /**
+     * Get the evaluation of the board's pawn structure, evaluating and storing it on a miss.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param hit Set to true if the structure was found in the table.
+     * @return The entry of the structure, valid until the next probe.
+     */
+    const PawnEntry& probe(const ChessBoard* board, bool& hit);
+
+    /**
+     * Evaluate the pawn structure of a board without the table.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @return The evaluated entry.
+     */
+    static PawnEntry evaluate(const ChessBoard* board);
+
+private:
+    std::vector<PawnEntry> entries;
+    std::size_t indexMask;
+};
@@ -0,0 +1,391 @@
+/**
+ * @file Server.cpp
+ *
+ * Implementation of the SessionServer class, sessions, the search queue and its scheduler.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "Server.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+/**
+ * Serve the sessions until quit or the end of the input.
+ *
+ * @param input The stream to read the commands from.
+ * @return The exit code of the process.
+ */
+int SessionServer::run(std::istream& input)
+{
+    scheduler = std::thread(&SessionServer::schedule, this);
+
+    std::string line;
+    bool quit = false;
+    while (!quit && std::getline(input, line))
+    {
+        // a line for a session starts with its id, anything that doesn't name a command
+        const std::size_t idStart = line.find_first_not_of(" \t\r");
+        if (idStart == std::string::npos) continue;
+        const std::size_t idEnd = std::min(line.find_first_of(" \t\r", idStart), line.size());
+        const std::string id = line.substr(idStart, idEnd - idStart);
+
+        if (commands::parseCommand(id).type == commands::CommandType::NONE) handleSession(id, commands::parseCommand(line.substr(idEnd)));
+        else quit = !handleServer(commands::parseCommand(line));
+    }
+
+    std::shared_ptr<SearchRequest> unlimited;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+
+        if (quit) {
+            queue.clear();
+            unlimited = running;
+        }
+        else {
+            // nothing can stop a search without limits any more, give it one
+            for (const std::shared_ptr<SearchRequest>& request : queue) {
+                if (request->limits.infinite || request->limits.ponder) {
+                    request->limits = SearchLimits();
+                    request->limits.depth = 1;
+                }
+            }
+            if (running && (running->limits.infinite || running->limits.ponder)) unlimited = running;
+        }
+    }
+    wake.notify_all();
+
+    if (unlimited) stopStarted(unlimited);
+
+    scheduler.join();
+    return 0;
+}
+
+
+/**
+ * Handle a line for a session, creating the session if it is new.
+ *
+ * @param id The id of the session.
+ * @param command The command of the line.
+ */
+void SessionServer::handleSession(const std::string& id, const commands::Command& command)
+{
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<Session>& entry = sessions[id];
+        if (!entry) {
+            entry = std::make_shared<Session>();
+            entry->id = id;
+        }
+        session = entry;
+    }
+
+    switch (command.type) {
+    case commands::CommandType::POSITION: {
+        std::string fen;
+        std::vector<std::string> moves;
+        if (!commands::parsePosition(command.args, fen, moves)) break;
+
+        std::size_t illegalMove = 0;
+        const Engine::PositionStatus status = session->engine.setPosition(fen, moves, &illegalMove);
+        if (status == Engine::PositionStatus::INVALID_FEN) print(*session, "info string invalid fen " + fen.substr(0, fen.find(' ')));
+        else if (status == Engine::PositionStatus::ILLEGAL_MOVE) print(*session, "info string illegal move " + moves[illegalMove]);
+        break;
+    }
+
+    case commands::CommandType::GO: queueSearch(session, command.args); break;
+    case commands::CommandType::STOP: stopSearch(session); break;
+    case commands::CommandType::PONDERHIT: ponderHit(session); break;
+    case commands::CommandType::ISREADY: print(*session, "readyok"); break;
+
+    case commands::CommandType::UCINEWGAME:
+        session->engine.setPosition(Engine::startFen, std::vector<std::string>());
+        break;
+
+    case commands::CommandType::SETOPTION: {
+        // only Hash is the session's own, "name Hash value N"
+        if (command.args.size() != 4 || command.args[0] != "name" || command.args[2] != "value") break;
+
+        std::string name = command.args[1];
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+        if (name != "hash") {
+            print(*session, "info string only Hash is a session option");
+            break;
+        }
+
+        int megabytes = 0;
+        try {
+            megabytes = std::max(0, std::min(std::stoi(command.args[3]), 65536));
+        }
+        catch (const std::exception&) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (session->pending || session->tableInUse) {
+            print(*session, "info string Hash can't change while the session searches");
+            break;
+        }
+
+        if (megabytes == 0) session->table.reset();
+        else session->table.reset(new TranspositionTable(static_cast<std::size_t>(megabytes)));
+        print(*session, "info string " + (session->table ? session->table->memoryReport() : "shared hash"));
+        break;
+    }
+
+    case commands::CommandType::QUIT: {
+        stopSearch(session);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        sessions.erase(id);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+
+/**
+ * Handle a line for the whole server. The options are the process wide ones of the command
+ * line front end, changing one stops the running search first.
+ *
+ * @param command The command of the line.
+ * @return False once the server has to quit.
+ */
+bool SessionServer::handleServer(const commands::Command& command)
+{
+    switch (command.type) {
+    case commands::CommandType::UCI: commands::uci_uci(); break;
+    case commands::CommandType::ISREADY: commands::uci_isready(); break;
+    case commands::CommandType::QUIT: return false;
+
+    case commands::CommandType::SETOPTION: {
+        stopRunning();
+
+        // the scheduler can't start another search until the option is set
+        std::lock_guard<std::mutex> pool(poolMutex);
+        commands::uci_setOption(command.args);
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    return true;
+}
+
+
+/**
+ * Queue a search of a session, refused while the session has one waiting or running. The search
+ * gets a copy of the session's engine, so the session can set up its next position while it waits.
+ *
+ * @param session The session.
+ * @param args The arguments of its "go" command.
+ */
+void SessionServer::queueSearch(const std::shared_ptr<Session>& session, const std::vector<std::string>& args)
+{
+    std::shared_ptr<SearchRequest> request = std::make_shared<SearchRequest>();
+    request->session = session;
+    request->engine.reset(new Engine(session->engine));
+    request->isWhite = request->engine->getBoard().currPlayer;
+    request->limits = commands::parseGo(args, request->isWhite);
+    request->queued = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (session->pending) {
+            print(*session, "info string a search is already running");
+            return;
+        }
+
+        session->pending = true;
+        queue.push_back(request);
+    }
+    wake.notify_one();
+}
+
+
+/**
+ * End the search of a session. A waiting one is turned into a one ply search and moved to the
+ * front of the queue, so the session gets its bestmove straight away. Either way the session
+ * can ask for its next search at once.
+ *
+ * @param session The session.
+ */
+void SessionServer::stopSearch(const std::shared_ptr<Session>& session)
+{
+    std::shared_ptr<SearchRequest> started;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!session->pending) return;
+        session->pending = false;
+
+        if (running && running->session == session && !running->stopped) {
+            running->stopped = true;
+            started = running;
+        }
+        else {
+            for (auto request = queue.begin(); request != queue.end(); ++request) {
+                if ((*request)->session != session || (*request)->stopped) continue;
+
+                std::shared_ptr<SearchRequest> stopped = *request;
+                stopped->stopped = true;
+                stopped->limits = SearchLimits();
+                stopped->limits.depth = 1;
+
+                queue.erase(request);
+                queue.push_front(stopped);
+                break;
+            }
+        }
+    }
+
+    if (started) stopStarted(started);
+}
+
+
+/**
+ * Turn the ponder search of a session into a normal search, one still waiting is started as a
+ * normal search.
+ *
+ * @param session The session.
+ */
+void SessionServer::ponderHit(const std::shared_ptr<Session>& session)
+{
+    std::shared_ptr<SearchRequest> started;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running && running->session == session && !running->stopped) started = running;
+
+        for (const std::shared_ptr<SearchRequest>& request : queue) {
+            if (request->session == session) request->limits.ponder = false;
+        }
+    }
+
+    if (!started) return;
+
+    // the search was picked, wait for it to start before it can be told
+    while (!started->engine->isSearching()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (running != started) return;
+        }
+        std::this_thread::yield();
+    }
+    started->engine->ponderHit();
+}
+
+
+/**
+ * Stop whichever search is running.
+ */
+void SessionServer::stopRunning()
+{
+    std::shared_ptr<SearchRequest> started;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        started = running;
+        if (started && !started->stopped) {
+            started->stopped = true;
+            started->session->pending = false;
+        }
+    }
+
+    if (started) stopStarted(started);
+}
+
+
+/**
+ * Stop a running search. It may have been picked but not started yet, the engine only sees the
+ * stop once it searches, so wait for that unless the search is already over.
+ *
+ * @param request The search.
+ */
+void SessionServer::stopStarted(const std::shared_ptr<SearchRequest>& request)
+{
+    while (!request->engine->isSearching()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (running != request) return;
+        }
+        std::this_thread::yield();
+    }
+    request->engine->stop();
+}
+
+
+/**
+ * The scheduler thread. Takes the oldest waiting search, charges it the time it waited and runs
+ * it with the session's table, until the server closes and the queue is empty.
+ */
+void SessionServer::schedule()
+{
+    for (;;) {
+        std::shared_ptr<SearchRequest> request;
+        SearchLimits limits;
+        TranspositionTable* table = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return closing || !queue.empty(); });
+            if (queue.empty()) return;
+
+            request = queue.front();
+            queue.pop_front();
+            running = request;
+            limits = request->limits;
+
+            // a stopped search no longer keeps the session pending, this keeps its table until the search is done with it
+            table = request->session->table.get();
+            request->session->tableInUse = true;
+        }
+
+        Session& session = *request->session;
+
+        // the time a search waited is part of its budget, a ponder search's only starts at ponderhit
+        const std::int64_t waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - request->queued).count();
+        if (limits.moveTime > 0 && !limits.ponder) {
+            limits.moveTime = static_cast<int>(std::max<std::int64_t>(1, limits.moveTime - waited));
+        }
+
+        SearchResult result;
+        {
+            std::lock_guard<std::mutex> pool(poolMutex);
+
+            if (table) request->engine->setTable(*table);
+            result = request->engine->search(limits, request->isWhite, [&session](const SearchInfo& info) {
+                print(session, commands::formatInfo(info));
+            });
+        }
+
+        // the session is free before its bestmove goes out, so a client may answer it at once
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!request->stopped) session.pending = false;
+            session.tableInUse = false;
+            running.reset();
+        }
+
+        std::string line = "bestmove " + Engine::moveToString(result.bestMove);
+        if (result.hasPonderMove) line += " ponder " + Engine::moveToString(result.ponderMove);
+        print(session, line);
+    }
+}
+
+
+/**
+ * Write a line of output of a session, prefixed by its id.
+ *
+ * @param session The session.
+ * @param line The line, without the id.
+ */
+void SessionServer::print(const Session& session, const std::string& line)
+{
+    commands::printLine(session.id + " " + line);
+}
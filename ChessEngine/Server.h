@@ -0,0 +1,137 @@
+/**
+ * @file Server.h
+ *
+ * Declaration of the SessionServer class, the front end that hosts many games in one process.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "Commands.h"
+#include "Engine.h"
+
+/**
+ * @class SessionServer
+ *
+ * Serves many independent games over one input and output stream, so a service needs a single
+ * engine process instead of one per game. Every line starts with the id of the session it is
+ * for, any token that isn't a command name, and the output of the session is written with the
+ * same id in front. A session is created by its first line and holds its own Engine, so its own
+ * position and game history. It understands position, go, stop, ponderhit, ucinewgame, isready,
+ * setoption name Hash and quit, which closes the session. Lines without an id are for the whole
+ * server: uci, isready, setoption and quit.
+ *
+ * The searches of all sessions share the search threads, the Threads option, and run one at a
+ * time in the order they were asked for, each session having at most one search waiting, so no
+ * session can hold back the others by asking more often. Time spent waiting counts against a
+ * search's movetime or clock, so a session gets the time it asked for measured from its go. By
+ * default the sessions share the transposition table, a session that sets its own Hash gets a
+ * table of that size to itself, which its searches use, and Hash 0 returns it to the shared one.
+ */
+class SessionServer
+{
+public:
+    /**
+     * Serve the sessions until quit or the end of the input. At the end of the input the searches
+     * still waiting are run, and the ones without limits stopped, before the server returns.
+     *
+     * @param input The stream to read the commands from.
+     * @return The exit code of the process.
+     */
+    int run(std::istream& input);
+
+private:
+    /**
+     * @struct Session
+     * A game hosted by the server.
+     */
+    struct Session {
+        std::string id;                           ///< The id the client gave the session.
+        Engine engine;                            ///< The position and game history of the session.
+        std::unique_ptr<TranspositionTable> table; ///< The session's own table, null when it uses the shared one.
+        bool pending = false;                     ///< True while a search of the session waits or runs and wasn't stopped.
+        bool tableInUse = false;                  ///< True while a search of the session uses its table, stopped or not.
+    };
+
+    /**
+     * @struct SearchRequest
+     * A search a session asked for, waiting or running.
+     */
+    struct SearchRequest {
+        std::shared_ptr<Session> session;
+        std::unique_ptr<Engine> engine;  ///< A copy of the session's engine, the position as it was at the go.
+        SearchLimits limits;
+        bool isWhite = true;
+        bool stopped = false;            ///< Set by stop, the session may then ask for its next search.
+        std::chrono::steady_clock::time_point queued; ///< When the session sent its go.
+    };
+
+    /**
+     * Handle a line for a session, creating the session if it is new.
+     */
+    void handleSession(const std::string& id, const commands::Command& command);
+
+    /**
+     * Handle a line for the whole server.
+     *
+     * @return False once the server has to quit.
+     */
+    bool handleServer(const commands::Command& command);
+
+    /**
+     * Queue a search of a session, refused while the session has one waiting or running.
+     */
+    void queueSearch(const std::shared_ptr<Session>& session, const std::vector<std::string>& args);
+
+    /**
+     * End the search of a session, a waiting one is turned into a one ply search so the session
+     * still gets its bestmove straight away.
+     */
+    void stopSearch(const std::shared_ptr<Session>& session);
+
+    /**
+     * Turn the ponder search of a session into a normal search.
+     */
+    void ponderHit(const std::shared_ptr<Session>& session);
+
+    /**
+     * Stop whichever search is running, for the changes that must not happen under one.
+     */
+    void stopRunning();
+
+    /**
+     * Stop a running search once it has started. Called without the lock held.
+     */
+    void stopStarted(const std::shared_ptr<SearchRequest>& request);
+
+    /**
+     * The scheduler thread, runs the waiting searches one after another until the server closes.
+     */
+    void schedule();
+
+    /**
+     * Write a line of output of a session, prefixed by its id.
+     */
+    static void print(const Session& session, const std::string& line);
+
+    std::mutex mutex;                   ///< Guards the sessions, the queue and the running session.
+    std::condition_variable wake;       ///< Signalled when a search is queued or the server closes.
+    std::unordered_map<std::string, std::shared_ptr<Session>> sessions;
+    std::deque<std::shared_ptr<SearchRequest>> queue; ///< The searches waiting, oldest first.
+    std::shared_ptr<SearchRequest> running;           ///< The search running, null when none does.
+    bool closing = false;               ///< Set once no more searches will be queued.
+
+    std::mutex poolMutex;               ///< Held while a search uses the shared tables and threads.
+    std::thread scheduler;
+};
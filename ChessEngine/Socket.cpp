@@ -0,0 +1,231 @@
+/**
+ * @file Socket.cpp
+ *
+ * Implementation of the Socket class, the platform specific socket calls.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "Socket.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef SOCKET NativeSocket;
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NativeSocket;
+#endif
+
+// The handle of no socket, INVALID_SOCKET on Windows and -1 elsewhere.
+static const std::uintptr_t NO_SOCKET = ~static_cast<std::uintptr_t>(0);
+
+static NativeSocket native(std::uintptr_t handle) {
+    return static_cast<NativeSocket>(handle);
+}
+
+static void closeNative(std::uintptr_t handle) {
+#if defined(_WIN32)
+    closesocket(native(handle));
+#else
+    close(native(handle));
+#endif
+}
+
+
+/**
+ * Start Winsock the first time a socket is made, a no-op elsewhere.
+ */
+static void startSockets() {
+#if defined(_WIN32)
+    static const bool started = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    (void)started;
+#endif
+}
+
+
+/**
+ * Send the lines as soon as they are written, they are short and a search waits on each.
+ */
+static void disableNagle(std::uintptr_t handle) {
+    int enabled = 1;
+    setsockopt(native(handle), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+}
+
+
+Socket::Socket(std::uintptr_t handle)
+    : handle(handle)
+{
+}
+
+Socket::~Socket()
+{
+    closeNative(handle);
+}
+
+
+/**
+ * Listen for connections on a port of a local address, trying each address the name resolves to.
+ *
+ * @param address The local address, "127.0.0.1" for this machine only or "0.0.0.0" for every interface.
+ * @param port The port.
+ * @return The listening socket, null if the address and port couldn't be bound.
+ */
+std::unique_ptr<Socket> Socket::listen(const std::string& address, int port)
+{
+    startSockets();
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(address.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) return nullptr;
+
+    std::uintptr_t handle = NO_SOCKET;
+    for (const addrinfo* local = addresses; local != nullptr && handle == NO_SOCKET; local = local->ai_next) {
+        handle = static_cast<std::uintptr_t>(::socket(local->ai_family, local->ai_socktype, local->ai_protocol));
+        if (handle == NO_SOCKET) continue;
+
+        // a worker restarted straight after another may reuse its port
+        int reuse = 1;
+        setsockopt(native(handle), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+        if (::bind(native(handle), local->ai_addr, static_cast<int>(local->ai_addrlen)) != 0 || ::listen(native(handle), 4) != 0) {
+            closeNative(handle);
+            handle = NO_SOCKET;
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (handle == NO_SOCKET) return nullptr;
+    return std::unique_ptr<Socket>(new Socket(handle));
+}
+
+
+/**
+ * Wait for a connection to a listening socket.
+ *
+ * @return The connection, null if the socket was shut down.
+ */
+std::unique_ptr<Socket> Socket::accept()
+{
+    const std::uintptr_t connection = static_cast<std::uintptr_t>(::accept(native(handle), nullptr, nullptr));
+    if (connection == NO_SOCKET) return nullptr;
+
+    disableNagle(connection);
+    return std::unique_ptr<Socket>(new Socket(connection));
+}
+
+
+/**
+ * Connect to a listening socket of another process, trying each address the host resolves to.
+ *
+ * @param host The name or address of its machine.
+ * @param port Its port.
+ * @return The connection, null if it couldn't be made.
+ */
+std::unique_ptr<Socket> Socket::connect(const std::string& host, int port)
+{
+    startSockets();
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) return nullptr;
+
+    std::uintptr_t connection = NO_SOCKET;
+    for (const addrinfo* address = addresses; address != nullptr && connection == NO_SOCKET; address = address->ai_next) {
+        connection = static_cast<std::uintptr_t>(::socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+        if (connection == NO_SOCKET) continue;
+
+        if (::connect(native(connection), address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0) {
+            closeNative(connection);
+            connection = NO_SOCKET;
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (connection == NO_SOCKET) return nullptr;
+
+    disableNagle(connection);
+    return std::unique_ptr<Socket>(new Socket(connection));
+}
+
+
+/**
+ * Send a line, whole even when several threads send at once.
+ *
+ * @param line The line, without the line ending.
+ * @return False once the connection is closed.
+ */
+bool Socket::sendLine(const std::string& line)
+{
+    const std::string data = line + '\n';
+    std::lock_guard<std::mutex> lock(sendMutex);
+
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+#if defined(_WIN32)
+        const int count = ::send(native(handle), data.data() + sent, static_cast<int>(data.size() - sent), 0);
+#elif defined(MSG_NOSIGNAL)
+        const ssize_t count = ::send(native(handle), data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+#else
+        const ssize_t count = ::send(native(handle), data.data() + sent, data.size() - sent, 0);
+#endif
+        if (count <= 0) return false;
+        sent += static_cast<std::size_t>(count);
+    }
+
+    return true;
+}
+
+
+/**
+ * Wait for the next line. The bytes are read a block at a time and kept until their line is asked for.
+ *
+ * @param line Set to the line, without the line ending.
+ * @return False once the connection is closed.
+ */
+bool Socket::readLine(std::string& line)
+{
+    std::size_t end;
+    while ((end = received.find('\n')) == std::string::npos) {
+        char block[4096];
+        const int count = static_cast<int>(::recv(native(handle), block, sizeof(block), 0));
+        if (count <= 0) return false;
+        received.append(block, static_cast<std::size_t>(count));
+    }
+
+    line.assign(received, 0, end);
+    received.erase(0, end + 1);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+
+/**
+ * End the connection both ways, which wakes a thread waiting in readLine or accept. The handle
+ * stays open until the object is destroyed, so another thread never uses a closed one.
+ */
+void Socket::shutdown()
+{
+#if defined(_WIN32)
+    ::shutdown(native(handle), SD_BOTH);
+#else
+    ::shutdown(native(handle), SHUT_RDWR);
+#endif
+}
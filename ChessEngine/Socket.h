@@ -0,0 +1,84 @@
+/**
+ * @file Socket.h
+ *
+ * Declaration of the Socket class, a TCP connection carrying lines of text.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @class Socket
+ *
+ * A TCP socket, either listening for connections or connected to another process, with Winsock
+ * on Windows and BSD sockets elsewhere. A connection carries lines of text ending in '\n', the
+ * protocol of the cluster mode: one thread may read lines while others send them. The socket is
+ * closed when the object is destroyed. It can't be copied, so it is passed around in a unique_ptr.
+ */
+class Socket
+{
+public:
+    ~Socket();
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    /**
+     * Listen for connections on a port of a local address.
+     *
+     * @param address The local address, "127.0.0.1" for this machine only or "0.0.0.0" for every interface.
+     * @param port The port.
+     * @return The listening socket, null if the address and port couldn't be bound.
+     */
+    static std::unique_ptr<Socket> listen(const std::string& address, int port);
+
+    /**
+     * Wait for a connection to a listening socket.
+     *
+     * @return The connection, null if the socket was shut down.
+     */
+    std::unique_ptr<Socket> accept();
+
+    /**
+     * Connect to a listening socket of another process.
+     *
+     * @param host The name or address of its machine.
+     * @param port Its port.
+     * @return The connection, null if it couldn't be made.
+     */
+    static std::unique_ptr<Socket> connect(const std::string& host, int port);
+
+    /**
+     * Send a line, whole even when several threads send at once.
+     *
+     * @param line The line, without the line ending.
+     * @return False once the connection is closed.
+     */
+    bool sendLine(const std::string& line);
+
+    /**
+     * Wait for the next line.
+     *
+     * @param line Set to the line, without the line ending.
+     * @return False once the connection is closed.
+     */
+    bool readLine(std::string& line);
+
+    /**
+     * End the connection both ways, which wakes a thread waiting in readLine or accept.
+     */
+    void shutdown();
+
+private:
+    explicit Socket(std::uintptr_t handle);
+
+    std::uintptr_t handle;  ///< The SOCKET on Windows, the file descriptor elsewhere.
+    std::mutex sendMutex;   ///< Keeps the lines of different threads apart.
+    std::string received;   ///< Bytes read past the last line returned.
+};
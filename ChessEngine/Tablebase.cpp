@@ -0,0 +1,282 @@
+/**
+ * @file Tablebase.cpp
+ *
+ * Implementation of the Tablebase class, finding the tablebase files and probing them.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "Tablebase.h"
+#include "ChessData.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+constexpr char PATH_SEPARATOR = ';';
+#else
+constexpr char PATH_SEPARATOR = ':';
+#endif
+
+// The piece kinds besides the king in index order, per color with 1 for white and 0 for black.
+constexpr ChessBoard::PieceType TABLE_PIECES[2][5] = {
+    { ChessBoard::PieceType::BLACK_QUEEN, ChessBoard::PieceType::BLACK_ROOK, ChessBoard::PieceType::BLACK_BISHOP,
+      ChessBoard::PieceType::BLACK_KNIGHT, ChessBoard::PieceType::BLACK_PAWN },
+    { ChessBoard::PieceType::WHITE_QUEEN, ChessBoard::PieceType::WHITE_ROOK, ChessBoard::PieceType::WHITE_BISHOP,
+      ChessBoard::PieceType::WHITE_KNIGHT, ChessBoard::PieceType::WHITE_PAWN }
+};
+
+constexpr char PIECE_LETTERS[5] = { 'Q', 'R', 'B', 'N', 'P' };
+
+const int Tablebase::maxPieces;
+const std::uint32_t Tablebase::fileVersion;
+const std::size_t Tablebase::headerSize;
+const std::uint8_t Tablebase::drawValue;
+const std::uint8_t Tablebase::invalidValue;
+const std::uint8_t Tablebase::mateValueBase;
+
+std::unordered_map<std::uint64_t, MappedFile> Tablebase::tables;
+int Tablebase::largest = 0;
+
+
+/**
+ * Count the set bits of a bitboard.
+ */
+static int countBits(std::uint64_t bitboard) {
+    int count = 0;
+    for (; bitboard != 0; bitboard &= bitboard - 1) count++;
+    return count;
+}
+
+
+/**
+ * Pack the piece counts of a material combination into a key, four bits per piece kind with
+ * white's pieces in the low bits.
+ */
+static std::uint64_t keyOfCounts(const int counts[2][5]) {
+    std::uint64_t key = 0;
+    for (int kind = 0; kind < 5; kind++) {
+        key |= static_cast<std::uint64_t>(counts[1][kind]) << (4 * kind);
+        key |= static_cast<std::uint64_t>(counts[0][kind]) << (4 * (kind + 5));
+    }
+    return key;
+}
+
+
+/**
+ * Map the tablebase files found in one or more directories, replacing the tables in use. Every
+ * material combination of up to maxPieces pieces is looked for under its file name, and files
+ * with a wrong header or size are skipped.
+ *
+ * @param path The directories, separated by ';' on Windows and ':' elsewhere. An empty path
+ *             or "<empty>" only unmaps the tables in use.
+ * @return The number of tables mapped.
+ */
+int Tablebase::init(const std::string& path)
+{
+    unmapAll();
+    if (path.empty() || path == "<empty>") return 0;
+
+    std::vector<std::string> directories;
+    std::size_t start = 0;
+    while (start <= path.size()) {
+        const std::size_t end = std::min(path.find(PATH_SEPARATOR, start), path.size());
+        if (end > start) directories.push_back(path.substr(start, end - start));
+        start = end + 1;
+    }
+
+    // every combination of up to two pieces besides the kings, a piece being a color and a kind
+    std::vector<std::vector<int>> combinations = { {} };
+    for (int first = 0; first < 10; first++) {
+        combinations.push_back({ first });
+        for (int second = first; second < 10; second++) combinations.push_back({ first, second });
+    }
+
+    for (const std::vector<int>& pieces : combinations) {
+        int counts[2][5] = {};
+        for (int piece : pieces) counts[piece < 5 ? 1 : 0][piece % 5]++;
+
+        const int pieceCount = 2 + static_cast<int>(pieces.size());
+        const std::uint64_t key = keyOfCounts(counts);
+        if (tables.count(key) != 0) continue;
+
+        for (const std::string& directory : directories) {
+            MappedFile table;
+            if (!table.open(directory + "/" + fileName(counts)) || table.size() < headerSize) continue;
+
+            std::uint32_t header[4];
+            std::memcpy(header, table.data(), sizeof(header));
+            const bool isValid = std::memcmp(table.data(), "CETB", 4) == 0 && header[1] == fileVersion
+                && header[2] == static_cast<std::uint32_t>(pieceCount)
+                && table.size() == headerSize + 2 * positionsPerSide(pieceCount);
+
+            if (!isValid) continue;
+
+            tables[key] = std::move(table);
+            largest = std::max(largest, pieceCount);
+            break;
+        }
+    }
+
+    return static_cast<int>(tables.size());
+}
+
+
+/**
+ * Unmap every table in use.
+ */
+void Tablebase::unmapAll()
+{
+    tables.clear();
+    largest = 0;
+}
+
+
+/**
+ * Get the piece count of the largest table mapped.
+ *
+ * @return The piece count, kings included, or 0 when no table is mapped.
+ */
+int Tablebase::largestTable()
+{
+    return largest;
+}
+
+
+/**
+ * Look up the exact result of a position. A table with the colors the other way round is used
+ * through a flipped index, so KvKR positions are found in KRvK.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+ * @param wdl Set to 1 if the player to move wins, -1 if it loses and 0 for a draw.
+ * @param plies Set to the plies until mate with best play, 0 for a draw.
+ * @return True if the position is in a mapped table.
+ */
+bool Tablebase::probe(const ChessBoard* board, bool currPlayer, int& wdl, int& plies)
+{
+    if (largest == 0 || countBits(board->getAllPieces()) > largest) return false;
+    if (board->whiteKing == 0 || board->blackKing == 0) return false;
+
+    bool flipped = false;
+    auto table = tables.find(materialKey(board, false));
+    if (table == tables.end()) {
+        flipped = true;
+        table = tables.find(materialKey(board, true));
+        if (table == tables.end()) return false;
+    }
+
+    const std::uint8_t value = table->second.data()[headerSize + tableIndex(board, currPlayer, flipped)];
+    if (value == invalidValue) return false;
+
+    if (value == drawValue) {
+        wdl = 0;
+        plies = 0;
+        return true;
+    }
+
+    plies = value - mateValueBase;
+    wdl = plies % 2 == 1 ? 1 : -1;
+    return true;
+}
+
+
+/**
+ * Get the file name of a material combination.
+ *
+ * @param counts The number of queens, rooks, bishops, knights and pawns of each side,
+ *               indexed by color with 1 for white and 0 for black.
+ * @return The file name, for example "KRvKN.cetb".
+ */
+std::string Tablebase::fileName(const int counts[2][5])
+{
+    std::string name = "K";
+    for (int kind = 0; kind < 5; kind++) name.append(counts[1][kind], PIECE_LETTERS[kind]);
+    name += "vK";
+    for (int kind = 0; kind < 5; kind++) name.append(counts[0][kind], PIECE_LETTERS[kind]);
+    return name + ".cetb";
+}
+
+
+/**
+ * Get the number of positions a table holds for one side to move, 32 squares for the mirrored
+ * white king and 64 for every other piece.
+ *
+ * @param pieceCount The number of pieces, kings included.
+ * @return The number of positions.
+ */
+std::size_t Tablebase::positionsPerSide(int pieceCount)
+{
+    std::size_t positions = 32;
+    for (int piece = 1; piece < pieceCount; piece++) positions *= 64;
+    return positions;
+}
+
+
+/**
+ * Get the index of a position in its table. Flipping swaps the colors and the ranks, mirroring
+ * swaps the files, and both can change the order of the pieces of one kind, so those are sorted
+ * after the squares are transformed.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+ * @param flipped True if the table has the colors the other way round from the board.
+ * @return The index of the position, from the end of the header.
+ */
+std::size_t Tablebase::tableIndex(const ChessBoard* board, bool currPlayer, bool flipped)
+{
+    // the board's color playing white in the table
+    const int white = flipped ? 0 : 1;
+    const int flip = flipped ? 56 : 0;
+
+    int whiteKing = data::bits::lowestSquare(white == 1 ? board->whiteKing : board->blackKing) ^ flip;
+    const int blackKing = data::bits::lowestSquare(white == 1 ? board->blackKing : board->whiteKing) ^ flip;
+
+    // mirroring keeps the white king on the first four squares of its rank
+    const int transform = flip ^ (whiteKing % 8 >= 4 ? 7 : 0);
+    whiteKing ^= transform & 7;
+
+    std::size_t index = static_cast<std::size_t>((whiteKing / 8) * 4 + whiteKing % 8);
+    index = index * 64 + static_cast<std::size_t>(blackKing ^ (transform & 7));
+    int pieceCount = 2;
+
+    for (const int color : { white, 1 - white }) {
+        for (int kind = 0; kind < 5; kind++) {
+            int squares[maxPieces];
+            int count = 0;
+
+            std::uint64_t pieces = board->getPieceBitboard(TABLE_PIECES[color][kind]);
+            for (; pieces != 0 && count < maxPieces; pieces &= pieces - 1) {
+                squares[count++] = data::bits::lowestSquare(pieces) ^ transform;
+            }
+
+            std::sort(squares, squares + count);
+            for (int i = 0; i < count; i++) index = index * 64 + static_cast<std::size_t>(squares[i]);
+            pieceCount += count;
+        }
+    }
+
+    const bool whiteToMove = currPlayer != flipped;
+    return whiteToMove ? index : positionsPerSide(pieceCount) + index;
+}
+
+
+/**
+ * Pack the piece counts of a board into a material key.
+ *
+ * @param board A pointer to the ChessBoard object representing the current board state.
+ * @param flipped True to count the board's black pieces as white and the other way round.
+ * @return The key of the material combination.
+ */
+std::uint64_t Tablebase::materialKey(const ChessBoard* board, bool flipped)
+{
+    int counts[2][5];
+    for (int color = 0; color < 2; color++) {
+        for (int kind = 0; kind < 5; kind++) {
+            counts[flipped ? 1 - color : color][kind] = countBits(board->getPieceBitboard(TABLE_PIECES[color][kind]));
+        }
+    }
+    return keyOfCounts(counts);
+}
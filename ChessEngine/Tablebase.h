@@ -0,0 +1,112 @@
+/**
+ * @file Tablebase.h
+ *
+ * Declaration of the Tablebase class, exact endgame results read from tablebase files mapped
+ * into memory.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "ChessBoard.h"
+#include "MappedFile.h"
+
+/**
+ * @class Tablebase
+ *
+ * Endgame tablebases for positions of up to four pieces, kings included. A table covers one
+ * material combination and holds a byte for every position: 0 for a draw, 1 for a position that
+ * can't occur, and 2 + n when the side to move mates (n odd) or is mated (n even) n plies later
+ * with best play. The tables follow this engine's rules, where pawns don't promote and there is
+ * no castling or en passant, so they come from the engine's own generator.
+ *
+ * A file is named after its material, white first, for example KRvKN.cetb. It starts with a 16
+ * byte header, the "CETB" tag, a uint32 version of 1, the uint32 piece count and a uint32 of 0,
+ * followed by the positions with white to move and then those with black to move. Within a side
+ * to move the index is made of the squares of the white king, the black king and then the other
+ * pieces, white first, each side in the order queens, rooks, bishops, knights, pawns and pieces
+ * of one kind sorted by square. The board is mirrored left to right to keep the white king on the
+ * h to e files, which halves the table. Positions with the colors the other way round are probed
+ * through the same file with the board flipped.
+ *
+ * Files are memory mapped, so a probe reads a single byte and only the pages the search touches
+ * are ever loaded, shared by every search thread.
+ */
+class Tablebase
+{
+public:
+    static const int maxPieces = 4;                  ///< The most pieces, kings included, a table can hold.
+    static const std::uint32_t fileVersion = 1;      ///< The version written in the file header.
+    static const std::size_t headerSize = 16;        ///< The bytes in front of the positions.
+    static const std::uint8_t drawValue = 0;         ///< The value of a drawn position.
+    static const std::uint8_t invalidValue = 1;      ///< The value of a position that can't occur.
+    static const std::uint8_t mateValueBase = 2;     ///< Added to the plies until mate.
+
+    /**
+     * Map the tablebase files found in one or more directories, replacing the tables in use. Must
+     * not be called during a search.
+     *
+     * @param path The directories, separated by ';' on Windows and ':' elsewhere. An empty path
+     *             or "<empty>" only unmaps the tables in use.
+     * @return The number of tables mapped.
+     */
+    static int init(const std::string& path);
+
+    /**
+     * Get the piece count of the largest table mapped.
+     *
+     * @return The piece count, kings included, or 0 when no table is mapped.
+     */
+    static int largestTable();
+
+    /**
+     * Look up the exact result of a position.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+     * @param wdl Set to 1 if the player to move wins, -1 if it loses and 0 for a draw.
+     * @param plies Set to the plies until mate with best play, 0 for a draw.
+     * @return True if the position is in a mapped table.
+     */
+    static bool probe(const ChessBoard* board, bool currPlayer, int& wdl, int& plies);
+
+    /**
+     * Get the file name of a material combination.
+     *
+     * @param counts The number of queens, rooks, bishops, knights and pawns of each side,
+     *               indexed by color with 1 for white and 0 for black.
+     * @return The file name, for example "KRvKN.cetb".
+     */
+    static std::string fileName(const int counts[2][5]);
+
+    /**
+     * Get the number of positions a table holds for one side to move.
+     *
+     * @param pieceCount The number of pieces, kings included.
+     * @return The number of positions.
+     */
+    static std::size_t positionsPerSide(int pieceCount);
+
+    /**
+     * Get the index of a position in its table.
+     *
+     * @param board A pointer to the ChessBoard object representing the current board state.
+     * @param currPlayer A boolean indicating the player to move (true for white, false for black).
+     * @param flipped True if the table has the colors the other way round from the board.
+     * @return The index of the position, from the end of the header.
+     */
+    static std::size_t tableIndex(const ChessBoard* board, bool currPlayer, bool flipped);
+
+private:
+    static std::uint64_t materialKey(const ChessBoard* board, bool flipped);
+    static void unmapAll();
+
+    static std::unordered_map<std::uint64_t, MappedFile> tables;
+    static int largest;
+};
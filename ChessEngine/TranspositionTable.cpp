@@ -0,0 +1,374 @@
+/**
+ * @file TranspositionTable.cpp
+ *
+ * Implementation of the lock-free transposition table shared by the search threads.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A saved table starts with this tag, the version, the number of slots and the generation, and
+// then holds the two words of every slot, in the byte order of the machine that saved it.
+constexpr char FILE_TAG[4] = { 'C', 'E', 'T', 'T' };
+constexpr std::uint32_t FILE_VERSION = 1;
+
+// Slots are streamed through a buffer of this many at a time.
+constexpr std::size_t SLOTS_PER_BLOCK = 1 << 16;
+
+/**
+ * Create a table using the given amount of memory.
+ *
+ * @param megabytes The size of the table in megabytes, rounded down to a power of two entries.
+ */
+TranspositionTable::TranspositionTable(std::size_t megabytes)
+{
+    resize(megabytes);
+}
+
+/**
+ * Reallocate the table with a new size, all entries are lost. When the memory isn't there the
+ * table is halved until it fits, megabytes() tells the size it got.
+ *
+ * @param megabytes The size of the table in megabytes, rounded down to a power of two entries.
+ * @param threads The number of threads zeroing the new table.
+ * @param interleave True to spread the table over every NUMA node.
+ */
+void TranspositionTable::resize(std::size_t megabytes, int threads, bool interleave)
+{
+    const std::size_t bytes = std::max<std::size_t>(megabytes, 1) * 1024 * 1024;
+
+    // round down to a power of two so the index is a mask of the key
+    std::size_t count = 1;
+    while (count * 2 * sizeof(Slot) <= bytes) count *= 2;
+
+    // release the old table first, so both never have to fit in memory at once, and settle
+    // for a smaller table when the system can't give this much
+    memory.release();
+    while (!memory.allocate(count * sizeof(Slot), interleave)) {
+        if (count <= 1024) throw std::bad_alloc();
+        count /= 2;
+    }
+
+    slots = static_cast<Slot*>(memory.data());
+    entryCount = count;
+    indexMask = count - 1;
+    clear(threads);
+}
+
+/**
+ * Remove every entry from the table. Each thread zeroes a contiguous part, so on a fresh
+ * allocation the pages of that part are first touched, and placed, by that thread.
+ *
+ * @param threads The number of threads zeroing the table.
+ */
+void TranspositionTable::clear(int threads)
+{
+    const std::size_t parts = static_cast<std::size_t>(std::max(threads, 1));
+    const std::size_t partSize = (entryCount + parts - 1) / parts;
+
+    auto zero = [this](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; i++) {
+            slots[i].key.store(0, std::memory_order_relaxed);
+            slots[i].data.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t part = 1; part < parts; part++) {
+        const std::size_t first = std::min(part * partSize, entryCount);
+        workers.emplace_back(zero, first, std::min(first + partSize, entryCount));
+    }
+    zero(0, std::min(partSize, entryCount));
+    for (std::thread& worker : workers) worker.join();
+
+    generation = 0;
+}
+
+/**
+ * Start a new search, entries from older searches are replaced first.
+ */
+void TranspositionTable::newSearch()
+{
+    generation++;
+}
+
+/**
+ * Pack the contents of an entry into a single word.
+ * Bits 0-11 hold the move, 12-19 the depth, 20-21 the bound, 22-29 the generation and 32-63 the score.
+ */
+std::uint64_t TranspositionTable::pack(const ChessMove& move, int depth, Bound bound, std::uint8_t generation, int score)
+{
+    return static_cast<std::uint64_t>(move.fromSquare & 63)
+        | static_cast<std::uint64_t>(move.toSquare & 63) << 6
+        | static_cast<std::uint64_t>(std::min(std::max(depth, 0), 255)) << 12
+        | static_cast<std::uint64_t>(bound) << 20
+        | static_cast<std::uint64_t>(generation) << 22
+        | static_cast<std::uint64_t>(static_cast<std::uint32_t>(score)) << 32;
+}
+
+/**
+ * Unpack a word created by pack.
+ */
+TranspositionTable::Entry TranspositionTable::unpack(std::uint64_t data)
+{
+    Entry entry;
+    entry.move = ChessMove(data & 63, (data >> 6) & 63);
+    entry.depth = static_cast<int>((data >> 12) & 255);
+    entry.bound = static_cast<Bound>((data >> 20) & 3);
+    entry.score = static_cast<std::int32_t>(static_cast<std::uint32_t>(data >> 32));
+    return entry;
+}
+
+/**
+ * Look up a position in the table.
+ *
+ * @param key The Zobrist key of the position.
+ * @param entry Filled with the stored result when the position is found.
+ * @return True if the position was found.
+ */
+bool TranspositionTable::probe(std::uint64_t key, Entry& entry) const
+{
+    const Slot& slot = slots[key & indexMask];
+    const std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+    const std::uint64_t storedKey = slot.key.load(std::memory_order_relaxed);
+
+    // a torn or different entry won't decode to this key
+    if ((storedKey ^ data) != key || data == 0) return false;
+
+    entry = unpack(data);
+    return true;
+}
+
+/**
+ * Store the result of searching a position, unless the slot holds a more valuable entry.
+ * An entry of the same position is kept only if it was searched deeper, an entry of another
+ * position only if it is from the current search and was searched deeper.
+ *
+ * @param key The Zobrist key of the position.
+ * @param move The best move found.
+ * @param depth The depth the position was searched to.
+ * @param bound The kind of bound the score is.
+ * @param score The score of the position.
+ */
+void TranspositionTable::store(std::uint64_t key, const ChessMove& move, int depth, Bound bound, int score)
+{
+    Slot& slot = slots[key & indexMask];
+    const std::uint64_t oldData = slot.data.load(std::memory_order_relaxed);
+    const std::uint64_t oldKey = slot.key.load(std::memory_order_relaxed);
+
+    ChessMove storedMove = move;
+
+    if (oldData != 0) {
+        const Entry old = unpack(oldData);
+        const bool samePosition = (oldKey ^ oldData) == key;
+        const bool sameSearch = ((oldData >> 22) & 255) == generation;
+
+        if (samePosition && bound != Bound::EXACT && depth < old.depth - 2) return;
+        if (!samePosition && sameSearch && depth < old.depth) return;
+
+        // keep the old move when the new result didn't find one
+        if (samePosition && move.fromSquare == move.toSquare) storedMove = old.move;
+    }
+
+    const std::uint64_t data = pack(storedMove, depth, bound, generation, score);
+    slot.key.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+
+/**
+ * Estimate how full the table is from a sample of its entries, only entries written by
+ * the current search count.
+ *
+ * @return The fill rate in permille.
+ */
+int TranspositionTable::hashFull() const
+{
+    const std::size_t sample = std::min<std::size_t>(1000, entryCount);
+    std::size_t used = 0;
+
+    for (std::size_t i = 0; i < sample; i++) {
+        const std::uint64_t data = slots[i].data.load(std::memory_order_relaxed);
+        if (data != 0 && ((data >> 22) & 255) == generation) used++;
+    }
+
+    return static_cast<int>(used * 1000 / sample);
+}
+
+
+/**
+ * Get the memory the entries use.
+ *
+ * @return The size of the table in megabytes.
+ */
+std::size_t TranspositionTable::megabytes() const
+{
+    return entryCount * sizeof(Slot) / (1024 * 1024);
+}
+
+
+/**
+ * Exchange the entries, memory and generation with another table, in constant time.
+ *
+ * @param other The table to swap with.
+ */
+void TranspositionTable::swap(TranspositionTable& other) noexcept
+{
+    std::swap(memory, other.memory);
+    std::swap(slots, other.slots);
+    std::swap(entryCount, other.entryCount);
+    std::swap(indexMask, other.indexMask);
+    std::swap(generation, other.generation);
+}
+
+/**
+ * Describe the memory the table got, for example "hash 16 MB on transparent huge pages".
+ *
+ * @return The description.
+ */
+std::string TranspositionTable::memoryReport() const
+{
+    return "hash " + std::to_string(megabytes()) + " MB on " + memory.describe();
+}
+
+
+/**
+ * Collect the deepest entries, for example to share them with another process. Deep entries are
+ * rare, so the whole table is scanned and only the deepest maxCount are kept.
+ *
+ * @param minDepth The least depth of an entry to collect.
+ * @param maxCount The most entries to collect, the deepest are kept.
+ * @return The entries.
+ */
+std::vector<TranspositionTable::Record> TranspositionTable::collect(int minDepth, std::size_t maxCount) const
+{
+    std::vector<Record> records;
+
+    for (std::size_t i = 0; i < entryCount; i++) {
+        const std::uint64_t data = slots[i].data.load(std::memory_order_relaxed);
+        if (data == 0 || unpack(data).depth < minDepth) continue;
+
+        Record record;
+        record.key = slots[i].key.load(std::memory_order_relaxed) ^ data;
+        record.data = data;
+        records.push_back(record);
+    }
+
+    if (records.size() > maxCount) {
+        std::nth_element(records.begin(), records.begin() + maxCount, records.end(), [](const Record& a, const Record& b) {
+            return unpack(a.data).depth > unpack(b.data).depth;
+        });
+        records.resize(maxCount);
+    }
+
+    return records;
+}
+
+
+/**
+ * Store an entry collected from another table, under the usual replacement rules. It gets this
+ * table's generation, as if it had been searched here.
+ *
+ * @param record The entry.
+ */
+void TranspositionTable::merge(const Record& record)
+{
+    const Entry entry = unpack(record.data);
+    if (record.data == 0 || entry.bound == Bound::NONE) return;
+
+    store(record.key, entry.move, entry.depth, entry.bound, entry.score);
+}
+
+
+/**
+ * Write every entry to a file, so a later session can carry on from this one's results. The
+ * slots are written in order, a block at a time.
+ *
+ * @param path The path of the file.
+ * @return True if the file was written.
+ */
+bool TranspositionTable::save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    const std::uint64_t slotCount = entryCount;
+    const std::uint32_t savedGeneration = generation;
+    file.write(FILE_TAG, sizeof(FILE_TAG));
+    file.write(reinterpret_cast<const char*>(&FILE_VERSION), sizeof(FILE_VERSION));
+    file.write(reinterpret_cast<const char*>(&slotCount), sizeof(slotCount));
+    file.write(reinterpret_cast<const char*>(&savedGeneration), sizeof(savedGeneration));
+
+    std::vector<std::uint64_t> block(2 * SLOTS_PER_BLOCK);
+    for (std::size_t first = 0; first < entryCount && file; first += SLOTS_PER_BLOCK) {
+        const std::size_t count = std::min(SLOTS_PER_BLOCK, entryCount - first);
+        for (std::size_t i = 0; i < count; i++) {
+            block[2 * i] = slots[first + i].key.load(std::memory_order_relaxed);
+            block[2 * i + 1] = slots[first + i].data.load(std::memory_order_relaxed);
+        }
+        file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(count * 2 * sizeof(std::uint64_t)));
+    }
+
+    return static_cast<bool>(file);
+}
+
+/**
+ * Replace the entries with the ones saved in a file. Every saved entry is put in the slot of
+ * its key, so a file saved from a table of another size is rehashed into this one, keeping the
+ * deeper entry where two collide.
+ *
+ * @param path The path of the file.
+ * @return True if the file was read. The table is unchanged when the file or its header can't
+ *         be read, and left empty when its entries can't.
+ */
+bool TranspositionTable::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char tag[sizeof(FILE_TAG)];
+    std::uint32_t version = 0;
+    std::uint64_t slotCount = 0;
+    std::uint32_t savedGeneration = 0;
+    file.read(tag, sizeof(tag));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&slotCount), sizeof(slotCount));
+    file.read(reinterpret_cast<char*>(&savedGeneration), sizeof(savedGeneration));
+    if (!file || std::memcmp(tag, FILE_TAG, sizeof(tag)) != 0 || version != FILE_VERSION) return false;
+
+    clear();
+    generation = static_cast<std::uint8_t>(savedGeneration);
+
+    std::vector<std::uint64_t> block(2 * SLOTS_PER_BLOCK);
+    for (std::uint64_t first = 0; first < slotCount; first += SLOTS_PER_BLOCK) {
+        const std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(SLOTS_PER_BLOCK, slotCount - first));
+        if (!file.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(count * 2 * sizeof(std::uint64_t)))) {
+            clear();
+            return false;
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            const std::uint64_t storedKey = block[2 * i];
+            const std::uint64_t data = block[2 * i + 1];
+            if (data == 0) continue;
+
+            Slot& slot = slots[(storedKey ^ data) & indexMask];
+            const std::uint64_t oldData = slot.data.load(std::memory_order_relaxed);
+            if (oldData != 0 && unpack(oldData).depth >= unpack(data).depth) continue;
+
+            slot.key.store(storedKey, std::memory_order_relaxed);
+            slot.data.store(data, std::memory_order_relaxed);
+        }
+    }
+
+    return true;
+}
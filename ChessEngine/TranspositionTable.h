@@ -0,0 +1,202 @@
+/**
+ * @file TranspositionTable.h
+ *
+ * Declaration of the TranspositionTable class, a hash table of search results shared by
+ * every search thread. Entries are read and written without locks.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "LargeMemory.h"
+#include "MoveGeneration.h"
+
+/**
+ * @class TranspositionTable
+ *
+ * Caches the result of searching a position so that transpositions and later iterations of
+ * iterative deepening don't search it again. Every entry is two 64 bit words, the packed data
+ * and the position key XORed with that data. A reader only trusts an entry when the key it
+ * recovers matches, so a torn write from another thread looks like a miss instead of
+ * corrupting the search, and no locks are needed.
+ *
+ * The slots live in a LargeMemory block, on huge pages when the system grants them, and are
+ * zeroed by several threads at once so each part of the table is first touched, and placed, on
+ * the NUMA node of a thread that will probe it.
+ */
+class TranspositionTable
+{
+public:
+    /**
+     * The kind of bound a stored score is.
+     */
+    enum class Bound : std::uint8_t {
+        NONE = 0,
+        UPPER = 1, ///< The search failed low, the real score is at most this.
+        LOWER = 2, ///< The search failed high, the real score is at least this.
+        EXACT = 3  ///< The score is exact.
+    };
+
+    /**
+     * The unpacked contents of an entry.
+     */
+    struct Entry {
+        ChessMove move;
+        int score = 0;
+        int depth = 0;
+        Bound bound = Bound::NONE;
+    };
+
+    /**
+     * @struct Record
+     * An entry with its key, in the packed form the table holds it, for moving entries between tables.
+     */
+    struct Record {
+        std::uint64_t key = 0;
+        std::uint64_t data = 0;
+    };
+
+    /**
+     * Create a table using the given amount of memory.
+     *
+     * @param megabytes The size of the table in megabytes, rounded down to a power of two entries.
+     */
+    explicit TranspositionTable(std::size_t megabytes = 16);
+
+    /**
+     * Reallocate the table with a new size, all entries are lost.
+     *
+     * @param megabytes The size of the table in megabytes, rounded down to a power of two entries.
+     * @param threads The number of threads zeroing the new table.
+     * @param interleave True to spread the table over every NUMA node.
+     */
+    void resize(std::size_t megabytes, int threads = 1, bool interleave = false);
+
+    /**
+     * Remove every entry from the table.
+     *
+     * @param threads The number of threads zeroing the table, each zeroes a contiguous part.
+     */
+    void clear(int threads = 1);
+
+    /**
+     * Start a new search, entries from older searches are replaced first.
+     */
+    void newSearch();
+
+    /**
+     * Look up a position in the table.
+     *
+     * @param key The Zobrist key of the position.
+     * @param entry Filled with the stored result when the position is found.
+     * @return True if the position was found.
+     */
+    bool probe(std::uint64_t key, Entry& entry) const;
+
+    /**
+     * Store the result of searching a position, unless the slot holds a more valuable entry.
+     *
+     * @param key The Zobrist key of the position.
+     * @param move The best move found.
+     * @param depth The depth the position was searched to.
+     * @param bound The kind of bound the score is.
+     * @param score The score of the position.
+     */
+    void store(std::uint64_t key, const ChessMove& move, int depth, Bound bound, int score);
+
+    /**
+     * Get the number of entries the table holds.
+     *
+     * @return The number of entries.
+     */
+    std::size_t size() const { return entryCount; }
+
+    /**
+     * Get the memory the entries use.
+     *
+     * @return The size of the table in megabytes.
+     */
+    std::size_t megabytes() const;
+
+    /**
+     * Exchange the entries, memory and generation with another table, in constant time. Lets a
+     * caller give a search its own table by swapping it in before and out after. Must not be
+     * called during a search.
+     *
+     * @param other The table to swap with.
+     */
+    void swap(TranspositionTable& other) noexcept;
+
+    /**
+     * Describe the memory the table got, for example "hash 16 MB on transparent huge pages".
+     *
+     * @return The description.
+     */
+    std::string memoryReport() const;
+
+    /**
+     * Estimate how full the table is from a sample of its entries, only entries written by
+     * the current search count.
+     *
+     * @return The fill rate in permille.
+     */
+    int hashFull() const;
+
+    /**
+     * Collect the deepest entries, for example to share them with another process. Must not be
+     * called during a search.
+     *
+     * @param minDepth The least depth of an entry to collect.
+     * @param maxCount The most entries to collect, the deepest are kept.
+     * @return The entries.
+     */
+    std::vector<Record> collect(int minDepth, std::size_t maxCount) const;
+
+    /**
+     * Store an entry collected from another table, under the usual replacement rules.
+     *
+     * @param record The entry.
+     */
+    void merge(const Record& record);
+
+    /**
+     * Write every entry to a file, so a later session can carry on from this one's results.
+     * Must not be called during a search.
+     *
+     * @param path The path of the file.
+     * @return True if the file was written.
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * Replace the entries with the ones saved in a file. A file saved from a table of another
+     * size is rehashed into this one, keeping the deeper entry where two collide. Must not be
+     * called during a search.
+     *
+     * @param path The path of the file.
+     * @return True if the file was read. The table is unchanged when the file or its header can't
+     *         be read, and left empty when its entries can't.
+     */
+    bool load(const std::string& path);
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> key;
+        std::atomic<std::uint64_t> data;
+    };
+
+    static std::uint64_t pack(const ChessMove& move, int depth, Bound bound, std::uint8_t generation, int score);
+    static Entry unpack(std::uint64_t data);
+
+    LargeMemory memory;
+    Slot* slots = nullptr;
+    std::size_t entryCount = 0;
+    std::size_t indexMask = 0;
+    std::uint8_t generation = 0;
+};
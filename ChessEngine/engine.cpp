@@ -1,63 +1,86 @@
+#include <cstdlib>
 #include <iostream>
 #include <string>
-#include <regex>
-#include "ChessBoard.h"
+#include "BoardEvaluation.h"
+#include "Cluster.h"
 #include "Commands.h"
+#include "Engine.h"
+#include "MoveGeneration.h"
+#include "Server.h"
 
 
 
 
-int main() {
-    // Initialize a ChessBoard
-    ChessBoard gameBoard;
+int main(int argc, char* argv[]) {
+    // report what kind of pages the transposition table got
+    commands::printLine("info string " + BoardEvaluation::transpositionTable.memoryReport());
 
+    // a wrong slider lookup plays illegal moves, don't start with move tables that don't match the magics
+    if (!MoveGeneration::checkSliderTables()) {
+        commands::printLine("info string the slider move tables don't match their magic numbers");
+        return 1;
+    }
 
-    bool setup = false;
-
-    // handle command identification on this thread, handle command processing on a seperate thread.
-    while (true)
-    {
-
-        std::string command;
-        std::getline(std::cin, command);
-        
-        if (std::regex_match(command, commands::engine_displayCmd)) {
-            commands::engine_display(&gameBoard);
-        }
-
-        else if (std::regex_match(command, commands::uci_positionCmd)) {
-            commands::uci_position(&gameBoard, command);
-        }
-
-        else if (std::regex_match(command, commands::uci_uciCmd)) {
-            commands::uci_uci();
-        }
-
-        else if (std::regex_match(command, commands::uci_goCmd)) {
-            commands::uci_go(&gameBoard, command);
-        }
-
-        else if (std::regex_match(command, commands::engine_movesCmd)) {
-            commands::engine_moves(&gameBoard, command);
-        }
-
-        else if (std::regex_match(command, commands::engine_isCheckCmd)) {
-            commands::engine_isCheck(&gameBoard, command);
-        }
+    // "server" hosts many games at once, every line starts with the id of its game
+    if (argc > 1 && std::string(argv[1]) == "server") {
+        const int exitCode = SessionServer().run(std::cin);
+        commands::autoSaveHash();
+        return exitCode;
+    }
 
-        else if (std::regex_match(command, commands::engine_isMateCmd)) {
-            commands::engine_isMate(&gameBoard, command);
-        }
+    // "worker <port> [bind address] [option value]..." searches parts of the searches of a coordinator
+    // that connects to the port, the options are its own, such as EvalFile, which coordinators can't set
+    if (argc > 2 && std::string(argv[1]) == "worker") {
+        for (int i = 4; i + 1 < argc; i += 2) commands::uci_setOption({ "name", argv[i], "value", argv[i + 1] });
+        return Cluster::serve(argc > 3 ? argv[3] : "127.0.0.1", std::atoi(argv[2]));
+    }
 
-        else if (std::regex_match(command, commands::engine_pieceCmd)) {
-            commands::engine_piece(&gameBoard, command);
-        }
+    // The engine the commands drive, set up with the starting position
+    Engine engine;
 
-        else if (std::regex_match(command, commands::engine_moveCmd)) {
-            commands::engine_move(&gameBoard, command);
+    // handle command identification on this thread, searches run on a seperate thread so
+    // stop, ponderhit and isready are answered while the engine thinks.
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        const commands::Command command = commands::parseCommand(line);
+
+        switch (command.type) {
+        case commands::CommandType::QUIT:
+            commands::uci_stop();
+            commands::autoSaveHash();
+            return 0;
+
+        case commands::CommandType::STOP: commands::uci_stop(); break;
+        case commands::CommandType::PONDERHIT: commands::uci_ponderHit(); break;
+        case commands::CommandType::ISREADY: commands::uci_isready(); break;
+        case commands::CommandType::UCI: commands::uci_uci(); break;
+        case commands::CommandType::DEBUG: commands::uci_debug(command.args); break;
+        case commands::CommandType::UCINEWGAME: commands::uci_newGame(&engine); break;
+        case commands::CommandType::POSITION: commands::uci_position(&engine, command.args); break;
+        case commands::CommandType::GO: commands::uci_go(&engine, command.args); break;
+        case commands::CommandType::SETOPTION: commands::uci_setOption(command.args); break;
+
+        case commands::CommandType::DISPLAY: commands::engine_display(&engine); break;
+        case commands::CommandType::MOVES: commands::engine_moves(&engine, command.args); break;
+        case commands::CommandType::CHECK: commands::engine_isCheck(&engine, command.args); break;
+        case commands::CommandType::MATE: commands::engine_isMate(&engine, command.args); break;
+        case commands::CommandType::PIECE: commands::engine_piece(&engine, command.args); break;
+        case commands::CommandType::MOVE: commands::engine_move(&engine, command.args); break;
+        case commands::CommandType::TOGGLE: commands::engine_toggle(command.args); break;
+        case commands::CommandType::STATS: commands::engine_stats(&engine); break;
+        case commands::CommandType::SAVEHASH: commands::engine_saveHash(command.args); break;
+        case commands::CommandType::LOADHASH: commands::engine_loadHash(command.args); break;
+
+        // registration isn't needed, and unknown lines are ignored
+        case commands::CommandType::REGISTER:
+        case commands::CommandType::NONE:
+            break;
         }
-
     }
 
+    // end of input, let the last search finish
+    commands::finishSearch();
+    commands::autoSaveHash();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,361 @@
+/**
+ * @file Datagen.cpp
+ *
+ * A standalone tool that plays the engine against itself and writes the quiet positions of the
+ * games, with their search scores and the results of the games, as packed positions for training
+ * an evaluation. Every game starts from a few random moves and every position is searched to a
+ * fixed depth or node count.
+ *
+ * The games are played side by side by a pool of workers, each with an Engine and a table of its
+ * own. A game depends only on the seed and its number: each search runs on a single thread and
+ * the worker's table is cleared before every game, and the games are written in the order of
+ * their numbers, so the same arguments write the same file whatever the number of workers.
+ *
+ * Usage: Datagen <packed file> [name value]..., the names are listed by printUsage.
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "BoardEvaluation.h"
+#include "Engine.h"
+#include "MoveGeneration.h"
+#include "PackedPosition.h"
+
+// Seconds between progress reports, a run lasts hours.
+constexpr int PROGRESS_SECONDS = 60;
+
+// A game is adjudicated once the score has been past this many centipawns, for the same side, for
+// ADJUDICATE_PLIES plies in a row.
+constexpr int ADJUDICATE_SCORE = 2000;
+constexpr int ADJUDICATE_PLIES = 4;
+
+// Plies without a capture or pawn move that draw the game.
+constexpr int FIFTY_MOVE_PLIES = 100;
+
+// The workers start at most this many games per worker past the oldest game not yet written, so
+// one long game can't make the games waiting behind it pile up.
+constexpr std::uint64_t GAMES_AHEAD = 4;
+
+/**
+ * @struct Sample
+ * A position of a game kept for the file, written once the result of the game is known.
+ */
+struct Sample {
+    ChessBoard board;
+    int score = 0;
+    int ply = 0;
+};
+
+/**
+ * @struct Settings
+ * How the games are played.
+ */
+struct Settings {
+    std::uint64_t games = 1000;
+    SearchLimits limits;       ///< Depth 8 unless a depth or node count is given.
+    std::uint64_t seed = 1;
+    int randomPlies = 8;
+    int maxPlies = 400;
+    int hash = 16;             ///< Megabytes per worker, small as the table is cleared every game.
+    int workers = 0;           ///< Games played side by side, 0 for one per core.
+};
+
+/**
+ * @struct Generation
+ * The run shared by the workers: the next game to start and the games waiting for their turn to
+ * be written. Everything but the settings is guarded by the mutex.
+ */
+struct Generation {
+    Settings settings;
+    PackedWriter output;
+    std::string path;
+
+    std::uint64_t started = 0;      ///< The games handed to the workers, numbered from 0.
+    std::uint64_t written = 0;      ///< The number of the next game to write.
+    std::map<std::uint64_t, std::vector<PackedPosition>> waiting; ///< The games ahead of their turn, packed.
+    std::uint64_t positions = 0;
+    std::uint64_t results[3] = {};
+    bool failed = false;            ///< Set once the file couldn't be written, no more games are started.
+
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point lastReport;
+
+    std::mutex mutex;
+    std::condition_variable space;  ///< Signalled when games are written.
+};
+
+/**
+ * Play the random moves that open a game. A line that ends the game before it is over is thrown
+ * away and another is played.
+ *
+ * @param engine Set to the position after the random moves.
+ * @param moves Set to the moves.
+ * @param randomPlies The number of random moves.
+ * @param random The generator the moves are picked with.
+ */
+static void playOpening(Engine& engine, std::vector<std::string>& moves, int randomPlies, std::mt19937_64& random) {
+    for (;;) {
+        moves.clear();
+        engine.setPosition(Engine::startFen, moves);
+
+        int ply = 0;
+        for (; ply < randomPlies; ply++) {
+            const ChessBoard board = engine.getBoard();
+            const std::vector<ChessMove> legalMoves = MoveGeneration::generateColorsLegalMoves(&board, board.currPlayer);
+            if (legalMoves.empty()) break;
+
+            const ChessMove move = legalMoves[std::uniform_int_distribution<std::size_t>(0, legalMoves.size() - 1)(random)];
+            moves.push_back(Engine::moveToString(move));
+            engine.setPosition(Engine::startFen, moves);
+        }
+
+        if (ply == randomPlies) return;
+    }
+}
+
+/**
+ * Play a game and keep its quiet positions: those where the side to move isn't in check, the
+ * best move isn't a capture and the search didn't find a mate. Their scores are the search
+ * scores, from the side to move's point of view.
+ *
+ * @param settings How the game is played.
+ * @param game The index of the game, the random moves come from it and the seed.
+ * @param table The worker's transposition table.
+ * @param samples Set to the positions kept.
+ * @return The result of the game.
+ */
+static PackedPosition::GameResult playGame(const Settings& settings, std::uint64_t game, TranspositionTable& table, std::vector<Sample>& samples) {
+    std::seed_seq seeds{ static_cast<std::uint32_t>(settings.seed), static_cast<std::uint32_t>(settings.seed >> 32),
+                         static_cast<std::uint32_t>(game), static_cast<std::uint32_t>(game >> 32) };
+    std::mt19937_64 random(seeds);
+
+    // every game starts from an empty table and a new engine, so it doesn't depend on the games before it
+    table.clear();
+
+    Engine engine(table);
+    std::vector<std::string> moves;
+    playOpening(engine, moves, settings.randomPlies, random);
+
+    samples.clear();
+    std::unordered_map<std::uint64_t, int> repetitions;
+    int quietPlies = 0;
+    int winningPlies = 0;
+    int losingPlies = 0;
+
+    for (int ply = settings.randomPlies;; ply++) {
+        const ChessBoard board = engine.getBoard();
+        const bool white = board.currPlayer;
+
+        const std::vector<ChessMove> legalMoves = MoveGeneration::generateColorsLegalMoves(&board, white);
+        if (legalMoves.empty()) {
+            if (!MoveGeneration::isCheck(&board, white)) return PackedPosition::GameResult::DRAW;
+            return white ? PackedPosition::GameResult::BLACK_WINS : PackedPosition::GameResult::WHITE_WINS;
+        }
+
+        if (++repetitions[board.getPositionKey(white)] >= 3 || quietPlies >= FIFTY_MOVE_PLIES || ply >= settings.maxPlies) return PackedPosition::GameResult::DRAW;
+
+        // two bare kings, the only material the engine can't promote or mate with
+        if (board.getAllPieces() == (board.getPieceBitboard(ChessBoard::PieceType::WHITE_KING) | board.getPieceBitboard(ChessBoard::PieceType::BLACK_KING))) return PackedPosition::GameResult::DRAW;
+
+        const SearchResult result = engine.search(settings.limits);
+        const ChessMove move = result.bestMove;
+        const bool capture = board.getPieceTypeAtSquare(move.toSquare / 8, move.toSquare % 8) != ChessBoard::PieceType::EMPTY;
+
+        if (result.mateIn == 0 && !capture && !MoveGeneration::isCheck(&board, white)) {
+            Sample sample;
+            sample.board = board;
+            sample.score = result.score;
+            sample.ply = ply;
+            samples.push_back(sample);
+        }
+
+        // the score from white's point of view, adjudicated once it stays decisive
+        const int whiteScore = white ? result.score : -result.score;
+        winningPlies = whiteScore >= ADJUDICATE_SCORE ? winningPlies + 1 : 0;
+        losingPlies = whiteScore <= -ADJUDICATE_SCORE ? losingPlies + 1 : 0;
+        if (winningPlies >= ADJUDICATE_PLIES) return PackedPosition::GameResult::WHITE_WINS;
+        if (losingPlies >= ADJUDICATE_PLIES) return PackedPosition::GameResult::BLACK_WINS;
+
+        // a capture or pawn move can't be undone, no position before it repeats
+        const ChessBoard::PieceType piece = board.getPieceTypeAtSquare(move.fromSquare / 8, move.fromSquare % 8);
+        if (capture || piece == ChessBoard::PieceType::WHITE_PAWN || piece == ChessBoard::PieceType::BLACK_PAWN) {
+            quietPlies = 0;
+            repetitions.clear();
+        }
+        else {
+            quietPlies++;
+        }
+
+        moves.push_back(Engine::moveToString(move));
+        engine.setPosition(Engine::startFen, moves);
+    }
+}
+
+/**
+ * Write the games whose turn has come, in the order of their numbers.
+ *
+ * @param generation The run, its mutex held.
+ */
+static void writeInTurn(Generation& generation) {
+    while (!generation.failed && !generation.waiting.empty() && generation.waiting.begin()->first == generation.written) {
+        for (const PackedPosition& packed : generation.waiting.begin()->second) {
+            if (!generation.output.write(packed)) {
+                std::cerr << "could not write " << generation.path << std::endl;
+                generation.failed = true;
+                break;
+            }
+        }
+        generation.waiting.erase(generation.waiting.begin());
+        generation.written++;
+    }
+    generation.space.notify_all();
+}
+
+/**
+ * A worker, plays the games it takes in turn with its own table until every game is started.
+ *
+ * @param generation The run.
+ */
+static void generate(Generation& generation) {
+    const Settings& settings = generation.settings;
+    const std::uint64_t maxAhead = GAMES_AHEAD * static_cast<std::uint64_t>(settings.workers);
+
+    TranspositionTable table(static_cast<std::size_t>(settings.hash));
+    std::vector<Sample> samples;
+
+    for (;;) {
+        std::uint64_t game;
+        {
+            std::unique_lock<std::mutex> lock(generation.mutex);
+            generation.space.wait(lock, [&generation, maxAhead] { return generation.failed || generation.started - generation.written < maxAhead; });
+            if (generation.failed || generation.started == settings.games) return;
+            game = generation.started++;
+        }
+
+        const PackedPosition::GameResult result = playGame(settings, game, table, samples);
+
+        std::vector<PackedPosition> packedGame(samples.size());
+        for (std::size_t i = 0; i < samples.size(); i++) {
+            PackedPosition::pack(samples[i].board, samples[i].score, result, samples[i].ply, packedGame[i]);
+        }
+
+        std::lock_guard<std::mutex> lock(generation.mutex);
+        generation.results[static_cast<int>(result)]++;
+        generation.positions += samples.size();
+        generation.waiting.emplace(game, std::move(packedGame));
+        writeInTurn(generation);
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - generation.lastReport >= std::chrono::seconds(PROGRESS_SECONDS)) {
+            generation.lastReport = now;
+            const double seconds = std::chrono::duration<double>(now - generation.start).count();
+            std::cerr << generation.written << "/" << settings.games << " games, " << generation.positions << " positions, "
+                      << static_cast<std::uint64_t>(generation.positions / seconds) << " positions/s" << std::endl;
+        }
+    }
+}
+
+
+static void printUsage() {
+    std::cerr << "usage: Datagen <packed file> [name value]...\n"
+              << "  games N        games to play, default 1000\n"
+              << "  depth N        search every position to depth N, default 8\n"
+              << "  nodes N        search every position for N nodes instead\n"
+              << "  seed N         the seed of the random openings, default 1\n"
+              << "  randomplies N  random moves opening every game, default 8\n"
+              << "  maxplies N     plies after which a game is a draw, default 400\n"
+              << "  hash MB        transposition table size of each worker, default 16\n"
+              << "  workers N      games played side by side, default one per core\n"
+              << "  evalfile path  network to evaluate with" << std::endl;
+}
+
+/**
+ * Read the settings from the arguments after the file, pairs of a name and a value.
+ *
+ * @return False for an unknown name or a name without a value.
+ */
+static bool readSettings(int argc, char* argv[], Settings& settings) {
+    for (int i = 2; i < argc; i += 2) {
+        const std::string name = argv[i];
+        if (i + 1 == argc) {
+            std::cerr << name << " has no value" << std::endl;
+            return false;
+        }
+
+        const char* value = argv[i + 1];
+        const int number = std::atoi(value);
+
+        if (name == "games") settings.games = std::strtoull(value, nullptr, 10);
+        else if (name == "depth") settings.limits.depth = std::max(1, number);
+        else if (name == "nodes") settings.limits.nodes = std::strtoull(value, nullptr, 10);
+        else if (name == "seed") settings.seed = std::strtoull(value, nullptr, 10);
+        else if (name == "randomplies") settings.randomPlies = std::max(0, number);
+        else if (name == "maxplies") settings.maxPlies = std::max(1, number);
+        else if (name == "hash") settings.hash = std::max(1, number);
+        else if (name == "workers") settings.workers = std::max(1, number);
+        else if (name == "evalfile") {
+            if (!Nnue::load(value)) std::cerr << "could not load network " << value << ", evaluating by material" << std::endl;
+        }
+        else {
+            std::cerr << "unknown setting " << name << std::endl;
+            return false;
+        }
+    }
+
+    if (settings.limits.depth == 0 && settings.limits.nodes == 0) settings.limits.depth = 8;
+    if (settings.workers == 0) settings.workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+    Generation generation;
+    if (argc < 2 || !readSettings(argc, argv, generation.settings)) {
+        printUsage();
+        return 1;
+    }
+
+    const Settings& settings = generation.settings;
+    generation.path = argv[1];
+    if (!generation.output.open(generation.path)) {
+        std::cerr << "could not write " << generation.path << std::endl;
+        return 1;
+    }
+
+    // a single search thread, a search with more threads depends on how they are scheduled
+    BoardEvaluation::setThreadCount(1);
+
+    generation.start = std::chrono::steady_clock::now();
+    generation.lastReport = generation.start;
+
+    std::vector<std::thread> pool;
+    for (int worker = 0; worker < settings.workers; worker++) pool.emplace_back(generate, std::ref(generation));
+    for (std::thread& worker : pool) worker.join();
+
+    if (!generation.failed && !generation.output.flush()) {
+        std::cerr << "could not write " << generation.path << std::endl;
+        generation.failed = true;
+    }
+    generation.output.close();
+    if (generation.failed) return 1;
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - generation.start).count();
+    std::cerr << "played " << settings.games << " games in " << seconds << " seconds, +" << generation.results[static_cast<int>(PackedPosition::GameResult::WHITE_WINS)]
+              << " =" << generation.results[static_cast<int>(PackedPosition::GameResult::DRAW)] << " -" << generation.results[static_cast<int>(PackedPosition::GameResult::BLACK_WINS)]
+              << ", wrote " << generation.positions << " positions" << std::endl;
+    return 0;
+}
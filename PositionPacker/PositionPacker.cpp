@@ -0,0 +1,114 @@
+/**
+ * @file PositionPacker.cpp
+ *
+ * A standalone tool converting data sets of positions between FEN or EPD text and the 32 byte
+ * packed positions of PackedPosition.h. Text is read memory mapped and packed files are read and
+ * written a block at a time, so files of any size convert in constant memory.
+ *
+ * Usage: PositionPacker pack <fen or epd file> <packed file>
+ *        PositionPacker unpack <packed file> <epd file>
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "MappedFile.h"
+#include "PackedPosition.h"
+
+/**
+ * Pack every position of a text file, lines that hold no position are counted and skipped.
+ */
+static int pack(const std::string& inputPath, const std::string& outputPath) {
+    MappedFile input;
+    if (!input.open(inputPath)) {
+        std::cout << "could not read " << inputPath << std::endl;
+        return 1;
+    }
+
+    PackedWriter output;
+    if (!output.open(outputPath)) {
+        std::cout << "could not write " << outputPath << std::endl;
+        return 1;
+    }
+
+    const char* text = reinterpret_cast<const char*>(input.data());
+    const char* textEnd = text + input.size();
+    std::uint64_t packed = 0;
+    std::uint64_t skipped = 0;
+
+    for (const char* lineStart = text; lineStart < textEnd;) {
+        const char* lineEnd = std::find(lineStart, textEnd, '\n');
+        const std::string line(lineStart, lineEnd);
+        lineStart = lineEnd + 1;
+
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t\r")] == '#') continue;
+
+        PackedPosition position;
+        if (!PackedPosition::fromFen(line, position)) {
+            skipped++;
+            continue;
+        }
+
+        if (!output.write(position)) {
+            std::cout << "could not write " << outputPath << std::endl;
+            return 1;
+        }
+        packed++;
+    }
+
+    output.close();
+    std::cout << "packed " << packed << " positions into " << packed * PackedPosition::size << " bytes, from " << input.size() << " bytes of text";
+    if (skipped > 0) std::cout << ", skipped " << skipped << " lines without a position";
+    std::cout << std::endl;
+    return 0;
+}
+
+/**
+ * Write every position of a packed file as an EPD line.
+ */
+static int unpack(const std::string& inputPath, const std::string& outputPath) {
+    PackedReader input;
+    if (!input.open(inputPath)) {
+        std::cout << "could not read " << inputPath << std::endl;
+        return 1;
+    }
+
+    std::ofstream output(outputPath, std::ios::trunc);
+    if (!output) {
+        std::cout << "could not write " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::uint64_t count = 0;
+    PackedPosition position;
+    while (input.read(position)) {
+        output << position.toEpd() << '\n';
+        count++;
+    }
+
+    std::cout << "unpacked " << count << " positions" << std::endl;
+    return output ? 0 : 1;
+}
+
+
+int main(int argc, char* argv[]) {
+    const std::string mode = argc > 1 ? argv[1] : "";
+    if (argc < 4 || (mode != "pack" && mode != "unpack")) {
+        std::cout << "usage: PositionPacker pack <fen or epd file> <packed file>" << std::endl;
+        std::cout << "       PositionPacker unpack <packed file> <epd file>" << std::endl;
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const int exitCode = mode == "pack" ? pack(argv[2], argv[3]) : unpack(argv[2], argv[3]);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "took " << elapsed << " ms" << std::endl;
+    return exitCode;
+}
@@ -0,0 +1,514 @@
+/**
+ * @file TablebaseGenerator.cpp
+ *
+ * A standalone tool building the engine's endgame tablebases by retrograde analysis, for every
+ * material combination of up to four pieces. It plays by the engine's own rules, through the
+ * engine's ChessBoard and MoveGeneration, so the tables agree with the search that probes them.
+ *
+ * Usage: TablebaseGenerator <output directory> [max pieces] [threads]
+ *
+ * @author Martin N
+ * @date 10/2026
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChessData.h"
+#include "MoveGeneration.h"
+#include "MoveTables.h"
+#include "Tablebase.h"
+
+using PieceType = ChessBoard::PieceType;
+
+// The piece kinds besides the king in index order, per color with 1 for white and 0 for black.
+constexpr PieceType KIND_PIECES[2][5] = {
+    { PieceType::BLACK_QUEEN, PieceType::BLACK_ROOK, PieceType::BLACK_BISHOP, PieceType::BLACK_KNIGHT, PieceType::BLACK_PAWN },
+    { PieceType::WHITE_QUEEN, PieceType::WHITE_ROOK, PieceType::WHITE_BISHOP, PieceType::WHITE_KNIGHT, PieceType::WHITE_PAWN }
+};
+
+// Rough values of the kinds, the stronger side of a combination is the one stored as white.
+constexpr int KIND_VALUES[5] = { 9, 5, 3, 3, 1 };
+
+// Markers used while a table is built, alongside the values of Tablebase.
+constexpr std::uint8_t UNRESOLVED = 0xFF;
+constexpr std::uint8_t NEVER_LOST = 0xFF;
+constexpr int MAX_PLIES = 0xFF - 1 - Tablebase::mateValueBase;
+
+/**
+ * @struct Material
+ * A material combination and the layout of its table index.
+ */
+struct Material {
+    int counts[2][5] = {};          ///< Queens, rooks, bishops, knights and pawns of each side.
+    std::vector<PieceType> pieces;  ///< The pieces besides the kings, in index order.
+    int pieceCount = 2;             ///< Pieces on the board, kings included.
+    std::size_t perSide = 0;        ///< Positions for each side to move.
+};
+
+/**
+ * @struct TableStats
+ * What building one table took, reported when it is written.
+ */
+struct TableStats {
+    std::uint64_t positions = 0;    ///< Positions that can occur.
+    std::uint64_t moves = 0;        ///< Legal moves generated.
+    std::uint64_t wins = 0;         ///< Positions the side to move wins.
+    std::uint64_t losses = 0;       ///< Positions the side to move loses.
+    int longestMate = 0;            ///< The most plies any mate takes.
+};
+
+static std::mutex outputMutex;
+
+
+/**
+ * Get the squares a piece can have come from to reach a square without capturing, the reverse
+ * of its moves. A pawn steps back one square, or two from its fourth rank, and never from its
+ * first rank, where it can't stand.
+ *
+ * @param piece The piece that moved.
+ * @param square The square it stands on now.
+ * @param occupied A bitboard of the occupied squares.
+ * @return A bitboard of the empty squares it can have come from.
+ */
+static std::uint64_t unmoveSources(PieceType piece, int square, std::uint64_t occupied) {
+    const std::uint8_t to = static_cast<std::uint8_t>(square);
+    std::uint64_t sources = 0;
+
+    switch (piece) {
+    case PieceType::WHITE_KING:
+    case PieceType::BLACK_KING: sources = movetables::kingMoveTable[to]; break;
+    case PieceType::WHITE_KNIGHT:
+    case PieceType::BLACK_KNIGHT: sources = movetables::knightMoveTable[to]; break;
+    case PieceType::WHITE_BISHOP:
+    case PieceType::BLACK_BISHOP: sources = MoveGeneration::bishopAttacks(to, occupied); break;
+    case PieceType::WHITE_ROOK:
+    case PieceType::BLACK_ROOK: sources = MoveGeneration::rookAttacks(to, occupied); break;
+    case PieceType::WHITE_QUEEN:
+    case PieceType::BLACK_QUEEN: sources = MoveGeneration::bishopAttacks(to, occupied) | MoveGeneration::rookAttacks(to, occupied); break;
+    case PieceType::WHITE_PAWN:
+        if (square >= 16 && ((occupied >> (square - 8)) & 1) == 0) {
+            sources = (std::uint64_t)1 << (square - 8);
+            if (square / 8 == 3 && ((occupied >> (square - 16)) & 1) == 0) sources |= (std::uint64_t)1 << (square - 16);
+        }
+        break;
+    case PieceType::BLACK_PAWN:
+        if (square < 48 && ((occupied >> (square + 8)) & 1) == 0) {
+            sources = (std::uint64_t)1 << (square + 8);
+            if (square / 8 == 4 && ((occupied >> (square + 16)) & 1) == 0) sources |= (std::uint64_t)1 << (square + 16);
+        }
+        break;
+    default: break;
+    }
+
+    return sources & ~occupied;
+}
+
+
+/**
+ * Set up the position of a table index. Indexes that don't describe a position that can occur
+ * are rejected: two pieces on one square, pieces of one kind out of order (the same position is
+ * stored under the index with them in order), and pawns on their own first rank.
+ *
+ * @param material The material of the table.
+ * @param index The index of the position.
+ * @param board Filled with the position.
+ * @param whiteToMove Set to the side to move.
+ * @return False if the index describes no position.
+ */
+static bool decodePosition(const Material& material, std::size_t index, ChessBoard& board, bool& whiteToMove) {
+    whiteToMove = index < material.perSide;
+    if (!whiteToMove) index -= material.perSide;
+
+    int squares[Tablebase::maxPieces];
+    for (int i = material.pieceCount - 1; i >= 1; i--) {
+        squares[i] = static_cast<int>(index % 64);
+        index /= 64;
+    }
+    squares[0] = static_cast<int>((index / 4) * 8 + index % 4);
+
+    board.clearBoard();
+    board.currPlayer = whiteToMove;
+    std::uint64_t occupied = 0;
+
+    for (int i = 0; i < material.pieceCount; i++) {
+        const std::uint64_t bit = (std::uint64_t)1 << squares[i];
+        const PieceType piece = i == 0 ? PieceType::WHITE_KING : i == 1 ? PieceType::BLACK_KING : material.pieces[i - 2];
+
+        if ((occupied & bit) != 0) return false;
+        if (i >= 3 && piece == material.pieces[i - 3] && squares[i] < squares[i - 1]) return false;
+        if (piece == PieceType::WHITE_PAWN && squares[i] < 8) return false;
+        if (piece == PieceType::BLACK_PAWN && squares[i] >= 56) return false;
+
+        occupied |= bit;
+        board.getPieceBitboard(piece) |= bit;
+    }
+
+    return true;
+}
+
+
+/**
+ * @class TableBuilder
+ * Builds the table of one material combination. Every position is first looked at once, in
+ * parallel slices: positions that can't occur are marked, mates and stalemates are settled, the
+ * captures are looked up in the smaller tables, and the other moves are counted. Then results
+ * spread backwards one ply at a time, from the positions settled at a ply to the positions that
+ * lead to them: a move into a lost position wins, and a position whose moves all lead to won
+ * positions is lost once the last of them is settled. Whatever is left unsettled is a draw.
+ */
+class TableBuilder {
+public:
+    explicit TableBuilder(const Material& material)
+        : material(material), values(2 * material.perSide, UNRESOLVED), remaining(2 * material.perSide, 0),
+          lossFloor(2 * material.perSide, 0), scheduled(2 * material.perSide, 0) {}
+
+    /**
+     * Build the table.
+     *
+     * @param threads The number of threads for the first pass.
+     * @param stats Filled with what building the table took.
+     * @return False if a smaller table needed for the captures is missing, or a mate is too long to store.
+     */
+    bool build(int threads, TableStats& stats) {
+        std::vector<std::thread> workers;
+        std::vector<TableStats> sliceStats(threads);
+        std::atomic<bool> complete(true);
+        const std::size_t size = values.size();
+
+        for (int slice = 0; slice < threads; slice++) {
+            workers.emplace_back([this, slice, threads, size, &sliceStats, &complete]() {
+                if (!firstPass(size * slice / threads, size * (slice + 1) / threads, sliceStats[slice])) complete = false;
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        if (!complete) return false;
+
+        for (const TableStats& slice : sliceStats) {
+            stats.positions += slice.positions;
+            stats.moves += slice.moves;
+        }
+
+        if (!retrograde(stats)) return false;
+
+        for (std::uint8_t& value : values) {
+            if (value == UNRESOLVED) value = Tablebase::drawValue;
+            if (value < Tablebase::mateValueBase) continue;
+
+            const int plies = value - Tablebase::mateValueBase;
+            if (plies % 2 == 1) stats.wins++;
+            else stats.losses++;
+            stats.longestMate = std::max(stats.longestMate, plies);
+        }
+
+        return true;
+    }
+
+    /**
+     * Write the table in the format Tablebase maps.
+     *
+     * @param path The path of the file.
+     * @return True if the file was written.
+     */
+    bool write(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        const std::uint32_t header[4] = { 0, Tablebase::fileVersion, static_cast<std::uint32_t>(material.pieceCount), 0 };
+        char headerBytes[Tablebase::headerSize];
+        std::memcpy(headerBytes, header, sizeof(header));
+        std::memcpy(headerBytes, "CETB", 4);
+
+        file.write(headerBytes, sizeof(headerBytes));
+        file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size()));
+        return static_cast<bool>(file);
+    }
+
+private:
+    /**
+     * Look at every position of a slice of the table once.
+     */
+    bool firstPass(std::size_t begin, std::size_t end, TableStats& stats) {
+        ChessBoard board;
+        bool whiteToMove;
+
+        for (std::size_t index = begin; index < end; index++) {
+            if (!decodePosition(material, index, board, whiteToMove) || MoveGeneration::isCheck(&board, !whiteToMove)) {
+                values[index] = Tablebase::invalidValue;
+                continue;
+            }
+
+            const AttackInfo attacks = MoveGeneration::getAttackInfo(&board);
+            const std::vector<ChessMove> moves = MoveGeneration::generateColorsLegalMoves(&board, whiteToMove, attacks);
+            const std::uint64_t enemyPieces = whiteToMove ? board.getAllBlackPieces() : board.getAllWhitePieces();
+
+            stats.positions++;
+            stats.moves += moves.size();
+
+            if (moves.empty()) {
+                values[index] = attacks.inCheck[whiteToMove ? 1 : 0] ? Tablebase::mateValueBase : Tablebase::drawValue;
+                continue;
+            }
+
+            int quickestWin = 0;
+            bool canDraw = false;
+            int count = 0;
+
+            for (const ChessMove& move : moves) {
+                if (((enemyPieces >> move.toSquare) & 1) == 0) {
+                    count++;
+                    continue;
+                }
+
+                // a capture leaves this table for a smaller one that is already built
+                ChessBoard newBoard = board;
+                newBoard.makeMove(move.fromSquare, move.toSquare);
+
+                int wdl;
+                int plies;
+                if (!Tablebase::probe(&newBoard, !whiteToMove, wdl, plies)) return false;
+
+                if (wdl < 0 && (quickestWin == 0 || plies + 1 < quickestWin)) quickestWin = plies + 1;
+                if (wdl == 0) canDraw = true;
+                if (wdl > 0) lossFloor[index] = static_cast<std::uint8_t>(std::max<int>(lossFloor[index], plies));
+            }
+
+            if (quickestWin != 0 || canDraw) remaining[index] = NEVER_LOST;
+            else remaining[index] = static_cast<std::uint8_t>(count);
+
+            // a win by capture, or a loss when every move is a losing capture, is settled at its ply later
+            if (quickestWin != 0) scheduled[index] = static_cast<std::uint8_t>(quickestWin);
+            else if (!canDraw && count == 0) scheduled[index] = static_cast<std::uint8_t>(lossFloor[index] + 1);
+        }
+
+        return true;
+    }
+
+    /**
+     * Spread the results backwards one ply at a time.
+     */
+    bool retrograde(TableStats& stats) {
+        std::vector<std::size_t> frontier;
+        std::vector<std::size_t> next;
+        int lastScheduled = 0;
+
+        for (std::size_t index = 0; index < values.size(); index++) {
+            if (values[index] == Tablebase::mateValueBase) frontier.push_back(index);
+            if (values[index] == UNRESOLVED) lastScheduled = std::max<int>(lastScheduled, scheduled[index]);
+        }
+
+        ChessBoard board;
+        bool whiteToMove;
+
+        for (int ply = 0; !frontier.empty() || ply <= lastScheduled; ply++) {
+            if (ply + 1 > MAX_PLIES) return false;
+
+            if (ply > 0 && ply <= lastScheduled) {
+                for (std::size_t index = 0; index < values.size(); index++) {
+                    if (scheduled[index] == ply && values[index] == UNRESOLVED) {
+                        values[index] = static_cast<std::uint8_t>(Tablebase::mateValueBase + ply);
+                        frontier.push_back(index);
+                    }
+                }
+            }
+
+            for (const std::size_t index : frontier) {
+                decodePosition(material, index, board, whiteToMove);
+                stats.moves += spreadBack(board, !whiteToMove, ply, next, lastScheduled);
+            }
+
+            frontier.swap(next);
+            next.clear();
+        }
+
+        return true;
+    }
+
+    /**
+     * Settle what the result of one position decides about the positions leading to it.
+     *
+     * @return The number of moves taken back.
+     */
+    std::uint64_t spreadBack(const ChessBoard& board, bool mover, int ply, std::vector<std::size_t>& next, int& lastScheduled) {
+        const std::uint64_t occupied = board.getAllPieces();
+        const int firstType = mover ? 0 : 6;
+        std::uint64_t unmoves = 0;
+
+        for (int type = firstType; type < firstType + 6; type++) {
+            const PieceType piece = static_cast<PieceType>(type);
+
+            for (std::uint64_t pieces = board.getPieceBitboard(piece); pieces != 0; pieces &= pieces - 1) {
+                const int to = data::bits::lowestSquare(pieces);
+
+                for (std::uint64_t sources = unmoveSources(piece, to, occupied); sources != 0; sources &= sources - 1) {
+                    const int from = data::bits::lowestSquare(sources);
+                    unmoves++;
+
+                    ChessBoard previous = board;
+                    previous.getPieceBitboard(piece) ^= ((std::uint64_t)1 << to) | ((std::uint64_t)1 << from);
+                    const std::size_t index = Tablebase::tableIndex(&previous, mover, false);
+                    if (values[index] != UNRESOLVED) continue;
+
+                    // moving into a lost position wins
+                    if (ply % 2 == 0) {
+                        values[index] = static_cast<std::uint8_t>(Tablebase::mateValueBase + ply + 1);
+                        next.push_back(index);
+                        continue;
+                    }
+
+                    // the position is lost once its last move is known to lead to a win
+                    if (remaining[index] == NEVER_LOST) continue;
+                    lossFloor[index] = static_cast<std::uint8_t>(std::max<int>(lossFloor[index], ply));
+                    if (--remaining[index] != 0) continue;
+
+                    const int lossPly = lossFloor[index] + 1;
+                    if (lossPly == ply + 1) {
+                        values[index] = static_cast<std::uint8_t>(Tablebase::mateValueBase + lossPly);
+                        next.push_back(index);
+                    }
+                    else {
+                        scheduled[index] = static_cast<std::uint8_t>(lossPly);
+                        lastScheduled = std::max(lastScheduled, lossPly);
+                    }
+                }
+            }
+        }
+
+        return unmoves;
+    }
+
+    const Material& material;
+    std::vector<std::uint8_t> values;     ///< The result of each position, UNRESOLVED until settled.
+    std::vector<std::uint8_t> remaining;  ///< Moves not yet known to lead to a win, NEVER_LOST if one draws or wins.
+    std::vector<std::uint8_t> lossFloor;  ///< The longest win among the moves settled so far.
+    std::vector<std::uint8_t> scheduled;  ///< The ply a capture settles the position at, 0 for none.
+};
+
+
+/**
+ * List the material combinations with a number of pieces, each once with its stronger side as
+ * white. Equal material counts as either.
+ *
+ * @param pieceCount The number of pieces, kings included.
+ * @return The combinations.
+ */
+static std::vector<Material> materialsWith(int pieceCount) {
+    std::vector<Material> materials;
+    std::vector<int> pieces(pieceCount - 2, 0);
+
+    // every multiset of colored kinds, a piece 0 to 4 being a white kind and 5 to 9 a black one
+    while (true) {
+        Material material;
+        material.pieceCount = pieceCount;
+        for (int piece : pieces) material.counts[piece < 5 ? 1 : 0][piece % 5]++;
+
+        int strength[2] = {};
+        for (int color = 0; color < 2; color++)
+            for (int kind = 0; kind < 5; kind++) strength[color] += material.counts[color][kind] * KIND_VALUES[kind];
+
+        const bool isStronger = strength[1] > strength[0]
+            || (strength[1] == strength[0] && !std::lexicographical_compare(material.counts[1], material.counts[1] + 5, material.counts[0], material.counts[0] + 5));
+
+        if (isStronger) {
+            for (int color = 1; color >= 0; color--)
+                for (int kind = 0; kind < 5; kind++) material.pieces.insert(material.pieces.end(), material.counts[color][kind], KIND_PIECES[color][kind]);
+            material.perSide = Tablebase::positionsPerSide(pieceCount);
+            materials.push_back(material);
+        }
+
+        // next multiset, kept in non-decreasing order
+        int i = static_cast<int>(pieces.size()) - 1;
+        while (i >= 0 && pieces[i] == 9) i--;
+        if (i < 0) break;
+        pieces[i]++;
+        for (int j = i + 1; j < static_cast<int>(pieces.size()); j++) pieces[j] = pieces[i];
+    }
+
+    return materials;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: TablebaseGenerator <output directory> [max pieces] [threads]" << std::endl;
+        return 1;
+    }
+
+    const std::string directory = argv[1];
+    const int maxPieces = argc > 2 ? std::max(2, std::min(std::atoi(argv[2]), Tablebase::maxPieces)) : Tablebase::maxPieces;
+    const int threads = argc > 3 ? std::max(1, std::atoi(argv[3])) : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    // a wrong slider lookup would be built into every table
+    if (!MoveGeneration::checkSliderTables()) {
+        std::cout << "the slider move tables don't match their magic numbers" << std::endl;
+        return 1;
+    }
+
+    // stale tables would stay mapped while their replacements are written
+    Tablebase::init("");
+    for (int pieceCount = 2; pieceCount <= maxPieces; pieceCount++) {
+        for (const Material& material : materialsWith(pieceCount)) std::remove((directory + "/" + Tablebase::fileName(material.counts)).c_str());
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::uint64_t totalMoves = 0;
+    bool failed = false;
+
+    for (int pieceCount = 2; pieceCount <= maxPieces && !failed; pieceCount++) {
+        const std::vector<Material> materials = materialsWith(pieceCount);
+        const int workers = std::min(threads, static_cast<int>(materials.size()));
+        const int slices = std::max(1, threads / workers);
+        std::atomic<std::size_t> nextMaterial(0);
+        std::atomic<bool> levelFailed(false);
+        std::atomic<std::uint64_t> levelMoves(0);
+
+        // the tables of one piece count only depend on smaller ones, so they are built side by side
+        std::vector<std::thread> pool;
+        for (int worker = 0; worker < workers; worker++) {
+            pool.emplace_back([&]() {
+                for (std::size_t i = nextMaterial++; i < materials.size(); i = nextMaterial++) {
+                    const std::string name = Tablebase::fileName(materials[i].counts);
+                    const auto tableStart = std::chrono::steady_clock::now();
+
+                    TableStats stats;
+                    TableBuilder builder(materials[i]);
+                    const bool built = builder.build(slices, stats) && builder.write(directory + "/" + name);
+                    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tableStart).count();
+                    levelMoves += stats.moves;
+
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    if (!built) {
+                        std::cout << name << " failed" << std::endl;
+                        levelFailed = true;
+                        continue;
+                    }
+                    std::cout << name << "  positions " << stats.positions << "  wins " << stats.wins << "  losses " << stats.losses
+                        << "  longest mate " << stats.longestMate << " plies  " << seconds << " s" << std::endl;
+                }
+            });
+        }
+        for (std::thread& worker : pool) worker.join();
+
+        failed = levelFailed;
+        totalMoves += levelMoves;
+
+        // the next piece count probes these tables for its captures
+        Tablebase::init(directory);
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "moves generated " << totalMoves << " in " << seconds << " s, "
+        << static_cast<std::uint64_t>(totalMoves / std::max(seconds, 0.001)) << " moves/s on " << threads << " threads" << std::endl;
+
+    return failed ? 1 : 0;
+}